@@ -23,6 +23,16 @@
 #include <gtksourceview/gtksourcestyleschememanager.h>
 #include "app.h"
 
+/* One extension file, as recorded in the catalog of installed extensions */
+typedef struct {
+	gboolean builtin;
+	gboolean valid;
+	guint64 mtime;
+	char *author;
+	char *title;
+	char *version;
+} I7ExtensionCatalogEntry;
+
 typedef struct {
 	/* Action Groups */
 	GtkActionGroup *app_action_group;
@@ -37,6 +47,11 @@ typedef struct {
 	GFileMonitor *extension_dir_monitor;
 	/* Tree of installed extensions */
 	GtkTreeStore *installed_extensions;
+	/* Catalog of installed extensions, kept between runs of the application
+	and updated in a worker thread */
+	GHashTable *extension_catalog;
+	GThread *catalog_thread;
+	gboolean catalog_scan_pending;
 	/* Current print settings */
 	GtkPrintSettings *print_settings;
 	GtkPageSetup *page_setup;
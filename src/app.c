@@ -40,6 +40,7 @@
 #define EXTENSION_INDEX_PATH "Inform", "Documentation", "ExtIndex.html"
 #define EXTENSION_DOCS_BASE_PATH "Inform", "Documentation", "Extensions"
 #define EXTENSION_DOWNLOAD_TIMEOUT_S 15
+#define EXTENSION_CATALOG_FILE_NAME "extensions-catalog.ini"
 
 /* The singleton application class; should be derived from GtkApplication when
  porting to GTK 3. Contains the following global miscellaneous stuff:
@@ -62,6 +63,9 @@ typedef struct {
 	gboolean caseless;
 } I7AppRegexInfo;
 
+static GHashTable *load_extension_catalog(I7App *app);
+static void update_installed_extensions_tree(I7App *app);
+
 /* Helper function: call gtk_source_style_scheme_manager_append_search_path()
 with a #GFile */
 static void
@@ -150,7 +154,6 @@ i7_app_init(I7App *self)
 	g_object_unref(extensions_file);
 
 	/* Set up monitor for extensions directory */
-	i7_app_run_census(self, FALSE);
 	priv->extension_dir_monitor = NULL;
 	i7_app_monitor_extensions_directory(self);
 
@@ -171,6 +174,15 @@ i7_app_init(I7App *self)
 			ERROR(_("Could not compile regex"), error);
 	}
 
+	/* Show the extensions as they were the last time the application ran,
+	then check them in the background (must be run after the regices are
+	compiled) */
+	priv->extension_catalog = load_extension_catalog(self);
+	priv->catalog_thread = NULL;
+	priv->catalog_scan_pending = FALSE;
+	update_installed_extensions_tree(self);
+	i7_app_run_census(self, FALSE);
+
 	self->prefs = create_prefs_window(priv->prefs_settings, builder);
 
 	/* Set up signals for GSettings keys. */
@@ -192,6 +204,8 @@ i7_app_finalize(GObject *self)
 	if(I7_APP(self)->prefs)
 		g_slice_free(I7PrefsWidgets, I7_APP(self)->prefs);
 	g_object_unref(priv->installed_extensions);
+	if(priv->extension_catalog)
+		g_hash_table_unref(priv->extension_catalog);
 	g_object_unref(priv->app_action_group);
 	g_object_unref(priv->color_scheme_manager);
 	g_object_unref(priv->state_settings);
@@ -993,133 +1007,426 @@ i7_app_foreach_installed_extension(I7App *app, gboolean builtin, I7AppAuthorFunc
 	g_object_unref(root_dir);
 }
 
-/* Helper function: Add author to tree store callback */
-static GtkTreeIter *
-add_author_to_tree_store(GFileInfo *info, GtkTreeStore *store)
+/* Helper function: free a catalog entry */
+static void
+extension_catalog_entry_free(I7ExtensionCatalogEntry *entry)
 {
-	GtkTreeIter parent_iter;
-	const char *author_display_name = g_file_info_get_display_name(info);
+	g_free(entry->author);
+	g_free(entry->title);
+	g_free(entry->version);
+	g_slice_free(I7ExtensionCatalogEntry, entry);
+}
 
-	/* If the author directory was already indexed before, add the extension
-	to it instead of making a new entry */
-	if(!get_iter_for_author(GTK_TREE_MODEL(store), author_display_name, &parent_iter)) {
-		gtk_tree_store_append(store, &parent_iter, NULL);
-		gtk_tree_store_set(store, &parent_iter,
-			I7_APP_EXTENSION_TEXT, author_display_name,
-			I7_APP_EXTENSION_READ_ONLY, TRUE,
-			I7_APP_EXTENSION_ICON, NULL,
-			I7_APP_EXTENSION_FILE, NULL,
-			-1);
+/* Helper function: create an empty extension catalog, mapping the path of each
+extension file to an I7ExtensionCatalogEntry */
+static GHashTable *
+extension_catalog_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)extension_catalog_entry_free);
+}
+
+/* Helper function: make a copy of @catalog that can be handed to a worker
+thread, so that the GUI can keep using the original */
+static GHashTable *
+extension_catalog_copy(GHashTable *catalog)
+{
+	GHashTable *retval = extension_catalog_new();
+	GHashTableIter iter;
+	const char *extension_path;
+	I7ExtensionCatalogEntry *entry;
+
+	g_hash_table_iter_init(&iter, catalog);
+	while(g_hash_table_iter_next(&iter, (gpointer *)&extension_path, (gpointer *)&entry)) {
+		I7ExtensionCatalogEntry *copy = g_slice_dup(I7ExtensionCatalogEntry, entry);
+		copy->author = g_strdup(entry->author);
+		copy->title = g_strdup(entry->title);
+		copy->version = g_strdup(entry->version);
+		g_hash_table_insert(retval, g_strdup(extension_path), copy);
 	}
+	return retval;
+}
 
-	return gtk_tree_iter_copy(&parent_iter);
+/* Helper function: get the location of the file where the extension catalog is
+stored between runs of the application. Free with g_free(). */
+static char *
+get_extension_catalog_path(I7App *app)
+{
+	GFile *config_dir = i7_app_get_config_dir(app);
+	char *config_path = g_file_get_path(config_dir);
+	g_object_unref(config_dir);
+	char *retval = g_build_filename(config_path, EXTENSION_CATALOG_FILE_NAME, NULL);
+	g_free(config_path);
+	return retval;
 }
 
-/* Helper function: add extension to tree store as a non-built-in extension */
-static void
-add_extension_to_tree_store(GFile *parent, GFileInfo *info, GtkTreeIter *parent_iter, GtkTreeStore *store)
+/* Read the extension catalog saved by the last run of the application. Any
+errors result in an empty catalog, which just means that all the extensions
+will be read again. */
+static GHashTable *
+load_extension_catalog(I7App *app)
 {
-	GError *error = NULL;
-	const char *extension_name = g_file_info_get_name(info);
-	GFile *extension_file = g_file_get_child(parent, extension_name);
-	GtkTreeIter child_iter;
-	char *version, *title;
-
-	char *firstline = read_first_line(extension_file, NULL, &error);
-	if(firstline == NULL) {
-		g_warning("Error reading extension file %s, skipping: %s", extension_name, error->message);
-		g_error_free(error);
-		goto finally;
+	GHashTable *catalog = extension_catalog_new();
+	GKeyFile *keyfile = g_key_file_new();
+	char *path = get_extension_catalog_path(app);
+
+	if(g_key_file_load_from_file(keyfile, path, G_KEY_FILE_NONE, NULL)) {
+		char **groups = g_key_file_get_groups(keyfile, NULL);
+		char **group;
+		for(group = groups; *group; group++) {
+			char *extension_path = g_key_file_get_string(keyfile, *group, "path", NULL);
+			if(extension_path == NULL)
+				continue;
+			I7ExtensionCatalogEntry *entry = g_slice_new0(I7ExtensionCatalogEntry);
+			entry->builtin = g_key_file_get_boolean(keyfile, *group, "builtin", NULL);
+			entry->valid = g_key_file_get_boolean(keyfile, *group, "valid", NULL);
+			entry->mtime = g_key_file_get_uint64(keyfile, *group, "modified", NULL);
+			entry->author = g_key_file_get_string(keyfile, *group, "author", NULL);
+			entry->title = g_key_file_get_string(keyfile, *group, "title", NULL);
+			entry->version = g_key_file_get_string(keyfile, *group, "version", NULL);
+			if(entry->author == NULL || (entry->valid && entry->title == NULL)) {
+				extension_catalog_entry_free(entry);
+				g_free(extension_path);
+				continue;
+			}
+			g_hash_table_insert(catalog, extension_path, entry); /* takes ownership */
+		}
+		g_strfreev(groups);
 	}
-	if(!is_valid_extension(i7_app_get(), firstline, &version, &title, NULL)) {
-		g_free(firstline);
-		g_warning("Invalid extension file %s, skipping.", extension_name);
-		goto finally;
+
+	g_free(path);
+	g_key_file_free(keyfile);
+	return catalog;
+}
+
+/* Save the extension catalog for the next run of the application. Errors are
+ignored. */
+static void
+save_extension_catalog(I7App *app, GHashTable *catalog)
+{
+	GKeyFile *keyfile = g_key_file_new();
+	GHashTableIter iter;
+	const char *extension_path;
+	I7ExtensionCatalogEntry *entry;
+	unsigned count = 0;
+
+	/* The path can't be the group name, because it may contain characters
+	that aren't allowed there */
+	g_hash_table_iter_init(&iter, catalog);
+	while(g_hash_table_iter_next(&iter, (gpointer *)&extension_path, (gpointer *)&entry)) {
+		char *group = g_strdup_printf("extension%u", count++);
+		g_key_file_set_string(keyfile, group, "path", extension_path);
+		g_key_file_set_boolean(keyfile, group, "builtin", entry->builtin);
+		g_key_file_set_boolean(keyfile, group, "valid", entry->valid);
+		g_key_file_set_uint64(keyfile, group, "modified", entry->mtime);
+		g_key_file_set_string(keyfile, group, "author", entry->author);
+		if(entry->title)
+			g_key_file_set_string(keyfile, group, "title", entry->title);
+		if(entry->version)
+			g_key_file_set_string(keyfile, group, "version", entry->version);
+		g_free(group);
 	}
-	g_free(firstline);
-
-	gtk_tree_store_append(store, &child_iter, parent_iter);
-	gtk_tree_store_set(store, &child_iter,
-		I7_APP_EXTENSION_TEXT, title, /* copies */
-		I7_APP_EXTENSION_VERSION, version, /* copies */
-		I7_APP_EXTENSION_READ_ONLY, FALSE,
-		I7_APP_EXTENSION_ICON, NULL,
-		I7_APP_EXTENSION_FILE, extension_file, /* references */
-		-1);
-
-	g_free(title);
-	g_free(version);
-finally:
-	g_object_unref(extension_file);
+
+	gsize length;
+	char *contents = g_key_file_to_data(keyfile, &length, NULL);
+	char *path = get_extension_catalog_path(app);
+	char *dirname = g_path_get_dirname(path);
+	g_mkdir_with_parents(dirname, 0755);
+	g_file_set_contents(path, contents, length, NULL);
+	g_free(dirname);
+	g_free(path);
+	g_free(contents);
+	g_key_file_free(keyfile);
 }
 
-/* Helper function: add extension to tree store as a built-in extension. Makes
- * sure that user-installed extensions override the built-in ones. */
+/* Helper function: catalog every extension in the author directories under
+@root_file. Entries for files that haven't been modified since they were last
+cataloged are moved over from @old_catalog; only new or changed files are read.
+This may be called from a worker thread, so it must not touch the GUI. */
 static void
-add_builtin_extension_to_tree_store(GFile *parent, GFileInfo *info, GtkTreeIter *parent_iter, GtkTreeStore *store)
+scan_extensions_directory(I7App *app, GFile *root_file, gboolean builtin, GHashTable *old_catalog, GHashTable *new_catalog)
 {
-	GError *error = NULL;
-	const char *extension_name = g_file_info_get_name(info);
-	GFile *extension_file = g_file_get_child(parent, extension_name);
-	GtkTreeIter child_iter;
-	char *version, *title;
-
-	char *firstline = read_first_line(extension_file, NULL, &error);
-	if(firstline == NULL) {
-		g_warning("Error reading extension file %s, skipping: %s", extension_name, error->message);
-		g_error_free(error);
-		goto finally;
-	}
-	if(!is_valid_extension(i7_app_get(), firstline, &version, &title, NULL)) {
-		g_free(firstline);
-		g_warning("Invalid extension file %s, skipping.", extension_name);
-		goto finally;
+	GError *err = NULL;
+	GFileEnumerator *root_dir;
+	GFileInfo *author_info;
+
+	root_dir = g_file_enumerate_children(root_file, "standard::*", G_FILE_QUERY_INFO_NONE, NULL, &err);
+	if(!root_dir) {
+		g_warning("Error opening extensions directory: %s", err->message);
+		g_error_free(err);
+		return;
 	}
-	g_free(firstline);
 
-	/* Only add it if it is not overridden by a user-installed extension */
-	if(!get_iter_for_extension_title(GTK_TREE_MODEL(store), title, parent_iter, &child_iter)) {
-		gtk_tree_store_append(store, &child_iter, parent_iter);
-		gtk_tree_store_set(store, &child_iter,
-			I7_APP_EXTENSION_TEXT, title,
-			I7_APP_EXTENSION_VERSION, version,
-			I7_APP_EXTENSION_READ_ONLY, TRUE,
-			I7_APP_EXTENSION_ICON, "inform7-builtin",
-			I7_APP_EXTENSION_FILE, extension_file,
-			-1);
+	while((author_info = g_file_enumerator_next_file(root_dir, NULL, NULL)) != NULL) {
+		const char *author_name = g_file_info_get_name(author_info);
+		GFile *author_file;
+		GFileEnumerator *author_dir;
+		GFileInfo *extension_info;
+
+		/* Read each extension dir, but skip "Reserved" and nondirs */
+		if(strcmp(author_name, "Reserved") == 0
+			|| g_file_info_get_file_type(author_info) != G_FILE_TYPE_DIRECTORY) {
+			g_object_unref(author_info);
+			continue;
+		}
+
+		/* Descend into each author directory */
+		author_file = g_file_get_child(root_file, author_name);
+		author_dir = g_file_enumerate_children(author_file,
+			"standard::*," G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, &err);
+		if(!author_dir) {
+			g_warning("Error opening extensions directory: %s", err->message);
+			g_clear_error(&err);
+			g_object_unref(author_file);
+			g_object_unref(author_info);
+			continue;
+		}
+
+		while((extension_info = g_file_enumerator_next_file(author_dir, NULL, NULL)) != NULL) {
+			/* Read each file, but skip symlinks */
+			if(g_file_info_get_is_symlink(extension_info)) {
+				g_object_unref(extension_info);
+				continue;
+			}
+
+			GFile *extension_file = g_file_get_child(author_file, g_file_info_get_name(extension_info));
+			char *extension_path = g_file_get_path(extension_file);
+			guint64 mtime = g_file_info_get_attribute_uint64(extension_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+			char *old_path;
+			I7ExtensionCatalogEntry *entry;
+
+			if(g_hash_table_lookup_extended(old_catalog, extension_path, (gpointer *)&old_path, (gpointer *)&entry)
+				&& entry->mtime == mtime && entry->builtin == builtin) {
+				/* Unchanged since last time */
+				g_hash_table_steal(old_catalog, extension_path);
+				g_free(old_path);
+			} else {
+				entry = g_slice_new0(I7ExtensionCatalogEntry);
+				entry->builtin = builtin;
+				entry->mtime = mtime;
+				char *firstline = read_first_line(extension_file, NULL, &err);
+				if(firstline == NULL) {
+					g_warning("Error reading extension file %s, skipping: %s", extension_path, err->message);
+					g_clear_error(&err);
+				} else {
+					entry->valid = is_valid_extension(app, firstline, &entry->version, &entry->title, NULL);
+					if(!entry->valid)
+						g_warning("Invalid extension file %s, skipping.", extension_path);
+					g_free(firstline);
+				}
+			}
+			/* The author may have been renamed */
+			g_free(entry->author);
+			entry->author = g_strdup(g_file_info_get_display_name(author_info));
+
+			g_hash_table_insert(new_catalog, extension_path, entry); /* takes ownership */
+			g_object_unref(extension_file);
+			g_object_unref(extension_info);
+		}
+
+		g_file_enumerator_close(author_dir, NULL, NULL); /* ignore error */
+		g_object_unref(author_dir);
+		g_object_unref(author_file);
+		g_object_unref(author_info);
 	}
 
-	g_free(title);
-	g_free(version);
-finally:
-	g_object_unref(extension_file);
+	g_file_enumerator_close(root_dir, NULL, NULL); /* ignore error */
+	g_object_unref(root_dir);
 }
 
-/* Helper function: look in the user's extensions directory and the built-in one
- and list all the extensions there in the application's extensions tree */
-static gboolean
+/* Data for a scan of the extensions directories */
+typedef struct {
+	I7App *app;
+	GFile *user_root;
+	GFile *builtin_root;
+	GHashTable *old_catalog;
+	GHashTable *new_catalog;
+} CatalogScan;
+
+/* Helper function: set up a scan, starting from a copy of the current catalog.
+The GUI keeps displaying the current catalog until the scan is finished. */
+static CatalogScan *
+catalog_scan_new(I7App *app)
+{
+	I7_APP_USE_PRIVATE(app, priv);
+	CatalogScan *scan = g_slice_new0(CatalogScan);
+	scan->app = app;
+	scan->user_root = i7_app_get_extension_file(app, NULL, NULL);
+	scan->builtin_root = get_builtin_extension_file(app, NULL, NULL);
+	scan->old_catalog = extension_catalog_copy(priv->extension_catalog);
+	scan->new_catalog = extension_catalog_new();
+	return scan;
+}
+
+static void
+catalog_scan_free(CatalogScan *scan)
+{
+	g_object_unref(scan->user_root);
+	if(scan->builtin_root)
+		g_object_unref(scan->builtin_root);
+	g_hash_table_unref(scan->old_catalog);
+	if(scan->new_catalog)
+		g_hash_table_unref(scan->new_catalog);
+	g_slice_free(CatalogScan, scan);
+}
+
+/* Do the scan. The user-installed extensions come first, so that they override
+the built-in ones. */
+static void
+catalog_scan_run(CatalogScan *scan)
+{
+	scan_extensions_directory(scan->app, scan->user_root, FALSE, scan->old_catalog, scan->new_catalog);
+	if(scan->builtin_root)
+		scan_extensions_directory(scan->app, scan->builtin_root, TRUE, scan->old_catalog, scan->new_catalog);
+}
+
+/* Helper function: sort catalog paths for display; user-installed extensions
+before built-in ones, then by author and title */
+static int
+compare_catalog_paths(const char **a, const char **b, GHashTable *catalog)
+{
+	I7ExtensionCatalogEntry *entry_a = g_hash_table_lookup(catalog, *a);
+	I7ExtensionCatalogEntry *entry_b = g_hash_table_lookup(catalog, *b);
+	if(entry_a->builtin != entry_b->builtin)
+		return entry_a->builtin? 1 : -1;
+	int retval = g_utf8_collate(entry_a->author, entry_b->author);
+	if(retval != 0)
+		return retval;
+	return g_utf8_collate(entry_a->title, entry_b->title);
+}
+
+/* Helper function: list all the extensions in the catalog in the application's
+extensions tree, and rebuild the menus */
+static void
 update_installed_extensions_tree(I7App *app)
 {
-	GtkTreeStore *store = I7_APP_PRIVATE(app)->installed_extensions;
+	I7_APP_USE_PRIVATE(app, priv);
+	GtkTreeStore *store = priv->installed_extensions;
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+	GPtrArray *paths = g_ptr_array_new();
+	GHashTableIter iter;
+	const char *extension_path;
+	I7ExtensionCatalogEntry *entry;
+
+	g_hash_table_iter_init(&iter, priv->extension_catalog);
+	while(g_hash_table_iter_next(&iter, (gpointer *)&extension_path, (gpointer *)&entry)) {
+		if(entry->valid)
+			g_ptr_array_add(paths, (gpointer)extension_path);
+	}
+	g_ptr_array_sort_with_data(paths, (GCompareDataFunc)compare_catalog_paths, priv->extension_catalog);
+
 	gtk_tree_store_clear(store);
 
-	i7_app_foreach_installed_extension(app, FALSE,
-	    (I7AppAuthorFunc)add_author_to_tree_store, store,
-	    (I7AppExtensionFunc)add_extension_to_tree_store, store,
-	    (GDestroyNotify)gtk_tree_iter_free);
-	i7_app_foreach_installed_extension(app, TRUE,
-	    (I7AppAuthorFunc)add_author_to_tree_store, store,
-	    (I7AppExtensionFunc)add_builtin_extension_to_tree_store, store,
-	    (GDestroyNotify)gtk_tree_iter_free);
+	unsigned ix;
+	for(ix = 0; ix < paths->len; ix++) {
+		GtkTreeIter parent_iter, child_iter;
+		extension_path = g_ptr_array_index(paths, ix);
+		entry = g_hash_table_lookup(priv->extension_catalog, extension_path);
+
+		/* If the author was already indexed before, add the extension to it
+		instead of making a new entry */
+		if(!get_iter_for_author(model, entry->author, &parent_iter)) {
+			gtk_tree_store_append(store, &parent_iter, NULL);
+			gtk_tree_store_set(store, &parent_iter,
+				I7_APP_EXTENSION_TEXT, entry->author,
+				I7_APP_EXTENSION_READ_ONLY, TRUE,
+				I7_APP_EXTENSION_ICON, NULL,
+				I7_APP_EXTENSION_FILE, NULL,
+				-1);
+		}
+
+		/* Built-in extensions are only added if they are not overridden by a
+		user-installed extension */
+		if(entry->builtin && get_iter_for_extension_title(model, entry->title, &parent_iter, &child_iter))
+			continue;
+
+		GFile *extension_file = g_file_new_for_path(extension_path);
+		gtk_tree_store_append(store, &child_iter, &parent_iter);
+		gtk_tree_store_set(store, &child_iter,
+			I7_APP_EXTENSION_TEXT, entry->title, /* copies */
+			I7_APP_EXTENSION_VERSION, entry->version, /* copies */
+			I7_APP_EXTENSION_READ_ONLY, entry->builtin,
+			I7_APP_EXTENSION_ICON, entry->builtin? "inform7-builtin" : NULL,
+			I7_APP_EXTENSION_FILE, extension_file, /* references */
+			-1);
+		g_object_unref(extension_file);
+	}
+
+	g_ptr_array_free(paths, TRUE);
 
 	/* Rebuild the Open Extension menus */
 	i7_app_update_extensions_menu(app);
+}
+
+/* Helper function: make the results of a finished scan the current catalog */
+static void
+catalog_scan_apply(CatalogScan *scan)
+{
+	I7_APP_USE_PRIVATE(scan->app, priv);
+	g_hash_table_unref(priv->extension_catalog);
+	priv->extension_catalog = scan->new_catalog;
+	scan->new_catalog = NULL;
 
+	update_installed_extensions_tree(scan->app);
+	save_extension_catalog(scan->app, priv->extension_catalog);
+}
+
+static void start_catalog_scan(I7App *app);
+
+/* Idle function called when the worker thread has finished scanning. This is
+called with the GDK lock held. */
+static gboolean
+finish_catalog_scan(CatalogScan *scan)
+{
+	I7_APP_USE_PRIVATE(scan->app, priv);
+
+	g_thread_unref(priv->catalog_thread);
+	priv->catalog_thread = NULL;
+
+	/* If the extensions changed while we were scanning, then this result is
+	already out of date; scan again, starting from the new information */
+	if(priv->catalog_scan_pending) {
+		priv->catalog_scan_pending = FALSE;
+		g_hash_table_unref(priv->extension_catalog);
+		priv->extension_catalog = scan->new_catalog;
+		scan->new_catalog = NULL;
+		I7App *app = scan->app;
+		catalog_scan_free(scan);
+		start_catalog_scan(app);
+		return FALSE;
+	}
+
+	catalog_scan_apply(scan);
+	catalog_scan_free(scan);
 	return FALSE; /* one-shot idle function */
 }
 
-/* Start the compiler running the census of extensions. If @wait is FALSE, do it
- in the background. */
+/* Worker thread function for scanning the extensions directories */
+static gpointer
+catalog_scan_thread(CatalogScan *scan)
+{
+	catalog_scan_run(scan);
+	gdk_threads_add_idle((GSourceFunc)finish_catalog_scan, scan);
+	return NULL;
+}
+
+/* Start scanning the extensions directories in a worker thread, or make sure
+they are scanned again if a scan is already running */
+static void
+start_catalog_scan(I7App *app)
+{
+	I7_APP_USE_PRIVATE(app, priv);
+
+	if(priv->catalog_thread) {
+		priv->catalog_scan_pending = TRUE;
+		return;
+	}
+	CatalogScan *scan = catalog_scan_new(app);
+	priv->catalog_thread = g_thread_new("extension catalog", (GThreadFunc)catalog_scan_thread, scan);
+}
+
+/* Start the compiler running the census of extensions, and update the catalog
+of installed extensions. If @wait is FALSE, do it in the background. */
 void
 i7_app_run_census(I7App *app, gboolean wait)
 {
@@ -1142,12 +1449,20 @@ i7_app_run_census(I7App *app, gboolean wait)
 		g_spawn_sync(g_get_home_dir(), commandline, NULL, G_SPAWN_SEARCH_PATH
 			| G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
 			NULL, NULL, NULL, NULL, NULL, NULL);
-		update_installed_extensions_tree(app);
+
+		/* Any scan still running in the background is now out of date */
+		if(I7_APP_PRIVATE(app)->catalog_thread)
+			I7_APP_PRIVATE(app)->catalog_scan_pending = TRUE;
+
+		CatalogScan *scan = catalog_scan_new(app);
+		catalog_scan_run(scan);
+		catalog_scan_apply(scan);
+		catalog_scan_free(scan);
 	} else {
 		g_spawn_async(g_get_home_dir(), commandline, NULL, G_SPAWN_SEARCH_PATH
 			| G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
 			NULL, NULL, NULL, NULL);
-		g_idle_add((GSourceFunc)update_installed_extensions_tree, app);
+		start_catalog_scan(app);
 	}
 
 	g_strfreev(commandline);
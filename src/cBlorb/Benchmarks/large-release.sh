@@ -0,0 +1,90 @@
+#!/bin/bash
+### large-release.sh ################################################
+
+# Times cBlorb writing a blorb of about 500 MB: a 300 KB Glulx story
+# file and 20 pictures of 25 MB each. The sizes are odd, so the copy
+# never ends on a whole block. This is the release used to measure
+# the block-copying change in Chapter 2/Blorb Writer.w. On the machine
+# where it was first run, the time fell from about 4.2s to about 0.55s.
+#
+# Usage: large-release.sh CBLORB [CBLORB...]
+#
+# Give one or more cBlorb binaries, for example a build from before
+# and after a change. Each one blorbs the same resource set, and the
+# script checks that they all wrote identical blorb files. The files
+# go in a scratch directory, which is deleted afterwards. Set WORKDIR
+# to keep them. About 1 GB of free space is needed, plus 500 MB for
+# each binary after the first.
+
+if test $# -eq 0; then
+	echo "Usage: $0 CBLORB [CBLORB...]" >&2
+	exit 2
+fi
+
+PICTURES=20
+PICTURE_SIZE=26214400   # 25 MB
+
+if test -n "$WORKDIR"; then
+	mkdir -p "$WORKDIR" || exit 1
+	workdir=`cd "$WORKDIR" && pwd`
+else
+	workdir=`mktemp -d` || exit 1
+	trap 'rm -rf "$workdir"' EXIT
+fi
+
+### RESOURCE SET ####################################################
+# cBlorb only looks at the first few bytes of each file to find out
+# its type, so a PNG or Glulx header followed by random data will do.
+echo "Generating resource set in $workdir"
+png_header() {
+	printf '\211PNG\r\n\032\n\000\000\000\rIHDR'
+	printf '\000\000\000\100\000\000\000\060\010\002\000\000\000'
+}
+{
+	printf 'Glul'
+	head -c 300001 /dev/urandom
+} > "$workdir/story.ulx" || exit 1
+blurb="$workdir/release.blurb"
+{
+	echo "storyfile \"$workdir/story.ulx\" include"
+	echo 'author "cBlorb benchmark"'
+} > "$blurb"
+i=1
+while test $i -le $PICTURES; do
+	{
+		png_header
+		head -c `expr $PICTURE_SIZE + $i \* 7 - 29` /dev/urandom
+	} > "$workdir/p$i.png" || exit 1
+	echo "picture $i \"$workdir/p$i.png\"" >> "$blurb"
+	i=`expr $i + 1`
+done
+
+### TIMINGS #########################################################
+# Run each binary once unmeasured first, so the resources are in the
+# page cache for all of them.
+TIMEFORMAT='  %Rs real, %Us user, %Ss sys'
+n=0
+first=
+status=0
+for cblorb in "$@"; do
+	n=`expr $n + 1`
+	out="$workdir/out$n.gblorb"
+	"$cblorb" -unix "$blurb" "$out" > /dev/null 2>&1
+	echo "$cblorb:"
+	time "$cblorb" -unix "$blurb" "$out" > "$workdir/out$n.log" 2>&1
+	if test ! -s "$out"; then
+		echo "  no blorb file written; see $workdir/out$n.log" >&2
+		status=1
+		continue
+	fi
+	echo "  wrote `wc -c < "$out"` bytes"
+	if test -z "$first"; then
+		first="$out"
+	elif cmp -s "$first" "$out"; then
+		rm -f "$out"
+	else
+		echo "  blorb file differs from the first one" >&2
+		status=1
+	fi
+done
+exit $status
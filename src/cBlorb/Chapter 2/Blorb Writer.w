@@ -117,6 +117,25 @@ void s_one_byte(unsigned char *F, int n) {
 	F[0] = (unsigned char) (n)%0x100;
 }
 
+@ The contents of chunks, on the other hand, are copied across in large
+blocks, since a release with many pictures and sounds can run to hundreds of
+megabytes. The source file |F| must contain at least |n| bytes:
+
+@d COPY_BLOCK_SIZE 0x100000 /* one megabyte at a time */
+
+@c
+unsigned char copy_block[COPY_BLOCK_SIZE];
+
+void copy_bytes(FILE *F, FILE *T, int n, char *filename) {
+	while (n > 0) {
+		int block = (n < COPY_BLOCK_SIZE)?n:COPY_BLOCK_SIZE;
+		if (fread(copy_block, 1, (size_t) block, F) != (size_t) block)
+			fatal_fs("chunk ran out incomplete", filename);
+		fwrite(copy_block, 1, (size_t) block, T);
+		n -= block;
+	}
+}
+
 @p Chunks.
 Although chunks can be written in a nested way -- that's the whole point
 of IFF, in fact -- we will always be writing a very flat structure, in
@@ -540,23 +559,14 @@ so they come with ready-made headers.
 	FILE *CHUNKSUB = fopen(chunk->filename, "rb");
 	if (CHUNKSUB == NULL) fatal_fs("unable to read data", chunk->filename);
 	else {
-		int i;
-		for (i=0; i<bytes_to_copy; i++) {
-			int j = fgetc(CHUNKSUB);
-			if (j == EOF) fatal_fs("chunk ran out incomplete", chunk->filename);
-			one_byte(IFF, j);
-		}
+		copy_bytes(CHUNKSUB, IFF, bytes_to_copy, chunk->filename);
 		fclose(CHUNKSUB);
 	}
 
 @ And sometimes, for shorter things, they are in memory:
 
 @<Copy that many bytes from memory@> =
-	int i;
-	for (i=0; i<bytes_to_copy; i++) {
-		int j = (int) (chunk->data_in_memory[i]);
-		one_byte(IFF, j);
-	}
+	fwrite(chunk->data_in_memory, 1, (size_t) bytes_to_copy, IFF);
 
 @ For debugging purposes only:
 
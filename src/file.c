@@ -205,6 +205,7 @@ delete_build_files(I7Story *story)
 		delete_from_project_dir(story, storyname, "Build", "temporary file.inf");
 		delete_from_project_dir(story, storyname, "Build", "temporary file 2.inf");
 		delete_from_project_dir(story, storyname, "Build", "StatusCblorb.html");
+		delete_from_project_dir(story, storyname, "Build", "build-cache.ini");
 
 		if(g_settings_get_boolean(prefs, PREFS_CLEAN_INDEX_FILES)) {
 			delete_from_project_dir(story, storyname, "Index", "Actions.html");
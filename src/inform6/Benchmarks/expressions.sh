@@ -0,0 +1,96 @@
+#!/bin/bash
+### expressions.sh ##################################################
+
+# Times the Inform 6 expression parser on a source of 1,000,000
+# arithmetic and conditional expressions. This is the source used to
+# measure the change to growing the expression node and emitter
+# arrays on demand in expressp.c.
+#
+# Usage: expressions.sh INFORM6 [INFORM6...]
+#
+# Give one or more inform6 binaries, for example a build from before
+# and after a change. They must write a profile with +profile_name,
+# since the time reported is that of the parsing phase, which is when
+# expressions are parsed and code is generated for them. Each binary
+# compiles the same source to Glulx, and the script checks that they
+# all wrote identical story files. The files go in a scratch
+# directory, which is deleted afterwards. Set WORKDIR to keep them, or
+# EXPRESSIONS to change the number of expressions.
+
+if test $# -eq 0; then
+	echo "Usage: $0 INFORM6 [INFORM6...]" >&2
+	exit 2
+fi
+
+EXPRESSIONS=${EXPRESSIONS:-1000000}
+PER_ROUTINE=1000
+
+if test -n "$WORKDIR"; then
+	mkdir -p "$WORKDIR" || exit 1
+	workdir=`cd "$WORKDIR" && pwd`
+else
+	workdir=`mktemp -d` || exit 1
+	trap 'rm -rf "$workdir"' EXIT
+fi
+
+### SOURCE ##########################################################
+# The expressions take turns from a few shapes: assignments with
+# nested brackets and every arithmetic operator, and conditions mixing
+# comparisons with && and ||. The constants vary, so the code is not
+# all the same. They are split into routines of PER_ROUTINE
+# expressions each, which Main calls in turn.
+echo "Generating $EXPRESSIONS expressions in $workdir"
+awk -v expressions="$EXPRESSIONS" -v per_routine="$PER_ROUTINE" 'BEGIN {
+	print "Global total;"
+	routines = 0
+	for (n = 0; n < expressions; n++) {
+		if (n % per_routine == 0) {
+			if (n > 0) print "    return a + b + c;\n];"
+			printf "[ R%d a b c;\n    a = %d; b = %d; c = 1;\n", routines++, n % 97, n % 89 + 1
+		}
+		k = n % 5 + 1
+		if (n % 4 == 0)
+			printf "    a = (a + %d) * (b - c) / %d + b %% %d;\n", n % 1000, k, k
+		else if (n % 4 == 1)
+			printf "    if (a > %d && (b < c || c ~= %d)) b = b + a - %d;\n", n % 500, k, k
+		else if (n % 4 == 2)
+			printf "    c = -(a * %d - (b + c * (a - %d))) & $7FFF | %d;\n", k, n % 300, n % 64
+		else
+			printf "    if ((a == b || b >= %d) && ~~(c < 0)) c = c + 1; else a = b - %d;\n", n % 700, k
+	}
+	if (expressions > 0) print "    return a + b + c;\n];"
+	print "[ Main;"
+	for (i = 0; i < routines; i++)
+		printf "    total = total + R%d();\n", i
+	print "    print total, \"^\";\n];"
+}' > "$workdir/expressions.inf" || exit 1
+
+### TIMINGS #########################################################
+TIMEFORMAT='  %Rs real, %Us user, %Ss sys'
+n=0
+first=
+status=0
+for inform6 in "$@"; do
+	n=`expr $n + 1`
+	out="$workdir/out$n.ulx"
+	profile="$workdir/out$n.json"
+	echo "$inform6:"
+	time "$inform6" -G +profile_name="$profile" \
+		"$workdir/expressions.inf" "$out" > "$workdir/out$n.log" 2>&1
+	if test ! -s "$out"; then
+		echo "  no story file written; see $workdir/out$n.log" >&2
+		status=1
+		continue
+	fi
+	sed -n 's/.*"phase": "parsing", "seconds": \([0-9.]*\).*/  parsing phase: \1s/p' "$profile"
+	echo "  wrote `wc -c < "$out"` bytes"
+	if test -z "$first"; then
+		first="$out"
+	elif cmp -s "$first" "$out"; then
+		rm -f "$out"
+	else
+		echo "  story file differs from the first one" >&2
+		status=1
+	fi
+done
+exit $status
@@ -0,0 +1,84 @@
+#!/bin/bash
+### sorted-dictionary.sh ############################################
+
+# Times Inform 6 compiling a source that adds 30,000 dictionary words
+# in sorted order, which is the order Inform 7 tends to generate them
+# in. This is the source used to measure the change from a tree to a
+# hash table for looking up dictionary words in text.c.
+#
+# Usage: sorted-dictionary.sh INFORM6 [INFORM6...]
+#
+# Give one or more inform6 binaries, for example a build from before
+# and after a change. Each one compiles the same source to Glulx, and
+# the script checks that they all wrote identical story files. The
+# files go in a scratch directory, which is deleted afterwards. Set
+# WORKDIR to keep them, or WORDS to change the number of words. The
+# memory settings an older compiler needs are given on its command
+# line; since the tables grow on demand, newer ones ignore them.
+
+if test $# -eq 0; then
+	echo "Usage: $0 INFORM6 [INFORM6...]" >&2
+	exit 2
+fi
+
+WORDS=${WORDS:-30000}
+
+if test -n "$WORKDIR"; then
+	mkdir -p "$WORKDIR" || exit 1
+	workdir=`cd "$WORKDIR" && pwd`
+else
+	workdir=`mktemp -d` || exit 1
+	trap 'rm -rf "$workdir"' EXIT
+fi
+
+### SOURCE ##########################################################
+# The words are four letters long, counting up from 'baaa', so every
+# one is new and comes after the one before; there are enough for
+# WORDS up to 400,000. They are listed in an array, ten to a line, so
+# that the story file depends on all of them.
+echo "Generating $WORDS dictionary words in $workdir"
+awk -v words="$WORDS" 'BEGIN {
+	letters = "abcdefghijklmnopqrstuvwxyz"
+	printf "Array words --> %d", words
+	for (n = 0; n < words; n++) {
+		w = ""
+		k = n
+		for (i = 0; i < 3; i++) {
+			w = substr(letters, k % 26 + 1, 1) w
+			k = int(k / 26)
+		}
+		w = substr(letters, k + 2, 1) w
+		printf "%s'\''%s'\''", (n % 10 == 0)? "\n    " : " ", w
+	}
+	print ";"
+	print "[ Main; print words-->1, \"^\"; ];"
+}' > "$workdir/words.inf" || exit 1
+
+### TIMINGS #########################################################
+TIMEFORMAT='  %Rs real, %Us user, %Ss sys'
+n=0
+first=
+status=0
+for inform6 in "$@"; do
+	n=`expr $n + 1`
+	out="$workdir/out$n.ulx"
+	echo "$inform6:"
+	time "$inform6" -G '$MAX_DICT_ENTRIES='"$WORDS" \
+		'$MAX_STATIC_DATA='`expr $WORDS \* 8` \
+		"$workdir/words.inf" "$out" > "$workdir/out$n.log" 2>&1
+	if test ! -s "$out"; then
+		echo "  no story file written; see $workdir/out$n.log" >&2
+		status=1
+		continue
+	fi
+	echo "  wrote `wc -c < "$out"` bytes"
+	if test -z "$first"; then
+		first="$out"
+	elif cmp -s "$first" "$out"; then
+		rm -f "$out"
+	else
+		echo "  story file differs from the first one" >&2
+		status=1
+	fi
+done
+exit $status
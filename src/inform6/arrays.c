@@ -56,6 +56,31 @@ static int array_entry_size,           /* 1 for byte array, 2 for word array */
                                        /* In Glulx, of course, that will be
                                           4 instead of 2.                    */
 
+/* ------------------------------------------------------------------------- */
+/*   The dynamic array area, and the tables of arrays, grow as needed:      */
+/*   MAX_STATIC_DATA and MAX_ARRAYS record how much has been allocated.      */
+/* ------------------------------------------------------------------------- */
+
+extern void ensure_dynamic_array_area(int32 size)
+{   int32 n;
+    if (size <= MAX_STATIC_DATA) return;
+    n = grown_memory_size(MAX_STATIC_DATA, size);
+    my_regrow(&dynamic_array_area, sizeof(int), MAX_STATIC_DATA, n,
+        "static data");
+    MAX_STATIC_DATA = n;
+}
+
+static void ensure_array_tables(void)
+{   int32 n;
+    if (no_arrays < MAX_ARRAYS) return;
+    n = grown_memory_size(MAX_ARRAYS, no_arrays+1);
+    my_regrow(&array_sizes, sizeof(int), MAX_ARRAYS, n, "array sizes");
+    my_regrow(&array_types, sizeof(int), MAX_ARRAYS, n, "array types");
+    my_regrow(&array_symbols, sizeof(int32), MAX_ARRAYS, n,
+        "array symbols");
+    MAX_ARRAYS = n;
+}
+
 extern void finish_array(int32 i)
 {
     /*  Write the array size into the 0th byte/word of the array, if it's
@@ -105,8 +130,7 @@ extern void array_entry(int32 i, assembly_operand VAL)
   if (!glulx_mode) {
     /*  Array entry i (initial entry has i=0) is set to Z-machine value j    */
 
-    if (dynamic_array_area_size+(i+1)*array_entry_size > MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_dynamic_array_area(dynamic_array_area_size+(i+1)*array_entry_size);
 
     if (array_entry_size==1)
     {   dynamic_array_area[dynamic_array_area_size+i] = (VAL.value)%256;
@@ -131,8 +155,7 @@ extern void array_entry(int32 i, assembly_operand VAL)
   else {
     /*  Array entry i (initial entry has i=0) is set to value j              */
 
-    if (dynamic_array_area_size+(i+1)*array_entry_size > MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_dynamic_array_area(dynamic_array_area_size+(i+1)*array_entry_size);
 
     if (array_entry_size==1)
     {   dynamic_array_area[dynamic_array_area_size+i] = (VAL.value) & 0xFF;
@@ -241,8 +264,7 @@ extern void make_global(int array_flag, int name_only)
         else
             assign_symbol(i, 
                 dynamic_array_area_size - 4*MAX_GLOBAL_VARIABLES, ARRAY_T);
-        if (no_arrays == MAX_ARRAYS)
-            memoryerror("MAX_ARRAYS", MAX_ARRAYS);
+        ensure_array_tables();
         array_symbols[no_arrays] = i;
     }
     else
@@ -412,6 +434,7 @@ extern void make_global(int array_flag, int name_only)
         dynamic_array_area_size += array_entry_size;
     if (array_type==BUFFER_ARRAY)
         dynamic_array_area_size += WORDSIZE;
+    ensure_dynamic_array_area(dynamic_array_area_size);
     array_types[no_arrays] = array_type;
 
     switch(data_type)
@@ -597,6 +620,7 @@ extern int32 begin_table_array(void)
     /*  Leave room to write the array size in later                          */
 
     dynamic_array_area_size += array_entry_size;
+    ensure_dynamic_array_area(dynamic_array_area_size);
 
     if (!glulx_mode)
         return array_base;
@@ -635,6 +659,7 @@ extern void arrays_begin_pass(void)
     else
         no_globals=11;
     dynamic_array_area_size = WORDSIZE * MAX_GLOBAL_VARIABLES;
+    ensure_dynamic_array_area(dynamic_array_area_size);
 }
 
 extern void arrays_allocate_arrays(void)
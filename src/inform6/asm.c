@@ -80,6 +80,18 @@ static int routine_locals;         /* The number of local variables used by
 static int32 routine_start_pc;
 
 int32 *named_routine_symbols;
+static int32 named_routine_symbols_size; /* calloced size */
+
+static void note_named_routine(int32 symbol)
+{   if (no_named_routines >= named_routine_symbols_size)
+    {   int32 n = grown_memory_size(named_routine_symbols_size,
+            no_named_routines+1);
+        my_regrow(&named_routine_symbols, sizeof(int32),
+            named_routine_symbols_size, n, "named routine symbols");
+        named_routine_symbols_size = n;
+    }
+    named_routine_symbols[no_named_routines++] = symbol;
+}
 
 static void transfer_routine_z(void);
 static void transfer_routine_g(void);
@@ -88,11 +100,12 @@ static void transfer_routine_g(void);
 /*   Label data                                                              */
 /* ------------------------------------------------------------------------- */
 
-static int first_label, last_label;
-static int32 *label_offsets;       /* Double-linked list of label offsets    */
-static int   *label_next,          /* (i.e. zmachine_pc values) in PC order  */
-             *label_prev;
+static int32 *label_offsets;       /* Label offsets (i.e. zmachine_pc values)*/
+static int   *label_order;         /* Label numbers in the order set, which
+                                      is PC order                            */
+static int    no_labels_set;       /* Number of entries in label_order       */
 static int32 *label_symbols;       /* Symbol numbers if defined in source    */
+static int32 *relaxed_offsets;     /* Workspace for relax_branches()         */
 
 static int   *sequence_point_labels;
                                    /* Label numbers for each                 */
@@ -100,24 +113,76 @@ static debug_location *sequence_point_locations;
                                    /* Source code references for each        */
                                    /* (used for making debugging file)       */
 
+static void ensure_label_capacity(int32 count)
+{   /*  MAX_LABELS is the number of labels the arrays have room for: grow
+        them, and the sequence point arrays (there are never more sequence
+        points than labels), to hold at least count  */
+
+    int32 n;
+    if (count <= MAX_LABELS) return;
+    n = grown_memory_size(MAX_LABELS, count);
+    my_regrow(&label_offsets, sizeof(int32), MAX_LABELS, n, "label offsets");
+    my_regrow(&label_symbols, sizeof(int32), MAX_LABELS, n, "label symbols");
+    my_regrow(&label_order, sizeof(int), MAX_LABELS, n, "label order");
+    my_regrow(&relaxed_offsets, sizeof(int32), MAX_LABELS, n,
+        "relaxed label offsets");
+    my_regrow(&sequence_point_labels, sizeof(int), MAX_LABELS, n,
+        "sequence point labels");
+    my_regrow(&sequence_point_locations, sizeof(debug_location),
+        MAX_LABELS, n, "sequence point locations");
+    MAX_LABELS = n;
+}
+
 static void set_label_offset(int label, int32 offset)
 {
-    if (label >= MAX_LABELS) memoryerror("MAX_LABELS", MAX_LABELS);
+    ensure_label_capacity(label+1);
 
     label_offsets[label] = offset;
-    if (last_label == -1)
-    {   label_prev[label] = -1;
-        first_label = label;
-    }
-    else
-    {   label_prev[label] = last_label;
-        label_next[last_label] = label;
-    }
-    last_label = label;
-    label_next[label] = -1;
+    label_order[no_labels_set++] = label;
     label_symbols[label] = -1;
 }
 
+/* ------------------------------------------------------------------------- */
+/*   Branch points: every branch (and, in Z-code, every jump) in the routine */
+/*   being assembled, in holding area order, with the label it goes to and   */
+/*   how many bytes its operand will take.  Keeping the label numbers here,  */
+/*   rather than in the operand bytes, means there is no limit on the        */
+/*   number of labels in a routine.                                          */
+/* ------------------------------------------------------------------------- */
+
+#define JUMP_FORM 0                /* A Z-code jump: always 2 bytes          */
+#define REMOVED_FORM (-1)          /* A jump deleted by the peephole stage   */
+#define JUMP_LEAD ((glulx_mode)?2:1) /* Bytes of a jump before its operand   */
+
+static int32 *branch_point_at;     /* Holding area index of the operand      */
+static int32 *branch_point_label;
+static int   *branch_point_form;   /* Operand size in bytes, or JUMP_FORM    */
+static int32 *branch_point_first_label; /* The label as assembled, and the   */
+static int   *branch_point_plain_form;  /* form chosen for it, both kept by  */
+                                        /* the peephole stage                */
+static int32 no_branch_points, branch_points_size;
+
+static void add_branch_point(int32 at, int32 label, int form)
+{   if (no_branch_points == branch_points_size)
+    {   int32 n = grown_memory_size(branch_points_size, no_branch_points+1);
+        my_regrow(&branch_point_at, sizeof(int32), branch_points_size, n,
+            "branch point offsets");
+        my_regrow(&branch_point_label, sizeof(int32), branch_points_size, n,
+            "branch point labels");
+        my_regrow(&branch_point_form, sizeof(int), branch_points_size, n,
+            "branch point forms");
+        my_regrow(&branch_point_first_label, sizeof(int32),
+            branch_points_size, n, "branch point first labels");
+        my_regrow(&branch_point_plain_form, sizeof(int),
+            branch_points_size, n, "branch point plain forms");
+        branch_points_size = n;
+    }
+    branch_point_at[no_branch_points] = at;
+    branch_point_label[no_branch_points] = label;
+    branch_point_form[no_branch_points] = form;
+    no_branch_points++;
+}
+
 /* ------------------------------------------------------------------------- */
 /*   Useful tool for building operands                                       */
 /* ------------------------------------------------------------------------- */
@@ -263,9 +328,26 @@ extern void print_operand(assembly_operand o)
 /*   Writing bytes to the code area                                          */
 /* ------------------------------------------------------------------------- */
 
+static void ensure_zcode_holding_area(int32 size)
+{   int32 n;
+    if (size <= MAX_ZCODE_SIZE) return;
+    n = grown_memory_size(MAX_ZCODE_SIZE, size);
+    my_recalloc(&zcode_holding_area, sizeof(uchar), MAX_ZCODE_SIZE, n,
+        "compiled routine code area");
+    my_recalloc(&zcode_markers, sizeof(uchar), MAX_ZCODE_SIZE, n,
+        "compiled routine code markers");
+    MAX_ZCODE_SIZE = n;
+}
+
+/*  The instruction assemblers keep pointers into the holding area while
+    they work, so they reserve this much room before starting on each
+    instruction (which is more than the longest instruction, text aside)
+    and byteout() never needs to move the area  */
+
+#define MAX_INSTRUCTION_BYTES 64
+
 static void byteout(int32 i, int mv)
-{   if (zcode_ha_size >= MAX_ZCODE_SIZE)
-        memoryerror("MAX_ZCODE_SIZE",MAX_ZCODE_SIZE);
+{   ensure_zcode_holding_area(zcode_ha_size+1);
     zcode_markers[zcode_ha_size] = (uchar) mv;
     zcode_holding_area[zcode_ha_size++] = (uchar) i;
     zmachine_pc++;
@@ -797,10 +879,10 @@ extern void assemblez_instruction(assembly_instruction *AI)
     if (sequence_point_follows)
     {   sequence_point_follows = FALSE; at_seq_point = TRUE;
         if (debugfile_switch)
-        {   sequence_point_labels[next_sequence_point] = next_label;
+        {   set_label_offset(next_label, zmachine_pc);
+            sequence_point_labels[next_sequence_point] = next_label++;
             sequence_point_locations[next_sequence_point] =
                 statement_debug_location;
-            set_label_offset(next_label++, zmachine_pc);
         }
         next_sequence_point++;
     }
@@ -827,6 +909,8 @@ extern void assemblez_instruction(assembly_instruction *AI)
 
     /* 1. Write the opcode byte(s) */
 
+    ensure_zcode_holding_area(zcode_ha_size + MAX_INSTRUCTION_BYTES
+        + ((operand_rules==TEXT)?translated_text_size_bound(AI->text):0));
     start_pc = zcode_holding_area + zcode_ha_size;
 
     switch(opco.no)
@@ -848,7 +932,8 @@ extern void assemblez_instruction(assembly_instruction *AI)
 
     if (operand_rules==LABEL)
     {   j = (AI->operand[0]).value;
-        byteout(j/256, LABEL_MV); byteout(j%256, 0);
+        add_branch_point(zcode_ha_size, j, JUMP_FORM);
+        byteout((j/256)%256, LABEL_MV); byteout(j%256, 0);
         goto Instruction_Done;
     }
 
@@ -856,7 +941,7 @@ extern void assemblez_instruction(assembly_instruction *AI)
     {   int32 i;
         uchar *tmp = translate_text(zcode_holding_area + zcode_ha_size, zcode_holding_area+MAX_ZCODE_SIZE, AI->text);
         if (!tmp)
-            memoryerror("MAX_ZCODE_SIZE", MAX_ZCODE_SIZE);
+            compiler_error("Text overflowed the compiled routine code area");
         j = subtract_pointers(tmp, (zcode_holding_area + zcode_ha_size));
         for (i=0; i<j; i++) zcode_markers[zcode_ha_size++] = 0;
         zmachine_pc += j;
@@ -953,9 +1038,11 @@ extern void assemblez_instruction(assembly_instruction *AI)
                 long_form = 1; addr = AI->branch_label_number;
                 break;
         }
-        if (addr > 0x7fff) fatalerror("Too many branch points in routine.");
         if (long_form==1)
-        {   byteout(branch_on_true*0x80 + addr/256, BRANCH_MV);
+        {   /*  The label number is kept as a branch point: the low bits
+                written here are only for the benefit of assembly traces  */
+            add_branch_point(zcode_ha_size, addr, 2);
+            byteout(branch_on_true*0x80 + (addr/256)%128, BRANCH_MV);
             byteout(addr%256, 0);
         }
         else
@@ -1103,10 +1190,10 @@ extern void assembleg_instruction(assembly_instruction *AI)
     if (sequence_point_follows)
     {   sequence_point_follows = FALSE; at_seq_point = TRUE;
         if (debugfile_switch)
-        {   sequence_point_labels[next_sequence_point] = next_label;
+        {   set_label_offset(next_label, zmachine_pc);
+            sequence_point_labels[next_sequence_point] = next_label++;
             sequence_point_locations[next_sequence_point] =
                 statement_debug_location;
-            set_label_offset(next_label++, zmachine_pc);
         }
         next_sequence_point++;
     }
@@ -1135,6 +1222,7 @@ extern void assembleg_instruction(assembly_instruction *AI)
 
     /* 1. Write the opcode byte(s) */
 
+    ensure_zcode_holding_area(zcode_ha_size + MAX_INSTRUCTION_BYTES);
     start_pc = zcode_holding_area + zcode_ha_size; 
 
     if (opco.code < 0x80) {
@@ -1390,7 +1478,8 @@ extern void assemble_label_no(int n)
 }
 
 extern void define_symbol_label(int symbol)
-{   label_symbols[svals[symbol]] = symbol;
+{   ensure_label_capacity(svals[symbol]+1);
+    label_symbols[svals[symbol]] = symbol;
 }
 
 extern int32 assemble_routine_header(int no_locals,
@@ -1463,7 +1552,8 @@ extern int32 assemble_routine_header(int no_locals,
       if (instruction_set_number<5)
           for (i=0; i<no_locals; i++) { byteout(0,0); byteout(0,0); }
 
-      next_label = 0; next_sequence_point = 0; last_label = -1;
+      next_label = 0; next_sequence_point = 0; no_labels_set = 0;
+      no_branch_points = 0;
 
       /*  Compile code to print out text like "a=3, b=4, c=5" when the       */
       /*  function is called, if it's required.                              */
@@ -1482,8 +1572,8 @@ extern int32 assemble_routine_header(int no_locals,
                 assemblez_2_branch(test_attr_zc, SLF, CON, ln2, FALSE);
             }
             else
-            {   i = no_named_routines++;
-                  named_routine_symbols[i] = the_symbol;
+            {   i = no_named_routines;
+                  note_named_routine(the_symbol);
                 CON.value = i/8; CON.type = LONG_CONSTANT_OT; CON.marker = 0;
                 RFA.value = routine_flags_array_SC;
                 RFA.type = LONG_CONSTANT_OT; RFA.marker = INCON_MV;
@@ -1545,7 +1635,8 @@ extern int32 assemble_routine_header(int no_locals,
         byteout(0x40, 0); byteout(0x98, 0); byteout(0x00, 0);
       }
 
-      next_label = 0; next_sequence_point = 0; last_label = -1; 
+      next_label = 0; next_sequence_point = 0; no_labels_set = 0;
+      no_branch_points = 0;
 
       if ((routine_asterisked) || (define_INFIX_switch)) {
         int ix;
@@ -1556,8 +1647,7 @@ extern int32 assemble_routine_header(int no_locals,
           if (embedded_flag) {
           }
           else {
-            i = no_named_routines++;
-            named_routine_symbols[i] = the_symbol;
+            note_named_routine(the_symbol);
           }
         }
         sprintf(fnt, "[ %s(", name);
@@ -1742,6 +1832,7 @@ void assemble_routine_end(int embedded_flag, debug_locations locations)
             dbnu_warning("Local variable", variable_name(i),
                 routine_starts_line);
 
+    ensure_label_capacity(next_label);
     for (i=0; i<next_label; i++)
     {   int j = label_symbols[i];
         if (j != -1)
@@ -1773,8 +1864,23 @@ void assemble_routine_end(int embedded_flag, debug_locations locations)
 
 static int32 adjusted_pc;
 
+/*  Bytes bound for temporary file 2 are gathered up and written out in
+    blocks, rather than with one fputc() each.                               */
+
+#define TRANSFER_BUFFER_SIZE 4096
+
+static uchar transfer_buffer[TRANSFER_BUFFER_SIZE];
+static int transfer_buffer_pos;
+
+static void flush_transfer_buffer(void)
+{   if (transfer_buffer_pos > 0)
+        fwrite(transfer_buffer, 1, transfer_buffer_pos, Temp2_fp);
+    transfer_buffer_pos = 0;
+}
+
 static void transfer_to_temp_file(uchar *c)
-{   fputc(*c,Temp2_fp);
+{   if (transfer_buffer_pos == TRANSFER_BUFFER_SIZE) flush_transfer_buffer();
+    transfer_buffer[transfer_buffer_pos++] = *c;
     adjusted_pc++;
 }
 
@@ -1782,79 +1888,317 @@ static void transfer_to_zcode_area(uchar *c)
 {   write_byte_to_memory_block(&zcode_area, adjusted_pc++, *c);
 }
 
-static void transfer_routine_z(void)
-{   int32 i, j, pc, new_pc, label, long_form, offset_of_next, addr,
-          branch_on_true, rstart_pc;
-    void (* transfer_byte)(uchar *);
+/* ------------------------------------------------------------------------- */
+/*   Branch relaxation.  A Z-code branch operand is 1 byte if the label is   */
+/*   a little way ahead, and 2 otherwise; a Glulx one is 1, 2 or 4 bytes,    */
+/*   depending on the distance.  Each routine is assembled with every branch */
+/*   at full size, and then relax_branches() chooses the sizes: it starts    */
+/*   every branch at 1 byte, and repeatedly lengthens any which can't reach  */
+/*   its label given the current sizes of all the others, until none need    */
+/*   lengthening.  Since branches only ever grow, distances only ever grow,  */
+/*   so this terminates (usually after two or three sweeps), and it finds    */
+/*   the smallest set of sizes which are consistent with each other.         */
+/* ------------------------------------------------------------------------- */
 
-    adjusted_pc = zmachine_pc - zcode_ha_size; rstart_pc = adjusted_pc;
+static int branch_fits(int32 addr, int form)
+{   if (!glulx_mode)
+    {   if (form == 1) return ((addr >= 2) && (addr < 64));
+        return TRUE;
+    }
+    if (form == 1) return ((addr >= -0x80) && (addr < 0x80));
+    if (form == 2) return ((addr >= -0x8000) && (addr < 0x8000));
+    return TRUE;
+}
 
-    if (asm_trace_level >= 3)
-    {   printf("Backpatching routine at %05lx: initial size %d, %d labels\n",
-             (long int) adjusted_pc, zcode_ha_size, next_label);
+static int32 branch_point_saving(int32 b, int full_form)
+{   /*  How many bytes smaller than at assembly is branch point b?  */
+    switch (branch_point_form[b])
+    {   case JUMP_FORM:    return 0;
+        case REMOVED_FORM: return JUMP_LEAD + full_form;
     }
+    return full_form - branch_point_form[b];
+}
 
-    transfer_byte =
-        (temporary_files_switch)?transfer_to_temp_file:transfer_to_zcode_area;
+static int32 choose_branch_forms(int32 start_pc, int full_form)
+{   /*  Sets branch_point_form[] for every branch (leaving jumps, and
+        removed jumps, alone) and returns how many bytes smaller than at
+        assembly the routine will then be  */
 
-    /*  (1) Scan through for branches and make short/long decisions in each
-            case.  Mark omitted bytes (2nd bytes in branches converted to
-            short form) with DELETED_MV.                                     */
+    int32 b, i, shrinkage, new_at, addr;
+    int changed, label;
 
-    for (i=0, pc=adjusted_pc; i<zcode_ha_size; i++, pc++)
-    {   if (zcode_markers[i] == BRANCH_MV)
-        {   if (asm_trace_level >= 4)
-                printf("Branch detected at offset %04x\n", pc);
-            j = (256*zcode_holding_area[i] + zcode_holding_area[i+1]) & 0x7fff;
-            if (asm_trace_level >= 4)
-                printf("To label %d, which is %d from here\n",
-                    j, label_offsets[j]-pc);
-            if ((label_offsets[j] >= pc+2) && (label_offsets[j] < pc+64))
-            {   if (asm_trace_level >= 4) printf("Short form\n");
-                zcode_markers[i+1] = DELETED_MV;
+    for (b=0; b<no_branch_points; b++)
+        if ((branch_point_form[b] != JUMP_FORM)
+            && (branch_point_form[b] != REMOVED_FORM))
+            branch_point_form[b] = 1;
+
+    do
+    {   /*  Where would the labels be, with the branches at these sizes?  */
+
+        for (i=0; i<next_label; i++) relaxed_offsets[i] = label_offsets[i];
+        for (i=0, b=0, shrinkage=0; i<no_labels_set; i++)
+        {   label = label_order[i];
+            if ((b > 0)
+                && (start_pc + branch_point_at[b-1] >= label_offsets[label]))
+            {   b = 0; shrinkage = 0;  /* A label set twice: start again */
             }
+            while ((b < no_branch_points)
+                   && (start_pc + branch_point_at[b] < label_offsets[label]))
+            {   shrinkage += branch_point_saving(b, full_form);
+                b++;
+            }
+            relaxed_offsets[label] = label_offsets[label] - shrinkage;
+        }
+
+        /*  And can each branch reach its label from where it would be?
+            (Branches lengthened in this sweep take effect in the next, so
+            that every branch is judged by the same set of sizes.)  */
+
+        changed = FALSE;
+        for (b=0, shrinkage=0; b<no_branch_points; b++)
+        {   int form = branch_point_form[b];
+            if ((form == JUMP_FORM) || (form == REMOVED_FORM))
+            {   shrinkage += branch_point_saving(b, full_form);
+                continue;
+            }
+            new_at = start_pc + branch_point_at[b] - shrinkage;
+            addr = relaxed_offsets[branch_point_label[b]] - (new_at + form) + 2;
+            shrinkage += full_form - form;
+            if (!branch_fits(addr, form))
+            {   branch_point_form[b] = (form == 1)?2:full_form;
+                changed = TRUE;
+            }
+        }
+    } while (changed);
+
+    for (b=0, shrinkage=0; b<no_branch_points; b++)
+        shrinkage += branch_point_saving(b, full_form);
+    return shrinkage;
+}
+
+static void relax_branches(int32 start_pc, int full_form)
+{   int32 b, i;
+    int label;
+
+    choose_branch_forms(start_pc, full_form);
+
+    /*  Mark the bytes which the shorter branches, and the removed jumps,
+        don't need; drop the removed jumps from the table, so that it holds
+        only what will be transferred; and move the labels to their final
+        positions.  */
+
+    for (b=0, i=0; b<no_branch_points; b++)
+    {   int form = branch_point_form[b];
+        int32 j;
+        if (form == REMOVED_FORM)
+        {   for (j=-JUMP_LEAD; j<full_form; j++)
+                zcode_markers[branch_point_at[b]+j] = DELETED_MV;
+            continue;
         }
+        if (form != JUMP_FORM)
+            for (j=form; j<full_form; j++)
+                zcode_markers[branch_point_at[b]+j] = DELETED_MV;
+        branch_point_at[i] = branch_point_at[b];
+        branch_point_label[i] = branch_point_label[b];
+        branch_point_form[i] = form;
+        i++;
+    }
+    no_branch_points = i;
+
+    for (i=0; i<no_labels_set; i++)
+    {   label = label_order[i];
+        if (asm_trace_level >= 4)
+            printf("Position of L%d corrected from %04x to %04x\n",
+                label, label_offsets[label], relaxed_offsets[label]);
+        label_offsets[label] = relaxed_offsets[label];
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*   Peephole optimisation (switch -O).  Before the branches are relaxed,    */
+/*   two improvements are made to the routine in the holding area, using    */
+/*   only the branch point table:                                            */
+/*                                                                           */
+/*     (a) a branch or jump to a label at which there is a jump is sent      */
+/*         straight on to that jump's destination ("jump threading");        */
+/*     (b) a jump to the instruction immediately after it is removed.        */
+/*                                                                           */
+/*   A label at a removed jump stays where it is, which is then the start    */
+/*   of the next instruction, so it still means the same.  Branches are      */
+/*   only threaded to labels they could reach at full size, so relaxation    */
+/*   can never find one out of range; but a farther label may need a longer  */
+/*   form than the branch had before, so any threaded branch which would be  */
+/*   longer is put back as it was, and the sizes chosen again, until none    */
+/*   is.  The routine is therefore never made longer by -O.                  */
+/* ------------------------------------------------------------------------- */
+
+int32 peephole_jumps_removed,       /* Kept for statistics purposes only      */
+      peephole_branches_threaded,
+      peephole_bytes_saved;
+
+static int is_jump_point(int32 b)
+{   int32 at = branch_point_at[b];
+    if (!glulx_mode)
+        return ((branch_point_form[b] == JUMP_FORM)
+                && (zcode_holding_area[at-1] == 0x8c));
+
+    /*  A Glulx branch operand which comes first after the mode byte is the
+        only operand, so the instruction must be a jump  */
+
+    return ((zcode_markers[at] == BRANCH_MV + 2)
+            && (zcode_holding_area[at-2] == 0x20));
+}
+
+static int32 jump_point_at(int32 x)
+{   /*  The branch point of the jump instruction starting at holding area
+        index x, or -1 if there isn't one  */
+
+    int32 lo = 0, hi = no_branch_points - 1, mid, at = x + JUMP_LEAD;
+    while (lo <= hi)
+    {   mid = (lo + hi)/2;
+        if (branch_point_at[mid] < at) lo = mid + 1;
+        else if (branch_point_at[mid] > at) hi = mid - 1;
+        else return (is_jump_point(mid))?mid:-1;
+    }
+    return -1;
+}
+
+static int label_within_reach(int32 b, int32 label, int32 start_pc)
+{   int32 addr = label_offsets[label] - (start_pc + branch_point_at[b]);
+    if (glulx_mode) return TRUE;
+    if (branch_point_form[b] == JUMP_FORM)
+        return ((addr >= -0x8000) && (addr < 0x8000));
+    return ((addr >= -0x2000) && (addr < 0x2000));
+}
+
+static void set_branch_label(int32 b, int32 label)
+{   int32 at = branch_point_at[b];
+    branch_point_label[b] = label;
+    if (glulx_mode)
+    {   zcode_holding_area[at]   = (label >> 24) & 0xFF;
+        zcode_holding_area[at+1] = (label >> 16) & 0xFF;
+        zcode_holding_area[at+2] = (label >> 8) & 0xFF;
+        zcode_holding_area[at+3] = label & 0xFF;
     }
+}
+
+static void remove_jumps_to_next(int32 start_pc, int full_form)
+{   /*  Marks as removed exactly those jumps which now go to the instruction
+        immediately after them  */
+
+    int32 b;
+    for (b=0; b<no_branch_points; b++)
+    {   if (branch_point_form[b] == REMOVED_FORM)
+            branch_point_form[b] = (glulx_mode)?full_form:JUMP_FORM;
+        if ((is_jump_point(b))
+            && (label_offsets[branch_point_label[b]]
+                == start_pc + branch_point_at[b] + full_form))
+            branch_point_form[b] = REMOVED_FORM;
+    }
+}
+
+static void peephole_optimise(int32 start_pc, int full_form)
+{   int32 b, k, label, hops, saving_before, saving_after;
+    int put_back;
 
-    /*  (2) Calculate the new positions of the labels.  Note that since the
-            long/short decision was taken on the basis of the old labels,
-            and since the new labels are slightly closer together because
-            of branch bytes deleted, there may be a few further branch
-            optimisations which are possible but which have been missed
-            (if two labels move inside the "short" range as a result of
-            a previous optimisation).  However, this is acceptably uncommon. */
+    /*  First, the sizes the branches would have without -O  */
+
+    saving_before = choose_branch_forms(start_pc, full_form);
+    for (b=0; b<no_branch_points; b++)
+    {   branch_point_first_label[b] = branch_point_label[b];
+        branch_point_plain_form[b] = branch_point_form[b];
+    }
 
-    if (next_label > 0)
-    {   if (asm_trace_level >= 4)
-        {   printf("Opening label: %d\n", first_label);
-            for (i=0;i<next_label;i++)
-                printf("Label %d offset %04x next -> %d previous -> %d\n",
-                    i, label_offsets[i], label_next[i], label_prev[i]);
+    for (b=0; b<no_branch_points; b++)
+    {   label = branch_point_label[b];
+        for (hops=0; hops<no_branch_points; hops++)
+        {   k = jump_point_at(label_offsets[label] - start_pc);
+            if ((k < 0) || (k == b) || (branch_point_label[k] == label)
+                || (!label_within_reach(b, branch_point_label[k], start_pc)))
+                break;
+            label = branch_point_label[k];
         }
+        if (label != branch_point_label[b]) set_branch_label(b, label);
+    }
 
-        for (i=0, pc=adjusted_pc, new_pc=adjusted_pc, label = first_label;
-            i<zcode_ha_size; i++, pc++)
-        {   while ((label != -1) && (label_offsets[label] == pc))
-            {   if (asm_trace_level >= 4)
-                    printf("Position of L%d corrected from %04x to %04x\n",
-                        label, label_offsets[label], new_pc);
-                label_offsets[label] = new_pc;
-                label = label_next[label];
+    do
+    {   remove_jumps_to_next(start_pc, full_form);
+        saving_after = choose_branch_forms(start_pc, full_form);
+        put_back = FALSE;
+        for (b=0; b<no_branch_points; b++)
+            if ((branch_point_label[b] != branch_point_first_label[b])
+                && (branch_point_form[b] != JUMP_FORM)
+                && (branch_point_form[b] != REMOVED_FORM)
+                && (branch_point_form[b] > branch_point_plain_form[b]))
+            {   set_branch_label(b, branch_point_first_label[b]);
+                put_back = TRUE;
             }
-           if (zcode_markers[i] != DELETED_MV) new_pc++;
+    } while (put_back);
+
+    if (saving_after < saving_before)
+    {   /*  Not expected, but -O must never cost anything  */
+        for (b=0; b<no_branch_points; b++)
+            set_branch_label(b, branch_point_first_label[b]);
+        remove_jumps_to_next(start_pc, full_form);
+        saving_after = choose_branch_forms(start_pc, full_form);
+    }
+
+    for (b=0; b<no_branch_points; b++)
+    {   if (branch_point_label[b] != branch_point_first_label[b])
+        {   if (asm_trace_level >= 4)
+                printf("Peephole: branch at offset %04x goes to label %d, \
+not %d\n", start_pc + branch_point_at[b], branch_point_label[b],
+                    branch_point_first_label[b]);
+            peephole_branches_threaded++;
         }
+        if (branch_point_form[b] == REMOVED_FORM)
+        {   if (asm_trace_level >= 4)
+                printf("Peephole: jump at offset %04x removed\n",
+                    start_pc + branch_point_at[b] - JUMP_LEAD);
+            peephole_jumps_removed++;
+        }
+    }
+    peephole_bytes_saved += saving_after - saving_before;
+}
+
+static void transfer_routine_z(void)
+{   int32 i, j, new_pc, long_form, offset_of_next, addr,
+          branch_on_true, rstart_pc, bp;
+    void (* transfer_byte)(uchar *);
+
+    adjusted_pc = zmachine_pc - zcode_ha_size; rstart_pc = adjusted_pc;
+
+    if (asm_trace_level >= 3)
+    {   printf("Backpatching routine at %05lx: initial size %d, %d labels\n",
+             (long int) adjusted_pc, zcode_ha_size, next_label);
+    }
+
+    transfer_byte =
+        (temporary_files_switch)?transfer_to_temp_file:transfer_to_zcode_area;
+
+    /*  (1) Decide which branches can be short, marking the omitted bytes
+            (2nd bytes in branches converted to short form) with DELETED_MV,
+            and calculate the new positions of the labels.                   */
+
+    if (asm_trace_level >= 4)
+    {   for (i=0; i<no_branch_points; i++)
+            printf("Branch at offset %04x to label %d\n",
+                adjusted_pc + branch_point_at[i], branch_point_label[i]);
     }
+    if (peephole_switch) peephole_optimise(adjusted_pc, 2);
+    relax_branches(adjusted_pc, 2);
 
-    /*  (3) As we are transferring, replace the label numbers in branch
+    /*  (2) As we are transferring, replace the label numbers in branch
             operands with offsets to those labels.  Also issue markers, now
             that we know where they occur in the final Z-code area.          */
 
-    for (i=0, new_pc=adjusted_pc; i<zcode_ha_size; i++)
+    for (i=0, new_pc=adjusted_pc, bp=0; i<zcode_ha_size; i++)
     {   switch(zcode_markers[i])
         { case BRANCH_MV:
-            long_form = 1; if (zcode_markers[i+1] == DELETED_MV) long_form = 0;
-
-            j = (256*zcode_holding_area[i] + zcode_holding_area[i+1]) & 0x7fff;
+            if ((bp >= no_branch_points) || (branch_point_at[bp] != i))
+                compiler_error("Branch point not where expected");
+            long_form = (branch_point_form[bp] == 2);
+            j = branch_point_label[bp++];
             branch_on_true = ((zcode_holding_area[i]) & 0x80);
             offset_of_next = new_pc + long_form + 1;
 
@@ -1869,7 +2213,7 @@ static void transfer_routine_z(void)
                 zcode_holding_area[i+1] = addr%256;
             }
             else
-            {   if (addr >= 64)
+            {   if ((addr < 2) || (addr >= 64))
                 {   compiler_error("Label out of range for branch");
                     printf("Addr is %04x\n", addr);
                 }
@@ -1879,7 +2223,9 @@ static void transfer_routine_z(void)
             break;
 
           case LABEL_MV:
-            j = 256*zcode_holding_area[i] + zcode_holding_area[i+1];
+            if ((bp >= no_branch_points) || (branch_point_at[bp] != i))
+                compiler_error("Jump point not where expected");
+            j = branch_point_label[bp++];
             addr = label_offsets[j] - new_pc;
             if (addr<-0x8000 || addr>0x7fff) 
                 fatalerror("Jump out of range: divide the routine up?");
@@ -1938,12 +2284,14 @@ static void transfer_routine_z(void)
             while ((adjusted_pc%scale_factor)!=0) transfer_byte(zero);
     }
 
+    if (temporary_files_switch) flush_transfer_buffer();
     zmachine_pc = adjusted_pc;
     zcode_ha_size = 0;
+    no_branch_points = 0;
 }
 
 static void transfer_routine_g(void)
-{   int32 i, j, pc, new_pc, label, form_len, offset_of_next, addr,
+{   int32 i, j, new_pc, form_len, offset_of_next, addr,
           rstart_pc;
     void (* transfer_byte)(uchar *);
 
@@ -1957,83 +2305,43 @@ static void transfer_routine_g(void)
     transfer_byte =
         (temporary_files_switch)?transfer_to_temp_file:transfer_to_zcode_area;
 
-    /*  (1) Scan through for branches and make short/long decisions in each
-            case.  Mark omitted bytes (bytes 2-4 in branches converted to
-            short form) with DELETED_MV.                                     */
+    /*  (1) Find the branches, decide on the size of each, marking omitted
+            bytes (bytes 2-4 in branches converted to short form) with
+            DELETED_MV, and calculate the new positions of the labels.       */
 
-    for (i=0, pc=adjusted_pc; i<zcode_ha_size; i++, pc++) {
+    no_branch_points = 0;
+    for (i=0; i<zcode_ha_size; i++) {
       if (zcode_markers[i] >= BRANCH_MV && zcode_markers[i] < BRANCHMAX_MV) {
-        int opmodeoffset = (zcode_markers[i] - BRANCH_MV);
-        int32 opmodebyte;
-        if (asm_trace_level >= 4)
-            printf("Branch detected at offset %04x\n", pc);
         j = ((zcode_holding_area[i] << 24) 
             | (zcode_holding_area[i+1] << 16)
             | (zcode_holding_area[i+2] << 8)
             | (zcode_holding_area[i+3]));
-        offset_of_next = pc + 4;
-        addr = (label_offsets[j] - offset_of_next) + 2;
         if (asm_trace_level >= 4)
-            printf("To label %d, which is (%d-2) = %d from here\n",
-                j, addr, label_offsets[j] - offset_of_next);
-        if (addr >= -0x80 && addr < 0x80) {
-            if (asm_trace_level >= 4) printf("...Byte form\n");
-            zcode_markers[i+1] = DELETED_MV;
-            zcode_markers[i+2] = DELETED_MV;
-            zcode_markers[i+3] = DELETED_MV;
-            opmodebyte = i - ((opmodeoffset+1)/2);
-            if ((opmodeoffset & 1) == 0)
-                zcode_holding_area[opmodebyte] = 
-                    (zcode_holding_area[opmodebyte] & 0xF0) | 0x01;
-            else
-                zcode_holding_area[opmodebyte] = 
-                    (zcode_holding_area[opmodebyte] & 0x0F) | 0x10;
-        }
-        else if (addr >= -0x8000 && addr < 0x8000) {
-            if (asm_trace_level >= 4) printf("...Short form\n");
-            zcode_markers[i+2] = DELETED_MV;
-            zcode_markers[i+3] = DELETED_MV;
-            opmodebyte = i - ((opmodeoffset+1)/2);
-            if ((opmodeoffset & 1) == 0)
-                zcode_holding_area[opmodebyte] = 
-                    (zcode_holding_area[opmodebyte] & 0xF0) | 0x02;
-            else
-                zcode_holding_area[opmodebyte] = 
-                    (zcode_holding_area[opmodebyte] & 0x0F) | 0x20;
-        }
+            printf("Branch at offset %04x to label %d\n", adjusted_pc+i, j);
+        add_branch_point(i, j, 4);
       }
     }
 
-    /*  (2) Calculate the new positions of the labels.  Note that since the
-            long/short decision was taken on the basis of the old labels,
-            and since the new labels are slightly closer together because
-            of branch bytes deleted, there may be a few further branch
-            optimisations which are possible but which have been missed
-            (if two labels move inside the "short" range as a result of
-            a previous optimisation).  However, this is acceptably uncommon. */
-    if (next_label > 0) {
-      if (asm_trace_level >= 4) {
-        printf("Opening label: %d\n", first_label);
-        for (i=0;i<next_label;i++)
-            printf("Label %d offset %04x next -> %d previous -> %d\n",
-                i, label_offsets[i], label_next[i], label_prev[i]);
-      }
-
-      for (i=0, pc=adjusted_pc, new_pc=adjusted_pc, label = first_label;
-        i<zcode_ha_size; 
-        i++, pc++) {
-        while ((label != -1) && (label_offsets[label] == pc)) {
-            if (asm_trace_level >= 4)
-                printf("Position of L%d corrected from %04x to %04x\n",
-                label, label_offsets[label], new_pc);
-            label_offsets[label] = new_pc;
-            label = label_next[label];
-        }
-        if (zcode_markers[i] != DELETED_MV) new_pc++;
-      }
+    if (peephole_switch) peephole_optimise(adjusted_pc, 4);
+    relax_branches(adjusted_pc, 4);
+
+    for (j=0; j<no_branch_points; j++) {
+      int form = branch_point_form[j];
+      int opmodeoffset;
+      int32 opmodebyte;
+      if (form == 4) continue;
+      i = branch_point_at[j];
+      opmodeoffset = (zcode_markers[i] - BRANCH_MV);
+      opmodebyte = i - ((opmodeoffset+1)/2);
+      if ((opmodeoffset & 1) == 0)
+          zcode_holding_area[opmodebyte] = 
+              (zcode_holding_area[opmodebyte] & 0xF0) | form;
+      else
+          zcode_holding_area[opmodebyte] = 
+              (zcode_holding_area[opmodebyte] & 0x0F) | (form << 4);
     }
 
-    /*  (3) As we are transferring, replace the label numbers in branch
+    /*  (2) As we are transferring, replace the label numbers in branch
             operands with offsets to those labels.  Also issue markers, now
             that we know where they occur in the final Z-code area.          */
 
@@ -2065,13 +2373,13 @@ static void transfer_routine_g(void)
                 ((form_len == 2) ? "short" : "long")));
         }
         if (form_len == 1) {
-            if (addr < -0x80 && addr >= 0x80) {
+            if (addr < -0x80 || addr >= 0x80) {
                 error("*** Label out of range for byte branch ***");
             }
         zcode_holding_area[i] = (addr) & 0xFF;
         }
         else if (form_len == 2) {
-            if (addr < -0x8000 && addr >= 0x8000) {
+            if (addr < -0x8000 || addr >= 0x8000) {
                 error("*** Label out of range for short branch ***");
             }
             zcode_holding_area[i] = (addr >> 8) & 0xFF;
@@ -2137,8 +2445,10 @@ static void transfer_routine_g(void)
              new_pc - rstart_pc);
     }
 
+    if (temporary_files_switch) flush_transfer_buffer();
     zmachine_pc = adjusted_pc;
     zcode_ha_size = 0;
+    no_branch_points = 0;
 }
 
 
@@ -3108,13 +3418,19 @@ extern void asm_begin_pass(void)
     no_sequence_points = 0;
     next_label = 0;
     next_sequence_point = 0;
+    no_labels_set = 0;
+    no_branch_points = 0;
     zcode_ha_size = 0;
+    peephole_jumps_removed = 0;
+    peephole_branches_threaded = 0;
+    peephole_bytes_saved = 0;
 }
 
 extern void init_asm_vars(void)
 {   int i;
 
     for (i=0;i<16;i++) flags2_requirements[i]=0;
+    transfer_buffer_pos = 0;
 
     uses_unicode_features = FALSE;
     uses_memheap_features = FALSE;
@@ -3137,8 +3453,9 @@ extern void asm_allocate_arrays(void)
 
     label_offsets = my_calloc(sizeof(int32), MAX_LABELS, "label offsets");
     label_symbols = my_calloc(sizeof(int32), MAX_LABELS, "label symbols");
-    label_next = my_calloc(sizeof(int), MAX_LABELS, "label dll 1");
-    label_prev = my_calloc(sizeof(int), MAX_LABELS, "label dll 1");
+    label_order = my_calloc(sizeof(int), MAX_LABELS, "label order");
+    relaxed_offsets
+        = my_calloc(sizeof(int32), MAX_LABELS, "relaxed label offsets");
     sequence_point_labels
         = my_calloc(sizeof(int), MAX_LABELS, "sequence point labels");
     sequence_point_locations
@@ -3151,6 +3468,7 @@ extern void asm_allocate_arrays(void)
 
     named_routine_symbols
         = my_calloc(sizeof(int32), MAX_SYMBOLS, "named routine symbols");
+    named_routine_symbols_size = MAX_SYMBOLS;
 }
 
 extern void asm_free_arrays(void)
@@ -3160,8 +3478,14 @@ extern void asm_free_arrays(void)
 
     my_free(&label_offsets, "label offsets");
     my_free(&label_symbols, "label symbols");
-    my_free(&label_next, "label dll 1");
-    my_free(&label_prev, "label dll 2");
+    my_free(&label_order, "label order");
+    my_free(&relaxed_offsets, "relaxed label offsets");
+    my_free(&branch_point_at, "branch point offsets");
+    my_free(&branch_point_label, "branch point labels");
+    my_free(&branch_point_form, "branch point forms");
+    my_free(&branch_point_first_label, "branch point first labels");
+    my_free(&branch_point_plain_form, "branch point plain forms");
+    branch_points_size = 0;
     my_free(&sequence_point_labels, "sequence point labels");
     my_free(&sequence_point_locations, "sequence point locations");
 
@@ -3169,6 +3493,7 @@ extern void asm_free_arrays(void)
     my_free(&zcode_markers, "compiled routine code markers");
 
     my_free(&named_routine_symbols, "named routine symbols");
+    my_free(&routine_name, "temporary copy of routine name");
     deallocate_memory_block(&zcode_area);
 }
 
@@ -186,6 +186,10 @@ static void make_iso_to_alphabet_grid(void)
                 zscii_to_alphabet_grid[i] = k + j*26;
                 iso_to_alphabet_grid[zscii_to_iso_grid[i]] = k + j*26;
             }
+
+    /*  Words already entered may now prepare differently                    */
+
+    forget_dictionary_memo();
 }
 
 extern void map_new_zchar(int32 unicode)
@@ -18,6 +18,17 @@ static char error_message_buff[ERROR_BUFLEN+4]; /* room for ellipsis */
 
 ErrorPosition ErrorReport;             /*  Maintained by "lexer.c"           */
 
+static char *error_source_name(void)
+{   int j = ErrorReport.file_number;
+    char *p;
+
+    if (j <= 0 || j > input_file) p = ErrorReport.source;
+    else p = InputFiles[j-1].filename;
+
+    if (!p) p = "";
+    return p;
+}
+
 static void print_preamble(void)
 {
     /*  Only really prints the preamble to an error or warning message:
@@ -27,14 +38,8 @@ static void print_preamble(void)
         The format is controllable (from an ICL switch) since this assists
         the working of some development environments.                        */
 
-    int j, with_extension_flag = FALSE; char *p;
-
-    j = ErrorReport.file_number;
-    if (j <= 0 || j > input_file) p = ErrorReport.source;
-    else p = InputFiles[j-1].filename;
+    int j, with_extension_flag = FALSE; char *p = error_source_name();
 
-    if (!p) p = "";
-    
     switch(error_format)
     {
         case 0:  /* RISC OS error message format */
@@ -61,6 +66,15 @@ static void print_preamble(void)
     }
 }
 
+#ifdef LIBRARY
+static void library_diagnostic(int kind, char *s)
+{   if ((library_callbacks == NULL) || (library_callbacks->diagnostic == NULL))
+        return;
+    library_callbacks->diagnostic(kind, error_source_name(),
+        ErrorReport.line_number, s, library_callbacks->data);
+}
+#endif
+
 static void ellipsize_error_message_buff(void)
 {
     /* If the error buffer was actually filled up by a message, it was
@@ -85,6 +99,10 @@ extern void fatalerror(char *s)
     throwback(0, s);
     throwback_end();
 #endif
+#ifdef LIBRARY
+    library_diagnostic(INFORM_FATAL_ERROR, s);
+    longjmp(library_fallback, 1);
+#endif
 #ifdef MAC_FACE
     close_all_source();
     if (temporary_files_switch) remove_temp_files();
@@ -159,6 +177,10 @@ static void message(int style, char *s)
 #ifdef ARC_THROWBACK
     throwback(throw_style, s);
 #endif
+#ifdef LIBRARY
+    library_diagnostic((style == 2)?INFORM_WARNING:
+        ((style == 4)?INFORM_COMPILER_ERROR:INFORM_ERROR), s);
+#endif
 #ifdef MAC_FACE
     ProcessEvents (&g_proc);
     if (g_proc != true)
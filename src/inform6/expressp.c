@@ -932,6 +932,11 @@ static int evaluate_term(token_data t, assembly_operand *o)
 
 /* --- Emitter ------------------------------------------------------------- */
 
+/*  The tree nodes, and the stacks used while building them, are reused
+    from one statement to the next: clear_expression_space() is called at
+    the start of each, and the arrays only ever grow, so that they soon
+    reach the size the source needs and no further allocation is done.    */
+
 expression_tree_node *ET;
 static int ET_used;
 
@@ -943,6 +948,33 @@ static assembly_operand *emitter_stack;
 static int *emitter_markers;
 static int *emitter_bracket_counts;
 
+static token_data *sr_stack;
+
+static void ensure_expression_space(int32 count)
+{   /*  MAX_EXPRESSION_NODES is the number of entries the tree and the
+        stacks have room for: grow them all to hold at least count  */
+
+    int32 n;
+    if (count <= MAX_EXPRESSION_NODES) return;
+    n = grown_memory_size(MAX_EXPRESSION_NODES, count);
+    my_regrow(&ET, sizeof(expression_tree_node), MAX_EXPRESSION_NODES, n,
+        "expression parse trees");
+    my_regrow(&emitter_markers, sizeof(int), MAX_EXPRESSION_NODES, n,
+        "emitter markers");
+    my_regrow(&emitter_bracket_counts, sizeof(int), MAX_EXPRESSION_NODES, n,
+        "emitter bracket layer counts");
+    my_regrow(&emitter_stack, sizeof(assembly_operand),
+        MAX_EXPRESSION_NODES, n, "emitter stack");
+    my_regrow(&sr_stack, sizeof(token_data), MAX_EXPRESSION_NODES, n,
+        "shift-reduce parser stack");
+    MAX_EXPRESSION_NODES = n;
+}
+
+static int new_expression_node(void)
+{   ensure_expression_space(ET_used+1);
+    return ET_used++;
+}
+
 #define FUNCTION_VALUE_MARKER 1
 #define ARGUMENT_VALUE_MARKER 2
 #define OR_VALUE_MARKER 3
@@ -986,8 +1018,7 @@ static void mark_top_of_emitter_stack(int marker, token_data t)
             return;
         }
         error_named("Missing operand for", t.text);
-        if (emitter_sp == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        ensure_expression_space(emitter_sp+1);
         emitter_markers[emitter_sp] = 0;
         emitter_bracket_counts[emitter_sp] = 0;
         emitter_stack[emitter_sp] = zero_operand;
@@ -1045,6 +1076,7 @@ static void emit_token(token_data t)
     {   if (stack_size < emitter_sp && emitter_bracket_counts[emitter_sp-stack_size-1])
         {   if (stack_size == 0)
             {   error("No expression between brackets '(' and ')'");
+                ensure_expression_space(emitter_sp+1);
                 emitter_stack[emitter_sp] = zero_operand;
                 emitter_markers[emitter_sp] = 0;
                 emitter_bracket_counts[emitter_sp] = 0;
@@ -1060,11 +1092,10 @@ static void emit_token(token_data t)
     }
 
     if (t.type != OP_TT)
-    {   emitter_markers[emitter_sp] = 0;
+    {   ensure_expression_space(emitter_sp+1);
+        emitter_markers[emitter_sp] = 0;
         emitter_bracket_counts[emitter_sp] = 0;
 
-        if (emitter_sp == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
         if (!evaluate_term(t, &(emitter_stack[emitter_sp++])))
             compiler_error_named("Emit token error:", t.text);
         return;
@@ -1136,8 +1167,7 @@ static void emit_token(token_data t)
         if (arity > stack_size)
         {   error_named("Missing operand for", t.text);
             while (arity > stack_size)
-            {   if (emitter_sp == MAX_EXPRESSION_NODES)
-                    memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            {   ensure_expression_space(emitter_sp+1);
                 emitter_markers[emitter_sp] = 0;
                 emitter_bracket_counts[emitter_sp] = 0;
                 emitter_stack[emitter_sp] = zero_operand;
@@ -1268,9 +1298,7 @@ static void emit_token(token_data t)
             }
     }
 
-    op_node_number = ET_used++;
-    if (op_node_number == MAX_EXPRESSION_NODES)
-        memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+    op_node_number = new_expression_node();
 
     ET[op_node_number].operator_number = t.value;
     ET[op_node_number].up = -1;
@@ -1289,9 +1317,7 @@ static void emit_token(token_data t)
         if (emitter_stack[i].type == EXPRESSION_OT)
             operand_node_number = emitter_stack[i].value;
         else
-        {   operand_node_number = ET_used++;
-            if (operand_node_number == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        {   operand_node_number = new_expression_node();
             ET[operand_node_number].down = -1;
             ET[operand_node_number].value = emitter_stack[i];
         }
@@ -1625,9 +1651,7 @@ static void insert_exp_to_cond(int n, int context)
 
     if (ET[n].down == -1)
     {   if (context==CONDITION_CONTEXT)
-        {   new = ET_used++;
-            if (new == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        {   new = new_expression_node();
             ET[new] = ET[n];
             ET[n].down = new; ET[n].operator_number = NONZERO_OP;
             ET[new].up = n; ET[new].right = -1;
@@ -1648,9 +1672,7 @@ static void insert_exp_to_cond(int n, int context)
         default:
             if (context != CONDITION_CONTEXT) break;
 
-            new = ET_used++;
-            if (new == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            new = new_expression_node();
             ET[new] = ET[n];
             ET[n].down = new; ET[n].operator_number = NONZERO_OP;
             ET[new].up = n; ET[new].right = -1;
@@ -1707,9 +1729,7 @@ static void func_args_on_stack(int n, int context)
               || ET[fnaddr].value.value == INDIRECT_SYSF
               || ET[fnaddr].value.value == GLK_SYSF))) {
         if (etoken_num_children(pn) > (unsigned int)(opnum == FCALL_OP ? 4:3)) {
-          new = ET_used++;
-          if (new == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+          new = new_expression_node();
           ET[new] = ET[n];
           ET[n].down = new; 
           ET[n].operator_number = PUSH_OP;
@@ -1730,9 +1750,7 @@ static assembly_operand check_conditions(assembly_operand AO, int context)
 
     if (AO.type != EXPRESSION_OT)
     {   if (context != CONDITION_CONTEXT) return AO;
-        n = ET_used++;
-        if (n == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        n = new_expression_node();
         ET[n].down = -1;
         ET[n].up = -1;
         ET[n].right = -1;
@@ -1753,7 +1771,6 @@ static assembly_operand check_conditions(assembly_operand AO, int context)
 /* --- Shift-reduce parser ------------------------------------------------- */
 
 static int sr_sp;
-static token_data *sr_stack;
 
 extern assembly_operand parse_expression(int context)
 {
@@ -1912,8 +1929,7 @@ extern assembly_operand parse_expression(int context)
 
             case LOWER_P:
             case EQUAL_P:
-                if (sr_sp == MAX_EXPRESSION_NODES)
-                    memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+                ensure_expression_space(sr_sp+1);
                 sr_stack[sr_sp++] = b;
                 switch(b.type)
                 {
@@ -52,7 +52,7 @@ static int filename_storage_left;
 
 typedef struct value_and_backpatch_position_struct
 {   int32 value;
-    fpos_t backpatch_position;
+    long backpatch_position;
 } value_and_backpatch_position;
 
 typedef struct debug_backpatch_accumulator_struct
@@ -88,6 +88,14 @@ char *realpath(const char *path, char *resolved_path)
 }
 #endif
 
+#ifdef LIBRARY
+/*  If the library host supplied the main source file as text, it is read   */
+/*  from there, and memory_source_left is -1 the rest of the time.          */
+
+static const char *memory_source_p;
+static long memory_source_left;
+#endif
+
 extern void load_sourcefile(char *filename_given, int same_directory_flag)
 {
     /*  Meaning: open a new file of Inform source.  (The lexer picks up on
@@ -97,12 +105,21 @@ extern void load_sourcefile(char *filename_given, int same_directory_flag)
 #ifdef HAS_REALPATH
     char absolute_name[PATHLEN];
 #endif
-    int x = 0;
+    int x = 0, from_memory = FALSE;
     FILE *handle;
 
     if (input_file == MAX_SOURCE_FILES)
         memoryerror("MAX_SOURCE_FILES", MAX_SOURCE_FILES);
 
+#ifdef LIBRARY
+    if ((input_file == 0) && (library_source_text != NULL))
+    {   translate_in_filename(0, name, filename_given, same_directory_flag, 1);
+        handle = NULL; from_memory = TRUE;
+        memory_source_p = library_source_text;
+        memory_source_left = library_source_length;
+    }
+    else
+#endif
     do
     {   x = translate_in_filename(x, name, filename_given, same_directory_flag,
                 (input_file==0)?1:0);
@@ -135,7 +152,7 @@ extern void load_sourcefile(char *filename_given, int same_directory_flag)
     }
 
     InputFiles[input_file].handle = handle;
-    if (InputFiles[input_file].handle==NULL)
+    if ((InputFiles[input_file].handle==NULL) && (!from_memory))
         fatalerror_named("Couldn't open source file", name);
 
     if (line_trace_level > 0) printf("\nOpening file \"%s\"\n",name);
@@ -177,6 +194,24 @@ extern int file_load_chars(int file_number, char *buffer, int length)
     if (file_number-1 > input_file)
     {   buffer[0] = 0; return 1; }
 
+#ifdef LIBRARY
+    if ((file_number == 1) && (memory_source_left >= 0))
+    {   read_in = (memory_source_left < length)?memory_source_left:length;
+        memcpy(buffer, memory_source_p, read_in);
+        memory_source_p += read_in; memory_source_left -= read_in;
+        total_chars_read += read_in;
+
+        if (read_in == length) return length;
+
+        memory_source_left = -1;
+        buffer[read_in]   = 0;
+        buffer[read_in+1] = 0;
+        buffer[read_in+2] = 0;
+        buffer[read_in+3] = 0;
+        return(-(read_in+4));
+    }
+#endif
+
     handle = InputFiles[file_number-1].handle;
     if (handle == NULL)
     {   buffer[0] = 0; return 1; }
@@ -206,11 +241,28 @@ extern int file_load_chars(int file_number, char *buffer, int length)
 
 /* ------------------------------------------------------------------------- */
 /*   Final assembly and output of the story file/module.                     */
+/*                                                                           */
+/*   Bytes are checksummed as they are put, but gathered up in sf_buffer     */
+/*   and written out SF_BUFFER_SIZE at a time, so that a story file goes     */
+/*   out in a handful of large fwrite()s.  Whole areas of memory are put     */
+/*   with sf_put_block(), and the temporary files (if they are in use) are   */
+/*   read back through a buffer of the same size.                            */
 /* ------------------------------------------------------------------------- */
 
+#define SF_BUFFER_SIZE 65536
+
 FILE *sf_handle;
 
-static void sf_put(int c)
+static uchar *sf_buffer;
+static int32 sf_buffer_pos;
+
+static void sf_flush(void)
+{   if (sf_buffer_pos > 0)
+        fwrite(sf_buffer, 1, sf_buffer_pos, sf_handle);
+    sf_buffer_pos = 0;
+}
+
+static void sf_checksum(int c)
 {
     if (!glulx_mode) {
 
@@ -250,8 +302,149 @@ static void sf_put(int c)
       checksum_count = (checksum_count+1) & 3;
       
     }
+}
 
-    fputc(c, sf_handle);
+static void sf_put(int c)
+{   sf_checksum(c);
+    if (sf_buffer_pos == SF_BUFFER_SIZE) sf_flush();
+    sf_buffer[sf_buffer_pos++] = c;
+}
+
+static void sf_put_block(uchar *p, int32 n)
+{   int32 i, k;
+    for (i=0; i<n; i++) sf_checksum(p[i]);
+    while (n > 0)
+    {   if (sf_buffer_pos == SF_BUFFER_SIZE) sf_flush();
+        k = SF_BUFFER_SIZE - sf_buffer_pos;
+        if (k > n) k = n;
+        memcpy(sf_buffer + sf_buffer_pos, p, k);
+        sf_buffer_pos += k; p += k; n -= k;
+    }
+}
+
+static void sf_put_memory_block(memory_block *MB, int32 from, int32 n)
+{   if (n <= 0) return;
+    if ((from < 0) || (from + n > MB->size))
+        compiler_error("Story file output ran past the end of a memory area");
+    sf_put_block(MB->data + from, n);
+}
+
+#ifdef LIBRARY
+/*  A library host which takes the story file itself is given it from a     */
+/*  scratch file, so that it can still be patched and read back as usual.  */
+
+static int story_file_to_host(void)
+{   return ((library_callbacks != NULL)
+            && (library_callbacks->story_file != NULL));
+}
+
+static void pass_story_file_to_host(void)
+{   long length;
+    uchar *image;
+
+    fseek(sf_handle, 0L, SEEK_END);
+    length = ftell(sf_handle);
+    image = my_malloc(length, "story file image");
+    fseek(sf_handle, 0L, SEEK_SET);
+    if (fread(image, 1, length, sf_handle) != (size_t) length)
+        fatalerror("I/O failure: couldn't read back story file");
+    library_callbacks->story_file(image, length, library_callbacks->data);
+    my_free(&image, "story file image");
+}
+#endif
+
+static char sf_name[PATHLEN];         /* Empty if sf_handle is a tmpfile() */
+
+static void open_story_file(char *new_name, char *mode)
+{
+    sf_name[0] = 0;
+#ifdef LIBRARY
+    if (story_file_to_host()) sf_handle = tmpfile(); else
+#endif
+    {   sf_handle = fopen(new_name, mode);
+        if (sf_handle != NULL) strcpy(sf_name, new_name);
+    }
+    if (sf_handle == NULL)
+        fatalerror_named("Couldn't open output file", new_name);
+    sf_buffer = my_malloc(SF_BUFFER_SIZE, "story file output buffer");
+    sf_buffer_pos = 0;
+}
+
+static void close_story_file(void)
+{
+#ifdef LIBRARY
+    if (story_file_to_host()) pass_story_file_to_host();
+#endif
+    fclose(sf_handle);
+    sf_handle = NULL;
+    my_free(&sf_buffer, "story file output buffer");
+}
+
+/*  After a fatal error, close the story file and remove what was written of
+    it, so that nothing mistakes a truncated story file for a good one.     */
+
+extern void abort_story_file(void)
+{   if (sf_handle == NULL) return;
+    fclose(sf_handle);
+    sf_handle = NULL;
+    if (sf_name[0] != 0) remove(sf_name);
+    my_free(&sf_buffer, "story file output buffer");
+}
+
+/*  Reading back a temporary file, from the start, SF_BUFFER_SIZE bytes at
+    a time: read_temp_file_byte() returns -1 at the end of the file.         */
+
+static FILE *tf_handle;
+static uchar *tf_buffer;
+static int32 tf_pos, tf_size;
+
+extern void begin_reading_temp_file(FILE *fp)
+{   if (tf_buffer == NULL)
+        tf_buffer = my_malloc(SF_BUFFER_SIZE, "temporary file input buffer");
+    fseek(fp, 0, SEEK_SET);
+    tf_handle = fp; tf_pos = 0; tf_size = 0;
+}
+
+static int32 fill_temp_file_buffer(void)
+{   if (tf_pos == tf_size)
+    {   tf_size = fread(tf_buffer, 1, SF_BUFFER_SIZE, tf_handle);
+        tf_pos = 0;
+    }
+    return tf_size - tf_pos;
+}
+
+extern int read_temp_file_byte(void)
+{   if (fill_temp_file_buffer() == 0) return -1;
+    return tf_buffer[tf_pos++];
+}
+
+static void sf_put_from_temp_file(int32 n, int put_flag, int file_number)
+{   int32 k;
+    while (n > 0)
+    {   k = fill_temp_file_buffer();
+        if (k == 0)
+        {   char error_message_buff[80];
+            sprintf(error_message_buff,
+                "I/O failure: couldn't read from temporary file %d",
+                file_number);
+            fatalerror(error_message_buff);
+        }
+        if (k > n) k = n;
+        if (put_flag) sf_put_block(tf_buffer + tf_pos, k);
+        tf_pos += k; n -= k;
+    }
+}
+
+static int code_byte(int32 j)
+{   if (temporary_files_switch) return read_temp_file_byte();
+    return read_byte_from_memory_block(&zcode_area, j);
+}
+
+static void sf_put_code(int32 from, int32 n, int use_function)
+{   if (temporary_files_switch)
+        sf_put_from_temp_file(n, use_function, 2);
+    else if (use_function)
+        sf_put_memory_block(&zcode_area, from, n);
 }
 
 /* Recursive procedure to generate the Glulx compression table. */
@@ -349,9 +542,7 @@ static void output_file_z(void)
 
     translate_out_filename(new_name, Code_Name);
 
-    sf_handle = fopen(new_name,"wb");
-    if (sf_handle == NULL)
-        fatalerror_named("Couldn't open output file", new_name);
+    open_story_file(new_name, "wb");
 
 #ifdef MAC_MPW
     /*  Set the type and creator to Andrew Plotkin's MaxZip, a popular
@@ -362,15 +553,13 @@ static void output_file_z(void)
 
     /*  (1)  Output the paged memory.                                        */
 
-    for (i=0;i<64;i++)
-        fputc(zmachine_paged_memory[i], sf_handle);
+    fwrite(zmachine_paged_memory, 1, 64, sf_handle);
     size = 64;
     checksum_low_byte = 0;
     checksum_high_byte = 0;
 
-    for (i=64; i<Write_Code_At; i++)
-    {   sf_put(zmachine_paged_memory[i]); size++;
-    }
+    sf_put_block(zmachine_paged_memory + 64, Write_Code_At - 64);
+    size = Write_Code_At;
 
     /*  (2)  Output the compiled code area.                                  */
 
@@ -379,6 +568,7 @@ static void output_file_z(void)
         fin=fopen(Temp2_Name,"rb");
         if (fin==NULL)
             fatalerror("I/O failure: couldn't reopen temporary file 2");
+        begin_reading_temp_file(fin);
     }
 
     if (!OMIT_UNUSED_ROUTINES) {
@@ -428,31 +618,20 @@ static void output_file_z(void)
         /* All code up until the next backpatch marker gets flushed out
            as-is. (Unless we're in a stripped-out function.) */
         while (j<offset) {
-            if (!use_function) {
-                while (j<offset && j<next_cons_check) {
-                    /* get dummy value */
-                    ((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
-            else {
-                while (j<offset && j<next_cons_check) {
-                    size++;
-                    sf_put((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
+            int32 upto = offset;
+            if (next_cons_check < (uint32) upto) upto = next_cons_check;
+            if (upto > j) {
+                sf_put_code(j, upto-j, use_function);
+                if (use_function) size += upto-j;
+                j = upto;
             }
             if (j == next_cons_check)
                 next_cons_check = df_next_function_iterate(&use_function);
         }
 
         if (long_flag)
-        {   int32 v = (temporary_files_switch)?fgetc(fin):
-                read_byte_from_memory_block(&zcode_area, j);
-            v = 256*v + ((temporary_files_switch)?fgetc(fin):
-                read_byte_from_memory_block(&zcode_area, j+1));
+        {   int32 v = code_byte(j);
+            v = 256*v + code_byte(j+1);
             j += 2;
             if (use_function) {
                 v = backpatch_value(v);
@@ -461,8 +640,7 @@ static void output_file_z(void)
             }
         }
         else
-        {   int32 v = (temporary_files_switch)?fgetc(fin):
-                read_byte_from_memory_block(&zcode_area, j);
+        {   int32 v = code_byte(j);
             j++;
             if (use_function) {
                 v = backpatch_value(v);
@@ -484,21 +662,12 @@ static void output_file_z(void)
        marker. */
     offset = zmachine_pc;
     while (j<offset) {
-        if (!use_function) {
-            while (j<offset && j<next_cons_check) {
-                /* get dummy value */
-                ((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
-        else {
-            while (j<offset && j<next_cons_check) {
-                size++;
-                sf_put((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
+        int32 upto = offset;
+        if (next_cons_check < (uint32) upto) upto = next_cons_check;
+        if (upto > j) {
+            sf_put_code(j, upto-j, use_function);
+            if (use_function) size += upto-j;
+            j = upto;
         }
         if (j == next_cons_check)
             next_cons_check = df_next_function_iterate(&use_function);
@@ -525,17 +694,17 @@ static void output_file_z(void)
         fin=fopen(Temp1_Name,"rb");
         if (fin==NULL)
             fatalerror("I/O failure: couldn't reopen temporary file 1");
-        for (i=0; i<static_strings_extent; i++) sf_put(fgetc(fin));
+        begin_reading_temp_file(fin);
+        sf_put_from_temp_file(static_strings_extent, TRUE, 1);
         if (ferror(fin))
             fatalerror("I/O failure: couldn't read from temporary file 1");
         fclose(fin);
         remove(Temp1_Name); remove(Temp2_Name);
     }
     else
-      for (i=0; i<static_strings_extent; i++) {
-        sf_put(read_byte_from_memory_block(&static_strings_area,i));
-        size++;
-      }
+    {   sf_put_memory_block(&static_strings_area, 0, static_strings_extent);
+        size += static_strings_extent;
+    }
 
     /*  (5)  Output the linking data table (in the case of a module).        */
 
@@ -545,7 +714,8 @@ static void output_file_z(void)
             fin=fopen(Temp3_Name,"rb");
             if (fin==NULL)
                 fatalerror("I/O failure: couldn't reopen temporary file 3");
-            for (j=0; j<link_data_size; j++) sf_put(fgetc(fin));
+            begin_reading_temp_file(fin);
+            sf_put_from_temp_file(link_data_size, TRUE, 3);
             if (ferror(fin))
                 fatalerror("I/O failure: couldn't read from temporary file 3");
             fclose(fin);
@@ -554,20 +724,19 @@ static void output_file_z(void)
     }
     else
         if (module_switch)
-            for (i=0; i<link_data_size; i++)
-                sf_put(read_byte_from_memory_block(&link_data_area,i));
+            sf_put_memory_block(&link_data_area, 0, link_data_size);
 
     if (module_switch)
-    {   for (i=0; i<zcode_backpatch_size; i++)
-            sf_put(read_byte_from_memory_block(&zcode_backpatch_table, i));
-        for (i=0; i<zmachine_backpatch_size; i++)
-            sf_put(read_byte_from_memory_block(&zmachine_backpatch_table, i));
+    {   sf_put_memory_block(&zcode_backpatch_table, 0, zcode_backpatch_size);
+        sf_put_memory_block(&zmachine_backpatch_table, 0,
+            zmachine_backpatch_size);
     }
 
     /*  (6)  Output null bytes to reach a multiple of 0.5K.                  */
 
     while (blanks>0) { sf_put(0); blanks--; }
 
+    sf_flush();
     if (ferror(sf_handle))
         fatalerror("I/O failure: couldn't write to story file");
 
@@ -578,7 +747,7 @@ static void output_file_z(void)
     if (ferror(sf_handle))
       fatalerror("I/O failure: couldn't backtrack on story file for checksum");
 
-    fclose(sf_handle);
+    close_story_file();
 
     /*  Write a copy of the header into the debugging information file
         (mainly so that it can be used to identify which story file matches
@@ -632,9 +801,7 @@ static void output_file_g(void)
 
     translate_out_filename(new_name, Code_Name);
 
-    sf_handle = fopen(new_name,"wb+");
-    if (sf_handle == NULL)
-        fatalerror_named("Couldn't open output file", new_name);
+    open_story_file(new_name, "wb+");
 
 #ifdef MAC_MPW
     /*  Set the type and creator to Andrew Plotkin's MaxZip, a popular
@@ -766,6 +933,7 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
         fin=fopen(Temp2_Name,"rb");
         if (fin==NULL)
             fatalerror("I/O failure: couldn't reopen temporary file 2");
+        begin_reading_temp_file(fin);
     }
 
     if (!OMIT_UNUSED_ROUTINES) {
@@ -812,21 +980,12 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
         /* All code up until the next backpatch marker gets flushed out
            as-is. (Unless we're in a stripped-out function.) */
         while (j<offset) {
-            if (!use_function) {
-                while (j<offset && j<next_cons_check) {
-                    /* get dummy value */
-                    ((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
-            else {
-                while (j<offset && j<next_cons_check) {
-                    size++;
-                    sf_put((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
+            int32 upto = offset;
+            if (next_cons_check < (uint32) upto) upto = next_cons_check;
+            if (upto > j) {
+                sf_put_code(j, upto-j, use_function);
+                if (use_function) size += upto-j;
+                j = upto;
             }
             if (j == next_cons_check)
                 next_cons_check = df_next_function_iterate(&use_function);
@@ -837,14 +996,10 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
         switch (data_len) {
 
         case 4:
-          v = ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j));
-          v = (v << 8) | ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j+1));
-          v = (v << 8) | ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j+2));
-          v = (v << 8) | ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j+3));
+          v = code_byte(j);
+          v = (v << 8) | code_byte(j+1);
+          v = (v << 8) | code_byte(j+2);
+          v = (v << 8) | code_byte(j+3);
           j += 4;
           if (!use_function)
               break;
@@ -857,10 +1012,8 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
           break;
 
         case 2:
-          v = ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j));
-          v = (v << 8) | ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j+1));
+          v = code_byte(j);
+          v = (v << 8) | code_byte(j+1);
           j += 2;
           if (!use_function)
               break;
@@ -875,8 +1028,7 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
           break;
 
         case 1:
-          v = ((temporary_files_switch)?fgetc(fin):
-            read_byte_from_memory_block(&zcode_area, j));
+          v = code_byte(j);
           j += 1;
           if (!use_function)
               break;
@@ -908,21 +1060,12 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
        marker. */
     offset = zmachine_pc;
     while (j<offset) {
-        if (!use_function) {
-            while (j<offset && j<next_cons_check) {
-                /* get dummy value */
-                ((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
-        else {
-            while (j<offset && j<next_cons_check) {
-                size++;
-                sf_put((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
+        int32 upto = offset;
+        if (next_cons_check < (uint32) upto) upto = next_cons_check;
+        if (upto > j) {
+            sf_put_code(j, upto-j, use_function);
+            if (use_function) size += upto-j;
+            j = upto;
         }
         if (j == next_cons_check)
             next_cons_check = df_next_function_iterate(&use_function);
@@ -939,11 +1082,9 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
 
     /*  (4)  Output the static strings area.                                 */
 
-    if (temporary_files_switch) {
-      fseek(Temp1_fp, 0, SEEK_SET);
-    }
+    begin_reading_static_strings();
     {
-      int32 ix, lx;
+      int32 lx;
       int ch, jx, curbyte, bx;
       int depth, checkcount;
       huffbitlist_t *bits;
@@ -983,10 +1124,7 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
 
       origsize = size;
 
-      for (lx=0, ix=0; lx<no_strings; lx++) {
-        int escapelen=0, escapetype=0;
-        int done=FALSE;
-        int32 escapeval=0;
+      for (lx=0; lx<no_strings; lx++) {
         if (compression_switch)
           sf_put(0xE1); /* type byte -- compressed string */
         else
@@ -994,76 +1132,24 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
         size++;
         jx = 0; 
         curbyte = 0;
-        while (!done) {
-          if (temporary_files_switch)
-            ch = fgetc(Temp1_fp);
-          else
-            ch = read_byte_from_memory_block(&static_strings_area, ix);
-          ix++;
-          if (ix > static_strings_extent || ch < 0)
-            compiler_error("Read too much not-yet-compressed text.");
-
-          if (escapelen == -1) {
-            escapelen = 0;
-            if (ch == '@') {
-              ch = '@';
-            }
-            else if (ch == '0') {
-              ch = '\0';
-            }
-            else if (ch == 'A' || ch == 'D' || ch == 'U') {
-              escapelen = 4;
-              escapetype = ch;
-              escapeval = 0;
-              continue;
-            }
-            else {
-              compiler_error("Strange @ escape in processed text.");
-            }
-          }
-          else if (escapelen) {
-            escapeval = (escapeval << 4) | ((ch-'A') & 0x0F);
-            escapelen--;
-            if (escapelen == 0) {
-              if (escapetype == 'A') {
-                ch = huff_abbrev_start+escapeval;
-              }
-              else if (escapetype == 'D') {
-                ch = huff_dynam_start+escapeval;
-              }
-              else if (escapetype == 'U') {
-                ch = huff_unicode_start+escapeval;
-              }
-              else {
-                compiler_error("Strange @ escape in processed text.");
-              }
-            }
-            else 
-              continue;
-          }
-          else {
-            if (ch == '@') {
-              escapelen = -1;
-              continue;
-            }
-            if (ch == 0) {
-              ch = 256;
-              done = TRUE;
-            }
-          }
+        do {
+          ch = read_static_string_entity();
 
           if (compression_switch) {
+            /* The bits go out up to eight at a time: curbyte holds the
+               jx bits (fewer than 8) not yet written. */
             bits = &(huff_entities[ch].bits);
             depth = huff_entities[ch].depth;
-            for (bx=0; bx<depth; bx++) {
-              if (bits->b[bx / 8] & (1 << (bx % 8)))
-                curbyte |= (1 << jx);
-              jx++;
-              if (jx == 8) {
-                sf_put(curbyte);
+            for (bx=0; bx<depth; bx+=8) {
+              int nbits = depth - bx;
+              if (nbits > 8) nbits = 8;
+              curbyte |= (bits->b[bx / 8] & ((1 << nbits) - 1)) << jx;
+              jx += nbits;
+              if (jx >= 8) {
+                sf_put(curbyte & 0xFF);
                 size++;
-                curbyte = 0;
-                jx = 0;
+                curbyte >>= 8;
+                jx -= 8;
               }
             }
           }
@@ -1081,7 +1167,7 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
               size++;
             }
           }
-        }
+        } while (ch != 256);
         if (compression_switch && jx) {
           sf_put(curbyte);
           size++;
@@ -1100,10 +1186,10 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
 
     /*  (5)  Output RAM. */
 
-    for (i=0; i<RAM_Size; i++)
-    {   sf_put(zmachine_paged_memory[i]); size++;
-    }
+    sf_put_block(zmachine_paged_memory, RAM_Size);
+    size += RAM_Size;
 
+    sf_flush();
     if (ferror(sf_handle))
         fatalerror("I/O failure: couldn't write to story file");
 
@@ -1136,7 +1222,7 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
         debug_file_printf("</story-file-prefix>");
     }
 
-    fclose(sf_handle);
+    close_story_file();
 
 #ifdef ARCHIMEDES
     {   char settype_command[PATHLEN];
@@ -1225,11 +1311,181 @@ extern void close_transcript_file(void)
 
 static FILE *Debug_fp;                 /* Handle of debugging info file      */
 
+/*  The file is written through a buffer of our own, so that each of the
+    many small elements costs a copy rather than a trip through stdio.
+    Positions in the file are plain byte offsets.  A backpatch goes
+    straight into the buffer if the bytes it overwrites haven't been
+    written out yet; if they have, it is kept in a list, and the list is
+    applied in order of position when the file is closed, a block at a
+    time, rather than with a seek and a tiny write for each one.  (The
+    backpatches given never overlap.)                                        */
+
+#define DEBUG_BUFFER_SIZE 65536
+
+/*  debug_file_printf() formats no more than this many characters at a
+    time: the longest text it is given is an identifier or an object's
+    short name, which is at most 765 characters                              */
+
+#define MAX_DEBUG_PRINTF_LENGTH 1024
+
+static char  debug_buffer[DEBUG_BUFFER_SIZE];
+static int32 debug_buffer_pos;         /* Bytes waiting in debug_buffer      */
+static long  debug_flushed_size;       /* Bytes written out to the file      */
+
+typedef struct pending_debug_patch_s
+{   long  position;
+    int32 length;
+    int32 text;                        /* Offset in debug_patch_text         */
+} pending_debug_patch;
+
+static pending_debug_patch *pending_debug_patches;
+static int32 no_pending_debug_patches, pending_debug_patches_size;
+static char *debug_patch_text;
+static int32 debug_patch_text_used, debug_patch_text_size;
+
+static void debug_file_failure(void)
+{   fatalerror("I/O failure: can't write to debugging information file");
+}
+
+static void debug_file_seek(long position)
+{   if (fseek(Debug_fp, position, SEEK_SET))
+        fatalerror("I/O failure: can't seek in debugging information file");
+}
+
+static void flush_debug_buffer(void)
+{   if (debug_buffer_pos == 0) return;
+    if (fwrite(debug_buffer, 1, debug_buffer_pos, Debug_fp)
+        != (size_t) debug_buffer_pos)
+        debug_file_failure();
+    debug_flushed_size += debug_buffer_pos;
+    debug_buffer_pos = 0;
+}
+
+static void debug_file_write(const char *text, int32 length)
+{   if (length > DEBUG_BUFFER_SIZE - debug_buffer_pos)
+    {   flush_debug_buffer();
+        if (length >= DEBUG_BUFFER_SIZE)
+        {   if (fwrite(text, 1, length, Debug_fp) != (size_t) length)
+                debug_file_failure();
+            debug_flushed_size += length;
+            return;
+        }
+    }
+    memcpy(debug_buffer + debug_buffer_pos, text, length);
+    debug_buffer_pos += length;
+}
+
+static long debug_file_position(void)
+{   return debug_flushed_size + debug_buffer_pos;
+}
+
+static void debug_file_patch(long position, const char *text, int32 length)
+{   /*  Overwrite length bytes of what has already been written, from the
+        given position on  */
+
+    if ((position < 0) || (position + length > debug_file_position()))
+        compiler_error("Debug information file backpatch out of range");
+    if (position < debug_flushed_size)
+    {   int32 k = length, n;
+        if (position + k > debug_flushed_size)
+            k = debug_flushed_size - position;
+        if (no_pending_debug_patches == pending_debug_patches_size)
+        {   n = grown_memory_size(pending_debug_patches_size,
+                no_pending_debug_patches+1);
+            my_regrow(&pending_debug_patches, sizeof(pending_debug_patch),
+                pending_debug_patches_size, n, "debug information backpatches");
+            pending_debug_patches_size = n;
+        }
+        if (debug_patch_text_used + k > debug_patch_text_size)
+        {   n = grown_memory_size(debug_patch_text_size,
+                debug_patch_text_used + k);
+            my_regrow(&debug_patch_text, 1, debug_patch_text_size, n,
+                "debug information backpatch text");
+            debug_patch_text_size = n;
+        }
+        pending_debug_patches[no_pending_debug_patches].position = position;
+        pending_debug_patches[no_pending_debug_patches].length = k;
+        pending_debug_patches[no_pending_debug_patches].text
+            = debug_patch_text_used;
+        no_pending_debug_patches++;
+        memcpy(debug_patch_text + debug_patch_text_used, text, k);
+        debug_patch_text_used += k;
+        position += k; text += k; length -= k;
+    }
+    if (length > 0)
+        memcpy(debug_buffer + (position - debug_flushed_size), text, length);
+}
+
+static int compare_pending_debug_patches(const void *a, const void *b)
+{   long pa = ((const pending_debug_patch *) a)->position;
+    long pb = ((const pending_debug_patch *) b)->position;
+    return (pa < pb)?-1:((pa > pb)?1:0);
+}
+
+static void apply_pending_debug_patches(void)
+{   /*  Called once everything has been written out, so that debug_buffer
+        is free to hold each block of the file as it is patched  */
+
+    int32 i, j, block_length;
+    long block_start;
+    pending_debug_patch *P;
+
+    if (no_pending_debug_patches == 0) return;
+    qsort(pending_debug_patches, no_pending_debug_patches,
+        sizeof(pending_debug_patch), compare_pending_debug_patches);
+
+    for (i=0; i<no_pending_debug_patches; i=j)
+    {   block_start = pending_debug_patches[i].position;
+        block_length = DEBUG_BUFFER_SIZE;
+        if (block_start + block_length > debug_flushed_size)
+            block_length = debug_flushed_size - block_start;
+
+        /*  Take in as many patches as lie wholly within the block, and end
+            the block where the next begins  */
+        for (j=i; j<no_pending_debug_patches; j++)
+        {   P = pending_debug_patches + j;
+            if ((j > i) && (P->position < P[-1].position + P[-1].length))
+                compiler_error("Debug information file backpatches overlap");
+            if (P->position + P->length > block_start + block_length)
+            {   if (j == i)
+                    compiler_error("Debug information file backpatch too long");
+                if (P->position < block_start + block_length)
+                    block_length = P->position - block_start;
+                break;
+            }
+        }
+
+        debug_file_seek(block_start);
+        if (fread(debug_buffer, 1, block_length, Debug_fp)
+            != (size_t) block_length)
+            fatalerror("I/O failure: can't read back debugging information file");
+        for (P = pending_debug_patches + i;
+             P < pending_debug_patches + j; P++)
+            memcpy(debug_buffer + (P->position - block_start),
+                debug_patch_text + P->text, P->length);
+        debug_file_seek(block_start);
+        if (fwrite(debug_buffer, 1, block_length, Debug_fp)
+            != (size_t) block_length)
+            debug_file_failure();
+    }
+
+    my_free(&pending_debug_patches, "debug information backpatches");
+    my_free(&debug_patch_text, "debug information backpatch text");
+    no_pending_debug_patches = 0; pending_debug_patches_size = 0;
+    debug_patch_text_used = 0; debug_patch_text_size = 0;
+}
+
 static void open_debug_file(void)
-{   Debug_fp=fopen(Debugging_Name,"wb");
+{   Debug_fp=fopen(Debugging_Name,"w+b");
     if (Debug_fp==NULL)
        fatalerror_named("Couldn't open debugging information file",
            Debugging_Name);
+    debug_buffer_pos = 0;
+    debug_flushed_size = 0;
+    pending_debug_patches = NULL;
+    no_pending_debug_patches = 0; pending_debug_patches_size = 0;
+    debug_patch_text = NULL;
+    debug_patch_text_used = 0; debug_patch_text_size = 0;
 }
 
 extern void nullify_debug_file_position(maybe_file_position *position) {
@@ -1237,12 +1493,23 @@ extern void nullify_debug_file_position(maybe_file_position *position) {
 }
 
 static void close_debug_file(void)
-{   fclose(Debug_fp);
+{   flush_debug_buffer();
+    apply_pending_debug_patches();
+    if (fclose(Debug_fp)) debug_file_failure();
+    Debug_fp = NULL;
 #ifdef MAC_FACE
     InformFiletypes (Debugging_Name, INF_DEBUG_TYPE);
 #endif
 }
 
+extern void abort_debug_file(void)
+{   if (Debug_fp == NULL) return;
+    fclose(Debug_fp);
+    Debug_fp = NULL;
+    my_free(&pending_debug_patches, "debug information backpatches");
+    my_free(&debug_patch_text, "debug information backpatch text");
+}
+
 extern void begin_debug_file(void)
 {   open_debug_file();
 
@@ -1258,38 +1525,52 @@ extern void begin_debug_file(void)
 
 extern void debug_file_printf(const char*format, ...)
 {   va_list argument_pointer;
+    int length;
+
+    /*  The text is formatted straight into the buffer, so there must be
+        room for the longest it can be  */
+
+    if (DEBUG_BUFFER_SIZE - debug_buffer_pos <= MAX_DEBUG_PRINTF_LENGTH)
+        flush_debug_buffer();
     va_start(argument_pointer, format);
-    vfprintf(Debug_fp, format, argument_pointer);
+    length = vsprintf(debug_buffer + debug_buffer_pos, format,
+        argument_pointer);
     va_end(argument_pointer);
-    if (ferror(Debug_fp))
-    {   fatalerror("I/O failure: can't write to debugging information file");
-    }
+    if (length < 0) debug_file_failure();
+    if (length > MAX_DEBUG_PRINTF_LENGTH)
+        compiler_error("Debugging information text too long");
+    debug_buffer_pos += length;
 }
 
 extern void debug_file_print_with_entities(const char*string)
-{   int index = 0;
-    char character;
-    for (character = string[index]; character; character = string[++index])
-    {   switch(character)
+{   size_t run;
+    while (*string)
+    {   /*  Copy the longest run needing no escapes in one go  */
+        run = strcspn(string, "\"&'<>");
+        if (run > 0)
+        {   debug_file_write(string, (int32) run);
+            string += run;
+        }
+        switch(*string)
         {   case '"':
-                debug_file_printf("&quot;");
+                debug_file_write("&quot;", 6);
                 break;
             case '&':
-                debug_file_printf("&amp;");
+                debug_file_write("&amp;", 5);
                 break;
             case '\'':
-                debug_file_printf("&apos;");
+                debug_file_write("&apos;", 6);
                 break;
             case '<':
-                debug_file_printf("&lt;");
+                debug_file_write("&lt;", 4);
                 break;
             case '>':
-                debug_file_printf("&gt;");
+                debug_file_write("&gt;", 4);
                 break;
             default:
-                debug_file_printf("%c", character);
-                break;
+                continue;
         }
+        string++;
     }
 }
 
@@ -1302,27 +1583,30 @@ static char base_64_digits[] =
 
 extern void debug_file_print_base_64_triple
     (uchar first, uchar second, uchar third)
-{   debug_file_printf
-        ("%c%c%c%c",
-         base_64_digits[first >> 2],
-         base_64_digits[((first & 3) << 4) | (second >> 4)],
-         base_64_digits[((second & 15) << 2) | (third >> 6)],
-         base_64_digits[third & 63]);
+{   char digits[4];
+    digits[0] = base_64_digits[first >> 2];
+    digits[1] = base_64_digits[((first & 3) << 4) | (second >> 4)];
+    digits[2] = base_64_digits[((second & 15) << 2) | (third >> 6)];
+    digits[3] = base_64_digits[third & 63];
+    debug_file_write(digits, 4);
 }
 
 extern void debug_file_print_base_64_pair(uchar first, uchar second)
-{   debug_file_printf
-        ("%c%c%c=",
-         base_64_digits[first >> 2],
-         base_64_digits[((first & 3) << 4) | (second >> 4)],
-         base_64_digits[(second & 15) << 2]);
+{   char digits[4];
+    digits[0] = base_64_digits[first >> 2];
+    digits[1] = base_64_digits[((first & 3) << 4) | (second >> 4)];
+    digits[2] = base_64_digits[(second & 15) << 2];
+    digits[3] = '=';
+    debug_file_write(digits, 4);
 }
 
 extern void debug_file_print_base_64_single(uchar first)
-{   debug_file_printf
-        ("%c%c==",
-         base_64_digits[first >> 2],
-         base_64_digits[(first & 3) << 4]);
+{   char digits[4];
+    digits[0] = base_64_digits[first >> 2];
+    digits[1] = base_64_digits[(first & 3) << 4];
+    digits[2] = '=';
+    digits[3] = '=';
+    debug_file_write(digits, 4);
 }
 
 static void write_debug_location_internals(debug_location location)
@@ -1376,21 +1660,19 @@ extern void write_debug_optional_identifier(int32 symbol_index)
             ("Attempt to write a replaceable identifier for a non-routine");
     }
     if (replacement_debug_backpatch_positions[symbol_index].valid)
-    {   if (fsetpos
-                (Debug_fp,
-                 &replacement_debug_backpatch_positions[symbol_index].position))
-        {   fatalerror("I/O failure: can't seek in debugging information file");
-        }
-        debug_file_printf
-            ("<identifier artificial=\"true\">%s "
-                 "(superseded replacement)</identifier>",
-             symbs[symbol_index]);
-        if (fseek(Debug_fp, 0L, SEEK_END))
-        {   fatalerror("I/O failure: can't seek in debugging information file");
-        }
+    {   char *text = my_malloc(strlen((char *) symbs[symbol_index]) + 80,
+            "debug information text");
+        sprintf(text,
+            "<identifier artificial=\"true\">%s "
+                "(superseded replacement)</identifier>",
+            (char *) symbs[symbol_index]);
+        debug_file_patch
+            (replacement_debug_backpatch_positions[symbol_index].position,
+             text, strlen(text));
+        my_free(&text, "debug information text");
     }
-    fgetpos
-      (Debug_fp, &replacement_debug_backpatch_positions[symbol_index].position);
+    replacement_debug_backpatch_positions[symbol_index].position =
+        debug_file_position();
     replacement_debug_backpatch_positions[symbol_index].valid = TRUE;
     debug_file_printf("<identifier>%s</identifier>", symbs[symbol_index]);
     /* Space for:       artificial="true" (superseded replacement) */
@@ -1402,7 +1684,8 @@ extern void write_debug_symbol_backpatch(int32 symbol_index)
         compiler_error("Symbol entry incorrectly reused in debug information "
                        "file backpatching");
     }
-    fgetpos(Debug_fp, &symbol_debug_backpatch_positions[symbol_index].position);
+    symbol_debug_backpatch_positions[symbol_index].position =
+        debug_file_position();
     symbol_debug_backpatch_positions[symbol_index].valid = TRUE;
     /* Reserve space for up to 10 digits plus a negative sign. */
     debug_file_printf("*BACKPATCH*");
@@ -1418,7 +1701,8 @@ extern void write_debug_symbol_optional_backpatch(int32 symbol_index)
        so that we'll be in the same case as above if the symbol is eventually
        defined. */
     debug_file_printf("<value>");
-    fgetpos(Debug_fp, &symbol_debug_backpatch_positions[symbol_index].position);
+    symbol_debug_backpatch_positions[symbol_index].position =
+        debug_file_position();
     symbol_debug_backpatch_positions[symbol_index].valid = TRUE;
     debug_file_printf("*BACKPATCH*</value>");
 }
@@ -1437,10 +1721,9 @@ static void write_debug_backpatch
     }
     accumulator->values_and_backpatch_positions
         [accumulator->number_of_values_to_backpatch].value = value;
-    fgetpos
-        (Debug_fp,
-         &accumulator->values_and_backpatch_positions
-             [accumulator->number_of_values_to_backpatch].backpatch_position);
+    accumulator->values_and_backpatch_positions
+        [accumulator->number_of_values_to_backpatch].backpatch_position =
+            debug_file_position();
     ++(accumulator->number_of_values_to_backpatch);
     /* Reserve space for up to 10 digits plus a negative sign. */
     debug_file_printf("*BACKPATCH*");
@@ -1545,56 +1828,43 @@ extern void write_debug_undef(int32 symbol_index)
             ("Attempt to erase debugging information for a non-constant "
              "because of an #undef");
     }
-    if (fsetpos
-         (Debug_fp, &symbol_debug_backpatch_positions[symbol_index].position))
-    {   fatalerror("I/O failure: can't seek in debugging information file");
-    }
     /* There are 7 characters in ``<value>''. */
-    if (fseek(Debug_fp, -7L, SEEK_CUR))
-    {   fatalerror("I/O failure: can't seek in debugging information file");
-    }
     /* Overwrite:      <value>*BACKPATCH*</value> */
-    debug_file_printf("                          ");
+    debug_file_patch
+        (symbol_debug_backpatch_positions[symbol_index].position - 7,
+         "                          ", 26);
     nullify_debug_file_position
         (&symbol_debug_backpatch_positions[symbol_index]);
-    if (fseek(Debug_fp, 0L, SEEK_END))
-    {   fatalerror("I/O failure: can't seek in debugging information file");
-    }
 }
 
 static void apply_debug_information_backpatches
     (debug_backpatch_accumulator *accumulator)
 {   int32 backpatch_index, backpatch_value;
+    char digits[16];
     for (backpatch_index = accumulator->number_of_values_to_backpatch;
          backpatch_index--;)
-    {   if (fsetpos
-                (Debug_fp,
-                 &accumulator->values_and_backpatch_positions
-                     [backpatch_index].backpatch_position))
-        {   fatalerror
-                ("I/O failure: can't seek in debugging information file");
-        }
-        backpatch_value =
+    {   backpatch_value =
             (*accumulator->backpatching_function)
                 (accumulator->values_and_backpatch_positions
                     [backpatch_index].value);
-        debug_file_printf
-            ("%11d", /* Space for up to 10 digits plus a negative sign. */
+        sprintf(digits, "%11d", /* Space for up to 10 digits plus a negative
+                                   sign. */
              backpatch_value);
+        debug_file_patch
+            (accumulator->values_and_backpatch_positions
+                 [backpatch_index].backpatch_position, digits, 11);
     }
 }
 
 static void apply_debug_information_symbol_backpatches()
 {   int backpatch_symbol;
+    char digits[16];
     for (backpatch_symbol = no_symbols; backpatch_symbol--;)
     {   if (symbol_debug_backpatch_positions[backpatch_symbol].valid)
-        {   if (fsetpos(Debug_fp,
-                        &symbol_debug_backpatch_positions
-                            [backpatch_symbol].position))
-            {   fatalerror
-                    ("I/O failure: can't seek in debugging information file");
-            }
-            debug_file_printf("%11d", svals[backpatch_symbol]);
+        {   sprintf(digits, "%11d", svals[backpatch_symbol]);
+            debug_file_patch
+                (symbol_debug_backpatch_positions[backpatch_symbol].position,
+                 digits, 11);
         }
     }
 }
@@ -1701,6 +1971,9 @@ extern void init_files_vars(void)
 
 extern void files_begin_prepass(void)
 {   input_file = 0;
+#ifdef LIBRARY
+    memory_source_left = -1;
+#endif
 }
 
 extern void files_begin_pass(void)
@@ -1757,9 +2030,11 @@ static void tear_down_accumulator(debug_backpatch_accumulator *accumulator)
 
 extern void files_free_arrays(void)
 {   my_free(&filename_storage, "filename storage");
+    my_free(&tf_buffer, "temporary file input buffer");
     my_free(&InputFiles, "input file storage");
+    input_file = 0;
     if (debugfile_switch)
-    {   if (!glulx_mode)
+    {   if (glulx_mode)
         {   tear_down_accumulator(&object_backpatch_accumulator);
         } else
         {   tear_down_accumulator(&packed_code_backpatch_accumulator);
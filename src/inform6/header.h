@@ -127,6 +127,9 @@
 /*                         by default, you should define this                */
 /*   HAS_REALPATH        - the POSIX realpath() function is available to     */
 /*                         find the absolute path to a file                  */
+/*   HAS_GETTIMEOFDAY    - the POSIX gettimeofday() function is available    */
+/*                         to time the phases of compilation (otherwise      */
+/*                         the coarser ANSI clock() is used)                 */
 /*                                                                           */
 /*   3. An estimate of the typical amount of memory likely to be free        */
 /*   should be given in DEFAULT_MEMORY_SIZE.                                 */
@@ -278,6 +281,7 @@ static int32 unique_task_id(void)
 #define MACHINE_STRING   "Linux"
 /* 2 */
 #define HAS_REALPATH
+#define HAS_GETTIMEOFDAY
 /* 3 */
 #define DEFAULT_MEMORY_SIZE HUGE_SIZE
 /* 4 */
@@ -347,6 +351,7 @@ static int32 unique_task_id(void)
 #define MACHINE_STRING   "Mac OS X"
 /* 2 */
 #define HAS_REALPATH
+#define HAS_GETTIMEOFDAY
 /* 3 */
 #define DEFAULT_MEMORY_SIZE LARGE_SIZE
 /* 4 */
@@ -419,6 +424,7 @@ static int32 unique_task_id(void)
 /* 2 */
 #define USE_TEMPORARY_FILES
 #define HAS_REALPATH
+#define HAS_GETTIMEOFDAY
 /* 3 */
 #define DEFAULT_MEMORY_SIZE HUGE_SIZE
 /* 4 */
@@ -444,6 +450,7 @@ static int32 unique_task_id(void)
 /* 2 */
 #define USE_TEMPORARY_FILES
 #define HAS_REALPATH
+#define HAS_GETTIMEOFDAY
 /* 3 */
 #define DEFAULT_MEMORY_SIZE HUGE_SIZE
 /* 4 */
@@ -485,6 +492,34 @@ static int32 unique_task_id(void)
 #define V7Code_Extension ".zip"
 #define V8Code_Extension ".zip"
 #endif
+/* ------------------------------------------------------------------------- */
+/*   LIBRARY block: defined as well as one of the above when Inform is to be */
+/*   built into a host program, which calls inform_library_compile() (see    */
+/*   "inform6lib.h") rather than running the compiler as a process.  All     */
+/*   printing is passed to the host, and anything which would end the        */
+/*   process instead returns to it through library_fallback.                 */
+/* ------------------------------------------------------------------------- */
+#ifdef LIBRARY
+#define EXTERNAL_SHELL
+#include <setjmp.h>
+#include "inform6lib.h"
+extern jmp_buf library_fallback;
+extern const inform_library_callbacks *library_callbacks;
+extern const char *library_source_text;
+extern long library_source_length;
+extern int library_printf(const char *format, ...);
+extern void library_exit(int status);
+
+/*  library_printf() needs vsnprintf(), since there is no bound on the
+    length of what the compiler prints (quoted strings in traces, say).
+    It is C99, so <stdio.h> does not declare it under -ansi, but the C
+    library of any host program provides it                                  */
+#ifndef vsnprintf
+extern int vsnprintf(char *s, size_t n, const char *format, va_list arg);
+#endif
+#define printf library_printf
+#define exit   library_exit
+#endif
 /* ========================================================================= */
 /* Default settings:                                                         */
 /* ------------------------------------------------------------------------- */
@@ -813,7 +848,7 @@ typedef struct objecttg {
 
 typedef struct maybe_file_position_S
 {   int valid;
-    fpos_t position;
+    long position;                     /* Byte offset in the file            */
 } maybe_file_position;
 
 typedef struct debug_location_s
@@ -869,15 +904,13 @@ typedef struct ErrorPosition_s
     int  main_flag;
 } ErrorPosition;
 
-/*  A memory block can hold at most ALLOC_CHUNK_SIZE * 72:  */
+/*  A memory block starts at ALLOC_CHUNK_SIZE bytes and doubles as needed:  */
 
 extern int ALLOC_CHUNK_SIZE;
 
 typedef struct memory_block_s
-{   int chunks;
-    int extent_of_last;
-    uchar *chunk[72];
-    int write_pos;
+{   uchar *data;
+    int32 size;
 } memory_block;
 
 /* This serves for both Z-code and Glulx instructions. Glulx doesn't use
@@ -1943,6 +1976,25 @@ typedef struct operator_s
                                         how far back from the label to go
                                         to find the opmode byte to modify. */
 
+/* ------------------------------------------------------------------------- */
+/*   Phases of compilation (timed when a profile_name is set: see "inform")  */
+/* ------------------------------------------------------------------------- */
+
+#define SETUP_PHASE            0     /* Allocating memory, opening files */
+#define PARSING_PHASE          1     /* Lexing, parsing and code generation,
+                                        which happen together in one pass */
+#define VENEER_PHASE           2
+#define DICTIONARY_PHASE       3
+#define DEAD_CODE_PHASE        4
+#define CONSTRUCTION_PHASE     5     /* Building the tables of the image */
+#define COMPRESSION_PHASE      6     /* Glulx only */
+#define BACKPATCHING_PHASE     7
+#define OUTPUT_PHASE           8     /* Includes backpatching of code */
+#define DEBUG_FILE_PHASE       9
+
+#define NO_PHASES             10
+#define IDLE_PHASE            -1     /* Not in any phase */
+
 /* ========================================================================= */
 /*   Initialisation extern definitions                                       */
 /*                                                                           */
@@ -2082,6 +2134,7 @@ extern void check_globals(void);
 extern int32 begin_table_array(void);
 extern int32 begin_word_array(void);
 extern void array_entry(int32 i, assembly_operand VAL);
+extern void ensure_dynamic_array_area(int32 size);
 extern void finish_array(int32 i);
 
 /* ------------------------------------------------------------------------- */
@@ -2092,6 +2145,8 @@ extern memory_block zcode_area;
 extern int32 zmachine_pc;
 
 extern int32 no_instructions;
+extern int32 peephole_jumps_removed, peephole_branches_threaded,
+    peephole_bytes_saved;
 extern int   sequence_point_follows;
 extern int   uses_unicode_features, uses_memheap_features, 
     uses_acceleration_features, uses_float_features;
@@ -2346,15 +2401,19 @@ extern int32 total_chars_read;
 extern void open_temporary_files(void);
 extern void check_temp_files(void);
 extern void remove_temp_files(void);
+extern void begin_reading_temp_file(FILE *fp);
+extern int  read_temp_file_byte(void);
 
 extern void open_transcript_file(char *what_of);
 extern void write_to_transcript_file(char *text);
 extern void close_transcript_file(void);
 extern void abort_transcript_file(void);
+extern void abort_story_file(void);
 
 extern void nullify_debug_file_position(maybe_file_position *position);
 
 extern void begin_debug_file(void);
+extern void abort_debug_file(void);
 
 extern void debug_file_printf(const char*format, ...);
 extern void debug_file_print_with_entities(const char*string);
@@ -2422,7 +2481,7 @@ extern int
 
 extern int oddeven_packing_switch;
 
-extern int glulx_mode, compression_switch;
+extern int glulx_mode, compression_switch, peephole_switch;
 extern int32 requested_glulx_version;
 
 extern int error_format,    store_the_text,       asm_trace_setting,
@@ -2433,6 +2492,7 @@ extern char Debugging_Name[];
 extern char Transcript_Name[];
 extern char Language_Name[];
 extern char Charset_Map[];
+extern char Profile_Name[];
 
 extern char banner_line[];
 
@@ -2444,6 +2504,7 @@ extern void translate_out_filename(char *new_name, char *old_name);
 extern int translate_link_filename(int last_value,
     char *new_name, char *old_name);
 extern void translate_temp_filename(int i);
+extern void profile_phase(int phase);
 
 #ifdef ARCHIMEDES
 extern char *riscos_file_type(void);
@@ -2516,7 +2577,7 @@ extern void  link_module(char *filename);
 /*   Extern definitions for "memory"                                         */
 /* ------------------------------------------------------------------------- */
 
-extern int32 malloced_bytes;
+extern int32 malloced_bytes, malloc_calls;
 
 extern int MAX_QTEXT_SIZE,  MAX_SYMBOLS,    HASH_TAB_SIZE,   MAX_DICT_ENTRIES,
            MAX_OBJECTS,     MAX_ACTIONS,    MAX_ADJECTIVES,   MAX_ABBREVS,
@@ -2555,6 +2616,9 @@ extern void *my_calloc(int32 size, int32 howmany, char *whatfor);
 extern void my_recalloc(void *pointer, int32 size, int32 oldhowmany, 
     int32 howmany, char *whatfor);
 extern void my_free(void *pointer, char *whatitwas);
+extern int32 grown_memory_size(int32 howmany, int32 needed);
+extern void my_regrow(void *pointer, int32 size, int32 oldhowmany,
+    int32 howmany, char *whatfor);
 
 extern void set_memory_sizes(int size_flag);
 extern void adjust_memory_sizes(void);
@@ -2564,8 +2628,12 @@ extern void print_memory_usage(void);
 extern void initialise_memory_block(memory_block *MB);
 extern void deallocate_memory_block(memory_block *MB);
 extern int  read_byte_from_memory_block(memory_block *MB, int32 index);
+extern void read_bytes_from_memory_block(memory_block *MB,
+    int32 index, uchar *to, int32 length);
 extern void write_byte_to_memory_block(memory_block *MB,
     int32 index, int value);
+extern void write_bytes_to_memory_block(memory_block *MB,
+    int32 index, uchar *from, int32 length);
 
 /* ------------------------------------------------------------------------- */
 /*   Extern definitions for "objects"                                        */
@@ -2597,6 +2665,8 @@ extern void make_class(char *metaclass_name);
 extern int  object_provides(int obj, int id);
 extern void list_object_tree(void);
 extern void write_the_identifier_names(void);
+extern void ensure_properties_table(int32 size);
+extern void ensure_individuals_table(int32 size);
 
 /* ------------------------------------------------------------------------- */
 /*   Extern definitions for "symbols"                                        */
@@ -2626,9 +2696,10 @@ extern uint32 df_total_size_before_stripping;
 extern uint32 df_total_size_after_stripping;
 
 extern char *typename(int type);
+extern uint32 full_hash_code_from_string(char *p);
 extern int hash_code_from_string(char *p);
 extern int strcmpcis(char *p, char *q);
-extern int symbol_index(char *lexeme_text, int hashcode);
+extern int symbol_index(char *lexeme_text, int32 hashcode);
 extern void end_symbol_scope(int k);
 extern void describe_symbol(int k);
 extern void list_symbols(int level);
@@ -2735,7 +2806,7 @@ extern int no_unicode_chars;
 typedef struct unicode_usage_s unicode_usage_t;
 struct unicode_usage_s {
   int32 ch;
-  unicode_usage_t *next;  
+  int next;  /* index of the next entry in the hash chain, or -1 */
 };
 
 extern unicode_usage_t *unicode_usage_entries;
@@ -2770,12 +2841,15 @@ extern int huff_abbrev_start, huff_dynam_start, huff_unicode_start;
 extern int huff_entity_root;
 
 extern void  compress_game_text(void);
+extern void  begin_reading_static_strings(void);
+extern int   read_static_string_entity(void);
 
 /* end of the Glulx string compression stuff */
 
 extern void  ao_free_arrays(void);
 extern int32 compile_string(char *b, int in_low_memory, int is_abbrev);
 extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text);
+extern int32 translated_text_size_bound(char *s_text);
 extern void  optimise_abbreviations(void);
 extern void  make_abbreviation(char *text);
 extern void  show_dictionary(void);
@@ -2784,6 +2858,7 @@ extern void  write_dictionary_to_transcript(void);
 extern void  sort_dictionary(void);
 extern void  dictionary_prepare(char *dword, uchar *optresult);
 extern int   dictionary_add(char *dword, int x, int y, int z);
+extern void  forget_dictionary_memo(void);
 extern void  dictionary_set_verb_number(char *dword, int to);
 extern int   compare_sorts(uchar *d1, uchar *d2);
 extern void  copy_sorts(uchar *d1, uchar *d2);
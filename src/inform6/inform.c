@@ -10,6 +10,10 @@
 #define MAIN_INFORM_FILE
 #include "header.h"
 
+#ifdef HAS_GETTIMEOFDAY
+#include <sys/time.h>
+#endif
+
 /* ------------------------------------------------------------------------- */
 /*   Compiler progress                                                       */
 /* ------------------------------------------------------------------------- */
@@ -248,6 +252,7 @@ int throwback_switch;               /* -T */
 int riscos_file_type_format;        /* set by -R */
 #endif
 int compression_switch;             /* set by -H */
+int peephole_switch;               /* set by -O */
 int character_set_setting,          /* set by -C0 through -C9 */
     character_set_unicode,          /* set by -Cu */
     error_format,                   /* set by -E */
@@ -315,6 +320,7 @@ static void reset_switch_settings(void)
     character_set_unicode = FALSE;
 
     compression_switch = TRUE;
+    peephole_switch = FALSE;
     glulx_mode = FALSE;
     requested_glulx_version = 0;
 }
@@ -477,6 +483,7 @@ static char current_source_path[PATHLEN];
        char Transcript_Name[PATHLEN];
        char Language_Name[PATHLEN];
        char Charset_Map[PATHLEN];
+       char Profile_Name[PATHLEN];
 static char ICL_Path[PATHLEN];
 
 static void set_path_value(char *path, char *value)
@@ -486,7 +493,9 @@ static void set_path_value(char *path, char *value)
     {   if ((value[j] == FN_ALT) || (value[j] == 0))
         {   if ((value[j] == FN_ALT)
                 && (path != Source_Path) && (path != Include_Path)
-                && (path != ICL_Path) && (path != Module_Path))
+                && (path != ICL_Path) && (path != Module_Path)
+                && (path != Debugging_Name) && (path != Transcript_Name)
+                && (path != Profile_Name))
             {   printf("The character '%c' is used to divide entries in a list \
 of possible locations, and can only be used in the Include_Path, Source_Path, \
 Module_Path or ICL_Path variables. Other paths are for output only.", FN_ALT);
@@ -494,6 +503,7 @@ Module_Path or ICL_Path variables. Other paths are for output only.", FN_ALT);
             }
             if ((path != Debugging_Name) && (path != Transcript_Name)
                  && (path != Language_Name) && (path != Charset_Map)
+                 && (path != Profile_Name)
                  && (i>0) && (isalnum(path[i-1]))) path[i++] = FN_SEP;
             path[i++] = value[j++];
             if (i == PATHLEN-1) {
@@ -519,6 +529,7 @@ static void set_default_paths(void)
     set_path_value(Transcript_Name, Transcript_File);
     set_path_value(Language_Name,   "English");
     set_path_value(Charset_Map,     "");
+    set_path_value(Profile_Name,    "");
 }
 
 static void set_path_command(char *command)
@@ -545,6 +556,7 @@ static void set_path_command(char *command)
         if (strcmp(pathname, "transcript_name")==0) path_to_set=Transcript_Name;
         if (strcmp(pathname, "language_name")==0) path_to_set=Language_Name;
         if (strcmp(pathname, "charset_map")==0) path_to_set=Charset_Map;
+        if (strcmp(pathname, "profile_name")==0) path_to_set=Profile_Name;
 
         if (path_to_set == NULL)
         {   printf("No such path setting as \"%s\"\n", pathname);
@@ -866,14 +878,17 @@ Inform translates plain filenames (such as \"xyzzy\") into full pathnames\n\
    \".\" then Inform uses no file extension at all (removing the \".\").\n\n");
 #endif
 
-    printf("Names of four individual files can also be set using the same\n\
+    printf("Names of five individual files can also be set using the same\n\
   + command notation (though they aren't really pathnames).  These are:\n\n\
       transcript_name  (text written by -r switch): now \"%s\"\n\
       debugging_name   (data written by -k switch): now \"%s\"\n\
       language_name    (library file defining natural language of game):\n\
                        now \"%s\"\n\
-      charset_map      (file for character set mapping): now \"%s\"\n\n",
-    Transcript_Name, Debugging_Name, Language_Name, Charset_Map);
+      charset_map      (file for character set mapping): now \"%s\"\n\
+      profile_name     (timings of each phase of compilation, written as\n\
+                       JSON only if this is set): now \"%s\"\n\n",
+    Transcript_Name, Debugging_Name, Language_Name, Charset_Map,
+    Profile_Name);
 
     translate_in_filename(0, new_name, "rezrov", 0, 1);
     printf("Examples: 1. \"inform rezrov\"\n\
@@ -978,6 +993,7 @@ extern char *riscos_file_type(void)
 
 static void run_pass(void)
 {
+    profile_phase(PARSING_PHASE);
     lexer_begin_prepass();
     files_begin_prepass();
     load_sourcefile(Source_Name, 0);
@@ -988,6 +1004,7 @@ static void run_pass(void)
 
     find_the_actions();
     issue_unused_warnings();
+    profile_phase(VENEER_PHASE);
     compile_veneer();
 
     lexer_endpass();
@@ -1000,12 +1017,185 @@ static void run_pass(void)
     {   if (module_switch) flush_link_data();
         check_temp_files();
     }
+    profile_phase(DICTIONARY_PHASE);
     sort_dictionary();
     if (track_unused_routines)
+    {   profile_phase(DEAD_CODE_PHASE);
         locate_dead_functions();
+    }
+    profile_phase(CONSTRUCTION_PHASE);
     construct_storyfile();
 }
 
+/* ------------------------------------------------------------------------- */
+/*   Profiling.  If a profile_name is set, the wall time spent in each       */
+/*   phase of compilation is recorded, together with how much memory was     */
+/*   allocated and how much was compiled while it ran, and written out as a  */
+/*   JSON file at the end.  Lexing, parsing and code generation happen       */
+/*   together in a single pass, so they can only be timed as one phase.      */
+/*                                                                           */
+/*   profile_phase() ends the current phase and begins the given one.        */
+/* ------------------------------------------------------------------------- */
+
+typedef struct phase_profile_s
+{   double seconds;
+    int32 entries;
+    int32 allocated_bytes, allocations;
+    int32 source_lines, routines, instructions, text_characters;
+} phase_profile;
+
+static char *phase_names[NO_PHASES] =
+{   "setup", "parsing", "veneer", "dictionary", "dead code", "construction",
+    "compression", "backpatching", "output", "debug file"
+};
+
+static FILE *profile_fp;           /* Open only while profiling              */
+static phase_profile phases[NO_PHASES];
+static int current_phase;          /* or IDLE_PHASE                          */
+static double phase_began, profile_began;
+static phase_profile counts_at_phase_start;
+
+static double profile_clock(void)
+{
+#ifdef HAS_GETTIMEOFDAY
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((double) tv.tv_sec) + ((double) tv.tv_usec)/1000000.0;
+#else
+    return ((double) clock())/CLOCKS_PER_SEC;
+#endif
+}
+
+static void take_counts(phase_profile *counts)
+{   counts->allocated_bytes = malloced_bytes;
+    counts->allocations = malloc_calls;
+    counts->source_lines = total_source_line_count;
+    counts->routines = no_routines;
+    counts->instructions = no_instructions;
+    counts->text_characters = total_chars_trans;
+}
+
+extern void profile_phase(int phase)
+{   int previous = current_phase;
+    phase_profile counts, *P;
+    double now;
+
+    current_phase = phase;
+    if (profile_fp == NULL) return;
+
+    now = profile_clock();
+    take_counts(&counts);
+    if (previous != IDLE_PHASE)
+    {   P = &(phases[previous]);
+        P->seconds += now - phase_began;
+        P->allocated_bytes
+            += counts.allocated_bytes - counts_at_phase_start.allocated_bytes;
+        P->allocations
+            += counts.allocations - counts_at_phase_start.allocations;
+        P->source_lines
+            += counts.source_lines - counts_at_phase_start.source_lines;
+        P->routines += counts.routines - counts_at_phase_start.routines;
+        P->instructions
+            += counts.instructions - counts_at_phase_start.instructions;
+        P->text_characters
+            += counts.text_characters - counts_at_phase_start.text_characters;
+    }
+    if (phase != IDLE_PHASE) phases[phase].entries++;
+    phase_began = now;
+    counts_at_phase_start = counts;
+}
+
+static void begin_profile(void)
+{   int i;
+    current_phase = IDLE_PHASE;
+    if (Profile_Name[0] == 0) return;
+
+    profile_fp = fopen(Profile_Name, "w");
+    if (profile_fp == NULL)
+        fatalerror_named("Couldn't open profile file", Profile_Name);
+    for (i=0; i<NO_PHASES; i++)
+    {   phases[i].seconds = 0.0;
+        phases[i].entries = 0;
+        phases[i].allocated_bytes = 0; phases[i].allocations = 0;
+        phases[i].source_lines = 0; phases[i].routines = 0;
+        phases[i].instructions = 0; phases[i].text_characters = 0;
+    }
+    profile_began = profile_clock();
+}
+
+static void write_profile_string(char *text)
+{   fputc('"', profile_fp);
+    for (; *text; text++)
+    {   if ((*text == '"') || (*text == '\\'))
+            fprintf(profile_fp, "\\%c", *text);
+        else if ((unsigned char) *text < 0x20)
+            fprintf(profile_fp, "\\u%04x", (unsigned char) *text);
+        else fputc(*text, profile_fp);
+    }
+    fputc('"', profile_fp);
+}
+
+/*  Seconds are printed from whole microseconds, since "%f" would use the    */
+/*  decimal comma of the host's locale (the IDE sets one) and so not be      */
+/*  valid JSON; setlocale() can't be used, as it is not thread-safe.         */
+
+static void write_profile_seconds(double seconds)
+{   long int microseconds = (long int) (seconds * 1000000.0 + 0.5);
+    fprintf(profile_fp, "%ld.%06ld", microseconds / 1000000L,
+        microseconds % 1000000L);
+}
+
+/*  The phases are written one to a line, so that a front end can show them  */
+/*  without needing a full JSON parser.                                      */
+
+static void end_profile(void)
+{   int i, first = TRUE;
+    phase_profile *P;
+
+    if (profile_fp == NULL) return;
+    profile_phase(IDLE_PHASE);
+
+    fprintf(profile_fp, "{\n  \"compiler\": ");
+    write_profile_string(banner_line);
+    fprintf(profile_fp, ",\n  \"source\": ");
+    write_profile_string(Source_Name);
+    if (glulx_mode)
+        fprintf(profile_fp, ",\n  \"target\": \"Glulx\"");
+    else
+        fprintf(profile_fp, ",\n  \"target\": \"Z-machine v%d\"",
+            version_number);
+    fprintf(profile_fp, ",\n  \"errors\": %d,\n  \"warnings\": %d",
+        no_errors, no_warnings);
+    fprintf(profile_fp, ",\n  \"seconds\": ");
+    write_profile_seconds(profile_clock() - profile_began);
+    fprintf(profile_fp, ",\n  \"allocated_bytes\": %ld",
+        (long int) malloced_bytes);
+    fprintf(profile_fp, ",\n  \"allocations\": %ld",
+        (long int) malloc_calls);
+    fprintf(profile_fp, ",\n  \"phases\": [");
+    for (i=0; i<NO_PHASES; i++)
+    {   P = &(phases[i]);
+        if (P->entries == 0) continue;
+        fprintf(profile_fp, "%s\n    { \"phase\": \"%s\", \"seconds\": ",
+            (first)?"":",", phase_names[i]);
+        write_profile_seconds(P->seconds);
+        fprintf(profile_fp, ", \"allocated_bytes\": %ld, \"allocations\": %ld, \
+\"source_lines\": %ld, \"routines\": %ld, \"instructions\": %ld, \
+\"text_characters\": %ld }",
+            (long int) P->allocated_bytes, (long int) P->allocations,
+            (long int) P->source_lines, (long int) P->routines,
+            (long int) P->instructions, (long int) P->text_characters);
+        first = FALSE;
+    }
+    fprintf(profile_fp, "\n  ]\n}\n");
+
+    if (ferror(profile_fp))
+        fatalerror_named("I/O failure: couldn't write to profile file",
+            Profile_Name);
+    fclose(profile_fp);
+    profile_fp = NULL;
+}
+
 int output_has_occurred;
 
 static void rennab(int32 time_taken)
@@ -1087,6 +1277,9 @@ compiling modules: disabling -S switch\n");
 
     init_vars();
 
+    begin_profile();
+    profile_phase(SETUP_PHASE);
+
     if (debugfile_switch) begin_debug_file();
 
     allocate_arrays();
@@ -1100,13 +1293,17 @@ compiling modules: disabling -S switch\n");
         close_transcript_file();
     }
 
+    profile_phase(OUTPUT_PHASE);
     if (no_errors==0) { output_file(); output_has_occurred = TRUE; }
     else { output_has_occurred = FALSE; }
 
     if (debugfile_switch)
-    {   end_debug_file();
+    {   profile_phase(DEBUG_FILE_PHASE);
+        end_debug_file();
     }
 
+    end_profile();
+
     if (temporary_files_switch && (no_errors>0)) remove_temp_files();
 
     free_arrays();
@@ -1246,6 +1443,7 @@ printf("  F1  use temporary files to reduce memory consumption\n");
 printf("  G   compile a Glulx game file\n");
 printf("  H   use Huffman encoding to compress Glulx strings\n");
 printf("  M   compile as a Module for future linking\n");
+printf("  O   peephole-optimise jumps in the compiled code\n");
 
 #ifdef ARCHIMEDES
 printf("\
@@ -1415,6 +1613,7 @@ extern void switches(char *p, int cmode)
                   }
                   break;
         case 'H': compression_switch = state; break;
+        case 'O': peephole_switch = state; break;
         case 'U': define_USE_MODULES_switch = state; break;
         case 'W': if ((p[i+1]>='0') && (p[i+1]<='9'))
                   {   s=2; ZCODE_HEADER_EXT_WORDS = p[i+1]-'0';
@@ -1739,8 +1938,8 @@ static int sub_main(int argc, char **argv)
 
     banner();
 
-    set_memory_sizes(DEFAULT_MEMORY_SIZE); set_default_paths();
     reset_switch_settings(); select_version(5);
+    set_memory_sizes(DEFAULT_MEMORY_SIZE); set_default_paths();
 
     cli_files_specified = 0; no_compilations = 0;
     cli_file1 = "source"; cli_file2 = "output";
@@ -1761,4 +1960,94 @@ static int sub_main(int argc, char **argv)
     return(0);
 }
 
+/* ------------------------------------------------------------------------- */
+/*   M A I N  III:  Running as a library inside a host program               */
+/*   (see "inform6lib.h"), when LIBRARY is defined                           */
+/* ------------------------------------------------------------------------- */
+
+#ifdef LIBRARY
+
+jmp_buf library_fallback;              /* Where fatal errors return to       */
+const inform_library_callbacks *library_callbacks;
+const char *library_source_text;       /* Main source file, or NULL to read  */
+long library_source_length;            /* it from disk as usual              */
+
+static int library_exit_code;
+
+extern int library_printf(const char *format, ...)
+{   va_list ap;
+    char buffer[1024], *text = buffer;
+    int length;
+
+    va_start(ap, format);
+    if ((library_callbacks == NULL) || (library_callbacks->print == NULL))
+    {   length = vprintf(format, ap);
+        va_end(ap);
+        return length;
+    }
+    length = vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+
+    /*  Not my_malloc(), which can itself print under -m                     */
+
+    if (length >= (int) sizeof(buffer))
+    {   text = malloc(length+1);
+        if (text == NULL) text = buffer;     /* Settle for it cut short     */
+        else
+        {   va_start(ap, format);
+            vsnprintf(text, length+1, format, ap);
+            va_end(ap);
+        }
+    }
+
+    library_callbacks->print(text, library_callbacks->data);
+    if (text != buffer) free(text);
+    return length;
+}
+
+extern const char *inform_library_build_id(void)
+{   static char build_id[64];
+    sprintf(build_id, "%d%s %s %s", RELEASE_NUMBER, RELEASE_SUFFIX,
+        __DATE__, __TIME__);
+    return build_id;
+}
+
+extern void library_exit(int status)
+{   library_exit_code = status;
+    longjmp(library_fallback, 1);
+}
+
+extern int inform_library_compile(int argc, char **argv,
+    const char *source_text, long source_length,
+    const inform_library_callbacks *callbacks)
+{   int return_code;
+
+    library_callbacks = callbacks;
+    library_source_text = source_text;
+    library_source_length = source_length;
+    library_exit_code = 1;
+
+    if (setjmp(library_fallback) == 0)
+        return_code = sub_main(argc, argv);
+    else
+    {   /*  A fatal error: tidy up whatever the process exit would have      */
+
+        close_all_source();
+        if (temporary_files_switch) remove_temp_files();
+        abort_transcript_file();
+        abort_debug_file();
+        abort_story_file();
+        if (profile_fp != NULL) { fclose(profile_fp); profile_fp = NULL; }
+        free_arrays();
+        if (store_the_text) my_free(&all_text,"transcription text");
+        return_code = library_exit_code;
+    }
+
+    library_callbacks = NULL;
+    library_source_text = NULL;
+    return return_code;
+}
+
+#endif
+
 /* ========================================================================= */
@@ -0,0 +1,66 @@
+/* ------------------------------------------------------------------------- */
+/*   "inform6lib" : Interface for running Inform inside a host program       */
+/*                  (available when the compiler is built with LIBRARY       */
+/*                  defined: see "header.h")                                 */
+/*                                                                           */
+/*   Part of Inform 6.33                                                     */
+/*   copyright (c) Graham Nelson 1993 - 2015                                 */
+/*                                                                           */
+/* ------------------------------------------------------------------------- */
+
+#ifndef INFORM6LIB_H
+#define INFORM6LIB_H
+
+/* ------------------------------------------------------------------------- */
+/*   Kinds of diagnostic passed to the host's diagnostic callback            */
+/* ------------------------------------------------------------------------- */
+
+#define INFORM_WARNING         0
+#define INFORM_ERROR           1
+#define INFORM_FATAL_ERROR     2
+#define INFORM_COMPILER_ERROR  3
+
+/* ------------------------------------------------------------------------- */
+/*   The host supplies these.  Any of the three routines may be NULL:        */
+/*                                                                           */
+/*   print        receives all the text which the command-line compiler      */
+/*                would have printed (otherwise it goes to stdout);          */
+/*   diagnostic   receives each error and warning as it is issued, with the  */
+/*                source file and line it refers to ("" and 0 if none);      */
+/*   story_file   receives the finished story file, which is then not        */
+/*                written to disk (otherwise it is written as usual).        */
+/* ------------------------------------------------------------------------- */
+
+typedef struct inform_library_callbacks_s
+{   void (*print)(const char *text, void *data);
+    void (*diagnostic)(int kind, const char *filename, int line,
+        const char *message, void *data);
+    void (*story_file)(const unsigned char *image, long length, void *data);
+    void *data;                        /* Passed back to each routine        */
+} inform_library_callbacks;
+
+/* ------------------------------------------------------------------------- */
+/*   inform_library_compile() takes the same arguments as the command line   */
+/*   (argv[0] being the program name) and returns the same exit code.  If    */
+/*   source_text is not NULL, it is used as the contents of the main source  */
+/*   file named on the command line, which is then not read from disk.       */
+/*                                                                           */
+/*   All compiler state is reset at the start of each call, so it may be     */
+/*   called any number of times, but the compiler is not reentrant: only     */
+/*   one call may be running in a process at any one time.                   */
+/* ------------------------------------------------------------------------- */
+
+extern int inform_library_compile(int argc, char **argv,
+    const char *source_text, long source_length,
+    const inform_library_callbacks *callbacks);
+
+/* ------------------------------------------------------------------------- */
+/*   inform_library_build_id() returns a string identifying this build of    */
+/*   the compiler: its release, and when it was compiled.  It changes        */
+/*   whenever the library is rebuilt, so a host which keeps the results of   */
+/*   earlier compilations can tell when they may be out of date.             */
+/* ------------------------------------------------------------------------- */
+
+extern const char *inform_library_build_id(void);
+
+#endif
@@ -578,8 +578,31 @@ static void print_context(int c)
     if ((c & 2048) != 0) printf("sp ");
 }
 
-static int *keywords_hash_table;
-static int *keywords_hash_ends_table;
+/* ------------------------------------------------------------------------- */
+/*   Keywords are found through a perfect hash table, made when the lexer    */
+/*   starts up (the opcode names depend on the target VM, so it can't be    */
+/*   made any sooner).  Keywords which are the same up to case, such as      */
+/*   "The" and "the", or "has" the condition and "has" the segment marker,   */
+/*   share one slot and are chained together in keywords_data_table, in the  */
+/*   order of keyword_groups[]; every other pair of keywords lands in a      */
+/*   different slot.  The slot for an identifier is found from its full      */
+/*   (case-insensitive) hash code, which the lexer needs for the symbols     */
+/*   table anyway: the top bits choose a bucket, and each bucket has its     */
+/*   own displacement, chosen when the table is made so that its keywords    */
+/*   fall in vacant slots ("hash and displace").  So an identifier is        */
+/*   classified with one hash code comparison and at most one strcmpcis()    */
+/*   against the only keyword it could possibly be.                         */
+/* ------------------------------------------------------------------------- */
+
+#define KEYWORD_SLOTS    1024                    /*  Both must be powers of  */
+#define KEYWORD_BUCKETS   256                    /*  2, and comfortably more */
+#define KEYWORD_BUCKET_BITS 8                    /*  than MAX_KEYWORDS/2     */
+
+static int *keywords_slot_table;                 /*  First entry in each slot,
+                                                     or -1 if vacant         */
+static uint32 *keywords_slot_codes;              /*  Full hash code of the
+                                                     keyword in each slot    */
+static int32 *keywords_displacements;            /*  One for each bucket     */
 static int *keywords_data_table;
 
 static int *local_variable_hash_table;
@@ -589,9 +612,26 @@ static char *local_variable_text_table;
 
 static char one_letter_locals[128];
 
+static int keyword_bucket(uint32 code)
+{   return (int) ((((uint32) code * 0x9E3779B1UL) & 0xFFFFFFFFUL)
+                  >> (32 - KEYWORD_BUCKET_BITS));
+}
+
+static int keyword_slot(uint32 code, int32 displacement)
+{   code = (code ^ ((uint32) displacement * 0x2545F491UL)) & 0xFFFFFFFFUL;
+    code ^= code >> 16;
+    code = ((uint32) code * 0x45D9F3BUL) & 0xFFFFFFFFUL;
+    code ^= code >> 16;
+    return (int) (code & (KEYWORD_SLOTS - 1));
+}
+
 static void make_keywords_tables(void)
-{   int i, j, h, tp=0;
+{   int i, j, k, b, h, size, placed, tp=0, no_keys=0;
+    int32 d;
     char **oplist, **maclist;
+    uint32 key_codes[MAX_KEYWORDS];
+    int key_first[MAX_KEYWORDS], key_last[MAX_KEYWORDS];
+    int bucket_sizes[KEYWORD_BUCKETS], placed_slots[MAX_KEYWORDS];
 
     if (!glulx_mode) {
         oplist = opcode_list_z;
@@ -612,26 +652,67 @@ static void make_keywords_tables(void)
     }
     opcode_macros.keywords[j] = "";
 
-    for (i=0; i<HASH_TAB_SIZE; i++)
-    {   keywords_hash_table[i] = -1;
-        keywords_hash_ends_table[i] = -1;
-    }
+    /*  First gather the keywords into "keys", each a chain of keywords
+        which are the same up to case.                                       */
 
     for (i=1; i<=11; i++)
     {   keyword_group *kg = keyword_groups[i];
         for (j=0; *(kg->keywords[j]) != 0; j++)
-        {   h = hash_code_from_string(kg->keywords[j]);
-            if (keywords_hash_table[h] == -1)
-                keywords_hash_table[h] = tp;
-            else
-              *(keywords_data_table + 3*(keywords_hash_ends_table[h]) + 2) = tp;
-            keywords_hash_ends_table[h] = tp;
+        {   uint32 code = full_hash_code_from_string(kg->keywords[j]);
+            if (tp >= MAX_KEYWORDS)
+                compiler_error("Too many keywords for MAX_KEYWORDS");
             *(keywords_data_table + 3*tp) = i;
             *(keywords_data_table + 3*tp+1) = j;
             *(keywords_data_table + 3*tp+2) = -1;
+            for (k=0; k<no_keys; k++)
+            {   if (key_codes[k] == code)
+                {   int *first = keywords_data_table + 3*key_last[k];
+                    if (strcmpcis(kg->keywords[j],
+                        keyword_groups[*first]->keywords[*(first+1)]) != 0)
+                        compiler_error("Two keywords have the same hash code");
+                    *(first+2) = tp; key_last[k] = tp;
+                    break;
+                }
+            }
+            if (k == no_keys)
+            {   key_codes[no_keys] = code;
+                key_first[no_keys] = tp; key_last[no_keys] = tp;
+                no_keys++;
+            }
             tp++;
         }
     }
+
+    /*  Then place the keys, bucket by bucket, largest buckets first, trying
+        displacements until one puts every key in the bucket into a vacant
+        slot.                                                                */
+
+    for (i=0; i<KEYWORD_SLOTS; i++) keywords_slot_table[i] = -1;
+    for (i=0; i<KEYWORD_BUCKETS; i++)
+    {   keywords_displacements[i] = 0; bucket_sizes[i] = 0;
+    }
+    for (k=0; k<no_keys; k++) bucket_sizes[keyword_bucket(key_codes[k])]++;
+
+    for (size = MAX_KEYWORDS; size > 0; size--)
+    for (b=0; b<KEYWORD_BUCKETS; b++)
+    {   if (bucket_sizes[b] != size) continue;
+        for (d=0; ; d++)
+        {   if (d == 1000000L)
+                compiler_error("Unable to make keywords hash table");
+            placed = 0;
+            for (k=0; k<no_keys; k++)
+            {   if (keyword_bucket(key_codes[k]) != b) continue;
+                h = keyword_slot(key_codes[k], d);
+                if (keywords_slot_table[h] != -1) break;
+                keywords_slot_table[h] = key_first[k];
+                keywords_slot_codes[h] = key_codes[k];
+                placed_slots[placed++] = h;
+            }
+            if (k == no_keys) break;
+            while (placed > 0) keywords_slot_table[placed_slots[--placed]] = -1;
+        }
+        keywords_displacements[b] = d;
+    }
 }
 
 extern void construct_local_variable_tables(void)
@@ -659,12 +740,12 @@ extern void construct_local_variable_tables(void)
 }
 
 static void interpret_identifier(int pos, int dirs_only_flag)
-{   int index, hashcode; char *p = circle[pos].text;
+{   int index, hashcode; uint32 full_hashcode; char *p = circle[pos].text;
 
     /*  An identifier is either a keyword or a "symbol", a name which the
         lexical analyser leaves to higher levels of Inform to understand.    */
 
-    hashcode = hash_code_from_string(p);
+    full_hashcode = full_hash_code_from_string(p);
 
     if (dirs_only_flag) goto KeywordSearch;
 
@@ -686,6 +767,7 @@ static void interpret_identifier(int pos, int dirs_only_flag)
                 return;
             }
         }
+        hashcode = (int) (full_hashcode % HASH_TAB_SIZE);
         index = local_variable_hash_table[hashcode];
         if (index >= 0)
         {   for (;index<no_locals;index++)
@@ -704,15 +786,20 @@ static void interpret_identifier(int pos, int dirs_only_flag)
         the name of a system function which has been Replaced.               */
 
     KeywordSearch:
-    index = keywords_hash_table[hashcode];
+    hashcode = keyword_slot(full_hashcode,
+        keywords_displacements[keyword_bucket(full_hashcode)]);
+    index = keywords_slot_table[hashcode];
+    if ((index >= 0) && ((keywords_slot_codes[hashcode] != full_hashcode)
+        || (strcmpcis(p, keyword_groups[keywords_data_table[3*index]]
+            ->keywords[keywords_data_table[3*index+1]]) != 0)))
+        index = -1;
     while (index >= 0)
     {   int *i = keywords_data_table + 3*index;
         keyword_group *kg = keyword_groups[*i];
         if (((!dirs_only_flag) && (kg->enabled))
             || (dirs_only_flag && (kg == &directives)))
         {   char *q = kg->keywords[*(i+1)];
-            if (((kg->case_sensitive) && (strcmp(p, q)==0))
-                || ((!(kg->case_sensitive)) && (strcmpcis(p, q)==0)))
+            if ((!(kg->case_sensitive)) || (strcmp(p, q)==0))
             {   if ((kg != &system_functions)
                     || (system_function_usage[*(i+1)]!=2))
                 {   circle[pos].type = kg->change_token_type;
@@ -728,7 +815,7 @@ static void interpret_identifier(int pos, int dirs_only_flag)
 
     /*  Search for the name; create it if necessary.                         */
 
-    circle[pos].value = symbol_index(p, hashcode);
+    circle[pos].value = symbol_index(p, (int32) full_hashcode);
     circle[pos].type = SYMBOL_TT;
 }
 
@@ -1146,14 +1233,22 @@ static int32 construct_float(int signbit, double intv, double fracv, int expo)
 /*   The routine returns the number of characters it has written, and note   */
 /*   that this conveniently ensures that all characters in the buffer come   */
 /*   from the same file.                                                     */
+/*                                                                           */
+/*   Each file is read in whole when it is opened, SOURCE_BUFFER_SIZE bytes  */
+/*   at a time, into a buffer which grows to fit it, and is passed through   */
+/*   source_to_iso_grid[] there and then.  So the buffer always holds the    */
+/*   rest of the file, already filtered, and its "size" is negative (see     */
+/*   above).  This allows the lexer to skip through comments with memchr()   */
+/*   rather than a character at a time: see skip_comment_in_pipeline().      */
 /* ------------------------------------------------------------------------- */
 
 #define SOURCE_BUFFER_SIZE 4096                  /*  Typical disc block size */
 
 typedef struct Sourcefile_s
 {   char *buffer;                                /*  Input buffer            */
-    int   read_pos;                              /*  Read position in buffer */
-    int   size;                                  /*  Number of meaningful
+    int32 buffer_size;                           /*  Its malloced size       */
+    int32 read_pos;                              /*  Read position in buffer */
+    int32 size;                                  /*  Number of meaningful
                                                      characters in buffer    */
     int   la, la2, la3;                          /*  Three characters of
                                                      lookahead pipeline      */
@@ -1169,14 +1264,38 @@ static Sourcefile *CF;                           /*  Top entry on stack      */
 
 static int last_no_files;
 
+static void load_whole_file(Sourcefile *F)
+{   int32 at = 0, i; int n; uchar *p;
+
+    while (TRUE)
+    {   if (at + SOURCE_BUFFER_SIZE + 4 > F->buffer_size)
+        {   int32 newsize = 2*F->buffer_size;
+            if (newsize < at + SOURCE_BUFFER_SIZE + 4)
+                newsize = at + SOURCE_BUFFER_SIZE + 4;
+            my_realloc(&(F->buffer), F->buffer_size, newsize,
+                "source file buffer");
+            F->buffer_size = newsize;
+        }
+        n = file_load_chars(F->file_no, F->buffer + at, SOURCE_BUFFER_SIZE);
+        if (n == SOURCE_BUFFER_SIZE) { at += n; continue; }
+        if (n < 0) { at += -n; break; }
+
+        /*  The file had already been closed: treat it as empty  */
+        for (i=0; i<4; i++) F->buffer[at+i] = 0;
+        at += 4; break;
+    }
+    F->size = -at;
+
+    p = (uchar *) F->buffer;
+    for (i=0; i<at; i++) p[i] = source_to_iso_grid[p[i]];
+}
+
 static void begin_buffering_file(int i, int file_no)
 {   int j, cnt; uchar *p;
 
     if (i >= MAX_INCLUSION_DEPTH) 
        memoryerror("MAX_INCLUSION_DEPTH",MAX_INCLUSION_DEPTH);
 
-    p = (uchar *) FileStack[i].buffer;
-
     if (i>0)
     {   FileStack[i-1].la  = lookahead;
         FileStack[i-1].la2 = lookahead2;
@@ -1184,11 +1303,11 @@ static void begin_buffering_file(int i, int file_no)
     }
 
     FileStack[i].file_no = file_no;
-    FileStack[i].size = file_load_chars(file_no,
-        (char *) p, SOURCE_BUFFER_SIZE);
-    lookahead  = source_to_iso_grid[p[0]];
-    lookahead2 = source_to_iso_grid[p[1]];
-    lookahead3 = source_to_iso_grid[p[2]];
+    load_whole_file(&(FileStack[i]));
+    p = (uchar *) FileStack[i].buffer;
+    lookahead  = p[0];
+    lookahead2 = p[1];
+    lookahead3 = p[2];
     if (LOOKAHEAD_SIZE != 3)
         compiler_error
             ("Lexer lookahead size does not match hard-coded lookahead code");
@@ -1240,12 +1359,6 @@ static int get_next_char_from_pipeline(void)
     {   lookahead  = 0; lookahead2 = 0; lookahead3 = 0; return 0;
     }
 
-    if (CF->read_pos == CF->size)
-    {   CF->size =
-            file_load_chars(CF->file_no, CF->buffer, SOURCE_BUFFER_SIZE);
-        CF->read_pos = 0;
-    }
-    else
     if (CF->read_pos == -(CF->size))
     {   set_token_location(get_current_debug_location());
         File_sp--;
@@ -1255,11 +1368,6 @@ static int get_next_char_from_pipeline(void)
         CF = &(FileStack[File_sp-1]);
         CurrentLB = &(FileStack[File_sp-1].LB);
         lookahead  = CF->la; lookahead2 = CF->la2; lookahead3 = CF->la3;
-        if (CF->read_pos == CF->size)
-        {   CF->size =
-                file_load_chars(CF->file_no, CF->buffer, SOURCE_BUFFER_SIZE);
-            CF->read_pos = 0;
-        }
         set_token_location(get_current_debug_location());
     }
 
@@ -1268,7 +1376,7 @@ static int get_next_char_from_pipeline(void)
     current = lookahead;
     lookahead = lookahead2;
     lookahead2 = lookahead3;
-    lookahead3 = source_to_iso_grid[p[CF->read_pos++]];
+    lookahead3 = p[CF->read_pos++];
 
     CurrentLB->chars_read++;
     if (forerrors_pointer < 511)
@@ -1277,6 +1385,46 @@ static int get_next_char_from_pipeline(void)
     return(current);
 }
 
+static int skip_comment_in_pipeline(void)
+{
+    /*  Has exactly the same effect as calling get_next_char_from_pipeline()
+        until lookahead is '\n' or 0, but finds that point with memchr().
+        The three lookahead characters are the three bytes before read_pos,
+        and the buffer holds the rest of the file, which ends in a '\n' or 0
+        terminator.  Returns FALSE (having done nothing) if this isn't
+        currently possible, or if the end of the file is too near.           */
+
+    uchar *p, *from, *to, *z; int32 k, end;
+
+    if ((File_sp == 0) || (last_no_files < input_file)) return FALSE;
+    if (CF->read_pos < LOOKAHEAD_SIZE) return FALSE;
+
+    p = (uchar *) (CF->buffer);
+    end = -(CF->size) - LOOKAHEAD_SIZE;
+    from = p + CF->read_pos - LOOKAHEAD_SIZE;
+    if (from - p > end) return FALSE;
+    to = memchr(from, '\n', end - (from - p));
+    if (to == NULL) to = p + end;
+    z = memchr(from, 0, to - from);
+    if (z != NULL) to = z;
+    if (to == p + end) return FALSE;
+
+    k = to - from;
+    if (k == 0) return TRUE;
+
+    if (forerrors_pointer < 511)
+    {   int32 n = 511 - forerrors_pointer;
+        if (n > k) n = k;
+        memcpy(forerrors_buff + forerrors_pointer, from, n);
+        forerrors_pointer += n;
+    }
+    CurrentLB->chars_read += k;
+    CF->read_pos += k;
+    current = to[-1];
+    lookahead = to[0]; lookahead2 = to[1]; lookahead3 = to[2];
+    return TRUE;
+}
+
 /* ------------------------------------------------------------------------- */
 /*   Source 2: from a string                                                 */
 /* ------------------------------------------------------------------------- */
@@ -1388,6 +1536,9 @@ extern void get_next_token(void)
             goto StartTokenAgain;
 
         case COMMENT_CODE:
+            if ((get_next_char == get_next_char_from_pipeline)
+                && (skip_comment_in_pipeline()))
+                goto StartTokenAgain;
             while ((lookahead != '\n') && (lookahead != 0))
                 (*get_next_char)();
             goto StartTokenAgain;
@@ -1743,14 +1894,19 @@ extern void lexer_allocate_arrays(void)
         "filestack buffer");
 
     for (i=0; i<MAX_INCLUSION_DEPTH; i++)
-    FileStack[i].buffer = my_malloc(SOURCE_BUFFER_SIZE+4, "source file buffer");
+    {   FileStack[i].buffer = my_malloc(SOURCE_BUFFER_SIZE+4,
+            "source file buffer");
+        FileStack[i].buffer_size = SOURCE_BUFFER_SIZE+4;
+    }
 
     lexeme_memory = my_malloc(5*MAX_QTEXT_SIZE, "lexeme memory");
 
-    keywords_hash_table = my_calloc(sizeof(int), HASH_TAB_SIZE,
+    keywords_slot_table = my_calloc(sizeof(int), KEYWORD_SLOTS,
         "keyword hash table");
-    keywords_hash_ends_table = my_calloc(sizeof(int), HASH_TAB_SIZE,
-        "keyword hash end table");
+    keywords_slot_codes = my_calloc(sizeof(uint32), KEYWORD_SLOTS,
+        "keyword hash codes");
+    keywords_displacements = my_calloc(sizeof(int32), KEYWORD_BUCKETS,
+        "keyword hash displacements");
     keywords_data_table = my_calloc(sizeof(int), 3*MAX_KEYWORDS,
         "keyword hashing linked list");
     local_variable_hash_table = my_calloc(sizeof(int), HASH_TAB_SIZE,
@@ -1791,8 +1947,9 @@ extern void lexer_free_arrays(void)
     my_free(&FileStack, "filestack buffer");
     my_free(&lexeme_memory, "lexeme memory");
 
-    my_free(&keywords_hash_table, "keyword hash table");
-    my_free(&keywords_hash_ends_table, "keyword hash end table");
+    my_free(&keywords_slot_table, "keyword hash table");
+    my_free(&keywords_slot_codes, "keyword hash codes");
+    my_free(&keywords_displacements, "keyword hash displacements");
     my_free(&keywords_data_table, "keyword hashing linked list");
     my_free(&local_variable_hash_table, "local variable hash table");
     my_free(&local_variable_text_table, "text of local variable names");
@@ -1800,7 +1957,13 @@ extern void lexer_free_arrays(void)
     my_free(&local_variable_hash_codes, "local variable hash codes");
     my_free(&local_variable_texts, "local variable text pointers");
 
-    cleanup_token_locations(NULL);
+    /*  Any locations still referenced by an unfinished beginning go too     */
+
+    while (first_token_locations)
+    {   debug_locations *moribund = first_token_locations;
+        first_token_locations = moribund->next;
+        my_free(&moribund, "debug locations of recent tokens");
+    }
 }
 
 /* ========================================================================= */
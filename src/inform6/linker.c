@@ -809,8 +809,7 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
     /* (10) Glue in the dynamic array data */
 
     i = m_static_offset - m_vars_offset - MAX_GLOBAL_VARIABLES*2;
-    if (dynamic_array_area_size + i >= MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_dynamic_array_area(dynamic_array_area_size + i);
 
     if (linker_trace_level >= 2)
         printf("Inserting dynamic array area, %04x to %04x, at %04x\n",
@@ -828,13 +827,16 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
       printf("Inserting code area, %04x to %04x, at code offset %04x (+%04x)\n",
         m_code_offset, m_strs_offset, code_offset, zmachine_pc);
 
-    for (k=m_code_offset;k<m_strs_offset;k++)
-    {   if (temporary_files_switch)
-        {   fputc(p[k],Temp2_fp);
-            zmachine_pc++;
+    if (temporary_files_switch)
+    {   if (m_strs_offset > m_code_offset)
+        {   fwrite(p+m_code_offset, 1, m_strs_offset-m_code_offset, Temp2_fp);
+            zmachine_pc += m_strs_offset-m_code_offset;
         }
-        else
-            write_byte_to_memory_block(&zcode_area, zmachine_pc++, p[k]);
+    }
+    else if (m_strs_offset > m_code_offset)
+    {   write_bytes_to_memory_block(&zcode_area, zmachine_pc,
+            p+m_code_offset, m_strs_offset-m_code_offset);
+        zmachine_pc += m_strs_offset-m_code_offset;
     }
 
     /* (12) Glue in the static strings area */
@@ -844,14 +846,16 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
 at strings offset %04x (+%04x)\n",
         m_strs_offset, link_offset, strings_offset,
         static_strings_extent);
-    for (k=m_strs_offset;k<link_offset;k++)
-    {   if (temporary_files_switch)
-        {   fputc(p[k], Temp1_fp);
-            static_strings_extent++;
+    if (temporary_files_switch)
+    {   if (link_offset > m_strs_offset)
+        {   fwrite(p+m_strs_offset, 1, link_offset-m_strs_offset, Temp1_fp);
+            static_strings_extent += link_offset-m_strs_offset;
         }
-        else
-            write_byte_to_memory_block(&static_strings_area,
-                    static_strings_extent++, p[k]);
+    }
+    else if (link_offset > m_strs_offset)
+    {   write_bytes_to_memory_block(&static_strings_area,
+            static_strings_extent, p+m_strs_offset, link_offset-m_strs_offset);
+        static_strings_extent += link_offset-m_strs_offset;
     }
 
     /* (13) Append the class object-numbers table: note that modules
@@ -929,6 +933,8 @@ at strings offset %04x (+%04x)\n",
         if (linker_trace_level >= 2)
             printf("Inserting object properties area, %04x to %04x, at +%04x\n",
                 m_props_offset, last, properties_table_size);
+        ensure_properties_table(properties_table_size
+            + last - m_props_offset);
         for (k=0;k<last-m_props_offset;k++)
             properties_table[properties_table_size++] = p[m_props_offset+k];
     }
@@ -941,9 +947,7 @@ at strings offset %04x (+%04x)\n",
     /* (17) Append the individual property values table */
 
     i = m_individuals_length;
-    if (individuals_length + i >= MAX_INDIV_PROP_TABLE_SIZE)
-        memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-            MAX_INDIV_PROP_TABLE_SIZE);
+    ensure_individuals_table(individuals_length + i);
 
     if (linker_trace_level >= 2)
       printf("Inserting individual prop tables area, %04x to %04x, at +%04x\n",
@@ -982,14 +986,13 @@ static void write_link_byte(int x)
 }
 
 extern void flush_link_data(void)
-{   int32 i, j;
+{   int32 j;
     j = subtract_pointers(link_data_top, link_data_holding_area);
     if (temporary_files_switch)
-        for (i=0;i<j;i++) fputc(link_data_holding_area[i], Temp3_fp);
+        fwrite(link_data_holding_area, 1, j, Temp3_fp);
     else
-        for (i=0;i<j;i++)
-            write_byte_to_memory_block(&link_data_area, link_data_size-j+i,
-            link_data_holding_area[i]);
+        write_bytes_to_memory_block(&link_data_area, link_data_size-j,
+            link_data_holding_area, j);
     link_data_top=link_data_holding_area;
 }
 
@@ -10,6 +10,7 @@
 #include "header.h"
 
 int32 malloced_bytes=0;                /* Total amount of memory allocated   */
+int32 malloc_calls=0;                  /* and the number of requests for it  */
 
 #ifdef PC_QUICKC
 
@@ -19,6 +20,7 @@ extern void *my_malloc(int32 size, char *whatfor)
         printf("Allocating %ld bytes for %s\n",size,whatfor);
     if (size==0) return(NULL);
     c=(char _huge *)halloc(size,1); malloced_bytes+=size;
+    malloc_calls++;
     if (c==0) memory_out_error(size, 1, whatfor);
     return(c);
 }
@@ -31,6 +33,7 @@ extern void my_realloc(void *pointer, int32 oldsize, int32 size,
         return;
     }
     c=halloc(size,1); malloced_bytes+=size;
+    malloc_calls++;
     if (c==0) memory_out_error(size, 1, whatfor);
     if (memout_switch)
         printf("Increasing allocation to %ld bytes for %s was (%08lx) \
@@ -49,6 +52,7 @@ extern void *my_calloc(int32 size, int32 howmany, char *whatfor)
             size*howmany,howmany,size,whatfor);
     if ((size*howmany) == 0) return(NULL);
     c=(void _huge *)halloc(howmany*size,1); malloced_bytes+=size*howmany;
+    malloc_calls++;
     if (c==0) memory_out_error(size, howmany, whatfor);
     return(c);
 }
@@ -61,6 +65,7 @@ extern void my_recalloc(void *pointer, int32 size, int32 oldhowmany,
         return;
     }
     c=(void _huge *)halloc(size*howmany,1); malloced_bytes+=size*howmany;
+    malloc_calls++;
     if (c==0) memory_out_error(size, howmany, whatfor);
     if (memout_switch)
         printf("Increasing allocation to %ld bytes: array (%ld entries size %ld) \
@@ -79,6 +84,7 @@ extern void *my_malloc(int32 size, char *whatfor)
 {   char *c;
     if (size==0) return(NULL);
     c=malloc((size_t) size); malloced_bytes+=size;
+    malloc_calls++;
     if (c==0) memory_out_error(size, 1, whatfor);
     if (memout_switch)
         printf("Allocating %ld bytes for %s at (%08lx)\n",
@@ -94,6 +100,7 @@ extern void my_realloc(void *pointer, int32 oldsize, int32 size,
         return;
     }
     c=realloc(*(int **)pointer, (size_t) size); malloced_bytes+=size;
+    malloc_calls++;
     if (c==0) memory_out_error(size, 1, whatfor);
     if (memout_switch)
         printf("Increasing allocation to %ld bytes for %s was (%08lx) \
@@ -107,6 +114,7 @@ extern void *my_calloc(int32 size, int32 howmany, char *whatfor)
 {   void *c;
     if (size*howmany==0) return(NULL);
     c=calloc(howmany,(size_t) size); malloced_bytes+=size*howmany;
+    malloc_calls++;
     if (c==0) memory_out_error(size, howmany, whatfor);
     if (memout_switch)
         printf("Allocating %ld bytes: array (%ld entries size %ld) \
@@ -126,6 +134,7 @@ extern void my_recalloc(void *pointer, int32 size, int32 oldhowmany,
     }
     c=realloc(*(int **)pointer, (size_t)size*(size_t)howmany); 
     malloced_bytes+=size*howmany;
+    malloc_calls++;
     if (c==0) memory_out_error(size, howmany, whatfor);
     if (memout_switch)
         printf("Increasing allocation to %ld bytes: array (%ld entries size %ld) \
@@ -153,68 +162,110 @@ extern void my_free(void *pointer, char *whatitwas)
     }
 }
 
+/* ------------------------------------------------------------------------- */
+/*   Growable arrays.  Most tables used to be allocated once, at the size    */
+/*   given by a memory setting, with a "memory setting exceeded" error when  */
+/*   they filled up.  The setting is now only the initial size: when a       */
+/*   table fills, it is reallocated at (at least) twice the size, and the    */
+/*   setting variable is updated to record the new allocation.               */
+/* ------------------------------------------------------------------------- */
+
+extern int32 grown_memory_size(int32 howmany, int32 needed)
+{   int32 newsize = (howmany < 8) ? 16 : 2*howmany;
+    while (newsize < needed) newsize *= 2;
+    return newsize;
+}
+
+extern void my_regrow(void *pointer, int32 size, int32 oldhowmany,
+    int32 howmany, char *whatfor)
+{   /*  As my_recalloc, but the new entries are zeroed, just as if the
+        array had been made by my_calloc at the new size                    */
+
+    my_recalloc(pointer, size, oldhowmany, howmany, whatfor);
+    if (howmany > oldhowmany)
+        memset(*(char **)pointer + size*oldhowmany, 0,
+            size*(howmany-oldhowmany));
+}
+
 /* ------------------------------------------------------------------------- */
 /*   Extensible blocks of memory, providing a kind of RAM disc as an         */
-/*   alternative to the temporary files option                               */
+/*   alternative to the temporary files option.                              */
+/*                                                                           */
+/*   A memory block is a single contiguous buffer which doubles in size      */
+/*   whenever a write falls beyond it: it starts at ALLOC_CHUNK_SIZE bytes.  */
+/*   Bytes which have never been written read back as 255.                   */
 /* ------------------------------------------------------------------------- */
 
-static char chunk_name_buffer[60];
-static char *chunk_name(memory_block *MB, int no)
+static char *block_name(memory_block *MB)
 {   char *p = "(unknown)";
     if (MB == &static_strings_area) p = "static strings area";
     if (MB == &zcode_area)          p = "Z-code area";
     if (MB == &link_data_area)      p = "link data area";
     if (MB == &zcode_backpatch_table) p = "Z-code backpatch table";
     if (MB == &zmachine_backpatch_table) p = "Z-machine backpatch table";
-    sprintf(chunk_name_buffer, "%s chunk %d", p, no);
-    return(chunk_name_buffer);
+    return(p);
 }
 
 extern void initialise_memory_block(memory_block *MB)
-{   int i;
-    MB->chunks = 0;
-    for (i=0; i<72; i++) MB->chunk[i] = NULL;
-    MB->extent_of_last = 0;
-    MB->write_pos = 0;
+{   MB->data = NULL;
+    MB->size = 0;
 }
 
 extern void deallocate_memory_block(memory_block *MB)
-{   int i;
-    for (i=0; i<72; i++)
-        if (MB->chunk[i] != NULL)
-            my_free(&(MB->chunk[i]), chunk_name(MB, i));
-    MB->chunks = 0;
-    MB->extent_of_last = 0;
+{   if (MB->data != NULL)
+        my_free(&(MB->data), block_name(MB));
+    MB->size = 0;
+}
+
+static void extend_memory_block(memory_block *MB, int32 extent)
+{   int32 newsize = (MB->size == 0)?ALLOC_CHUNK_SIZE:MB->size;
+    if (newsize < 1) newsize = 1;
+    while (newsize < extent)
+    {   if (newsize > 0x3fffffff)
+            memoryerror("ALLOC_CHUNK_SIZE", ALLOC_CHUNK_SIZE);
+        newsize *= 2;
+    }
+    my_realloc(&(MB->data), MB->size, newsize, block_name(MB));
+    memset(MB->data + MB->size, 255, newsize - MB->size);
+    MB->size = newsize;
 }
 
 extern int read_byte_from_memory_block(memory_block *MB, int32 index)
-{   uchar *p;
-    p = MB->chunk[index/ALLOC_CHUNK_SIZE];
-    if (p == NULL)
+{   if ((index < 0) || (index >= MB->size))
     {   compiler_error_named("memory: read from unwritten byte in",
-            chunk_name(MB, index/ALLOC_CHUNK_SIZE));
+            block_name(MB));
         return 0;
     }
-    return p[index % ALLOC_CHUNK_SIZE];
+    return MB->data[index];
 }
 
-extern void write_byte_to_memory_block(memory_block *MB, int32 index, int value)
-{   uchar *p; int ch = index/ALLOC_CHUNK_SIZE;
-    if (ch < 0)
-    {   compiler_error_named("memory: negative index to", chunk_name(MB, 0));
+extern void read_bytes_from_memory_block(memory_block *MB, int32 index,
+    uchar *to, int32 length)
+{   if ((index < 0) || (length < 0) || (index + length > MB->size))
+    {   compiler_error_named("memory: read from unwritten byte in",
+            block_name(MB));
         return;
     }
-    if (ch >= 72) memoryerror("ALLOC_CHUNK_SIZE", ALLOC_CHUNK_SIZE);
+    memcpy(to, MB->data + index, (size_t) length);
+}
 
-    if (MB->chunk[ch] == NULL)
-    {   int i;
-        MB->chunk[ch] = my_malloc(ALLOC_CHUNK_SIZE, chunk_name(MB, ch));
-        p = MB->chunk[ch];
-        for (i=0; i<ALLOC_CHUNK_SIZE; i++) p[i] = 255;
+extern void write_byte_to_memory_block(memory_block *MB, int32 index, int value)
+{   if (index < 0)
+    {   compiler_error_named("memory: negative index to", block_name(MB));
+        return;
     }
+    if (index >= MB->size) extend_memory_block(MB, index+1);
+    MB->data[index] = value;
+}
 
-    p = MB->chunk[ch];
-    p[index % ALLOC_CHUNK_SIZE] = value;
+extern void write_bytes_to_memory_block(memory_block *MB, int32 index,
+    uchar *from, int32 length)
+{   if ((index < 0) || (length < 0))
+    {   compiler_error_named("memory: negative index to", block_name(MB));
+        return;
+    }
+    if (index + length > MB->size) extend_memory_block(MB, index+length);
+    memcpy(MB->data + index, from, (size_t) length);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -559,6 +610,30 @@ extern void adjust_memory_sizes()
   }
 }
 
+/*  The settings which no longer limit the size of a game, since the tables
+    they describe grow as needed (see grown_memory_size() above)             */
+
+static char *growable_settings[] =
+{   "MAX_SYMBOLS", "SYMBOLS_CHUNK_SIZE", "MAX_OBJECTS", "MAX_CLASSES",
+    "MAX_ACTIONS", "MAX_ADJECTIVES", "MAX_VERBS", "MAX_LINESPACE",
+    "MAX_VERBSPACE", "MAX_DICT_ENTRIES", "MAX_LABELS", "MAX_ZCODE_SIZE",
+    "MAX_STATIC_STRINGS", "MAX_LOW_STRINGS", "MAX_NUM_STATIC_STRINGS",
+    "MAX_TRANSCRIPT_SIZE", "MAX_UNICODE_CHARS", "MAX_ARRAYS",
+    "MAX_STATIC_DATA", "MAX_PROP_TABLE_SIZE", "MAX_INDIV_PROP_TABLE_SIZE",
+    "MAX_OBJ_PROP_COUNT", "MAX_OBJ_PROP_TABLE_SIZE", "MAX_EXPRESSION_NODES",
+    NULL
+};
+
+static void explain_growth(char *command)
+{   int i;
+    for (i=0; growable_settings[i] != NULL; i++)
+        if (strcmp(command, growable_settings[i])==0)
+        {   printf(
+"\n  (This is only the initial allocation: Inform enlarges it as needed.)\n");
+            return;
+        }
+}
+
 static void explain_parameter(char *command)
 {   printf("\n");
     if (strcmp(command,"MAX_QTEXT_SIZE")==0)
@@ -582,8 +657,8 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"HASH_TAB_SIZE")==0)
     {   printf(
-"  HASH_TAB_SIZE is the size of the hash tables used for the heaviest \n\
-  symbols banks.\n");
+"  HASH_TAB_SIZE is the size of the hash tables used for keywords and \n\
+  local variable names.  (The symbols table sizes itself as it grows.)\n");
         return;
     }
     if (strcmp(command,"MAX_OBJECTS")==0)
@@ -682,10 +757,11 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"MAX_EXPRESSION_NODES")==0)
     {   printf(
-"  MAX_EXPRESSION_NODES is the maximum number of nodes in the expression \n\
-  evaluator's storage for parse trees.  In effect, it measures how \n\
-  complicated algebraic expressions are allowed to be.  Increasing it by \n\
-  one costs about 80 bytes.\n");
+"  MAX_EXPRESSION_NODES is the number of nodes in the expression \n\
+  evaluator's storage for parse trees, which is reused for each statement.\n\
+  In effect, it measures how complicated an algebraic expression can be \n\
+  before the storage has to be enlarged.  Increasing it by one costs about\n\
+  80 bytes.\n");
         return;
     }
     if (strcmp(command,"MAX_VERBS")==0)
@@ -823,7 +899,8 @@ static void explain_parameter(char *command)
     {
         printf(
 "  ALLOC_CHUNK_SIZE is a base unit of Inform's internal memory allocation \n\
-  for various structures.\n");
+  for various structures: it is the initial size of the blocks which hold \n\
+  the compiled code and strings, which then double as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_STACK_SIZE")==0)
@@ -921,7 +998,9 @@ extern void memory_command(char *command)
     for (k=0; command[k]!=0; k++)
         if (islower(command[k])) command[k]=toupper(command[k]);
 
-    if (command[0]=='?') { explain_parameter(command+1); return; }
+    if (command[0]=='?')
+    {   explain_parameter(command+1); explain_growth(command+1); return;
+    }
 
     if (strcmp(command, "HUGE")==0) { set_memory_sizes(HUGE_SIZE); return; }
     if (strcmp(command, "LARGE")==0) { set_memory_sizes(LARGE_SIZE); return; }
@@ -1100,7 +1179,7 @@ extern void print_memory_usage(void)
 /* ------------------------------------------------------------------------- */
 
 extern void init_memory_vars(void)
-{   malloced_bytes = 0;
+{   malloced_bytes = 0; malloc_calls = 0;
 }
 
 extern void memory_begin_pass(void) { }
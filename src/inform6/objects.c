@@ -393,6 +393,50 @@ extern void list_object_tree(void)
 /*   Property inheritance from classes.                                      */
 /* ------------------------------------------------------------------------- */
 
+/* ------------------------------------------------------------------------- */
+/*   The property tables grow as needed: MAX_PROP_TABLE_SIZE,                */
+/*   MAX_INDIV_PROP_TABLE_SIZE, MAX_OBJ_PROP_COUNT and                       */
+/*   MAX_OBJ_PROP_TABLE_SIZE record how much has been allocated.  Code        */
+/*   holding a pointer into one of these tables must recalculate it after    */
+/*   asking for more room.                                                   */
+/* ------------------------------------------------------------------------- */
+
+extern void ensure_properties_table(int32 size)
+{   int32 n;
+    if (size <= MAX_PROP_TABLE_SIZE) return;
+    n = grown_memory_size(MAX_PROP_TABLE_SIZE, size);
+    my_regrow(&properties_table, sizeof(char), MAX_PROP_TABLE_SIZE, n,
+        "properties table");
+    MAX_PROP_TABLE_SIZE = n;
+}
+
+extern void ensure_individuals_table(int32 size)
+{   int32 n;
+    if (size <= MAX_INDIV_PROP_TABLE_SIZE) return;
+    n = grown_memory_size(MAX_INDIV_PROP_TABLE_SIZE, size);
+    my_regrow(&individuals_table, sizeof(uchar), MAX_INDIV_PROP_TABLE_SIZE,
+        n, "individual properties table");
+    MAX_INDIV_PROP_TABLE_SIZE = n;
+}
+
+static void ensure_object_props_g(int32 count)
+{   int32 n;
+    if (count <= MAX_OBJ_PROP_COUNT) return;
+    n = grown_memory_size(MAX_OBJ_PROP_COUNT, count);
+    my_regrow(&full_object_g.props, sizeof(propg), MAX_OBJ_PROP_COUNT, n,
+        "object property list");
+    MAX_OBJ_PROP_COUNT = n;
+}
+
+static void ensure_object_propdata_g(int32 count)
+{   int32 n;
+    if (count <= MAX_OBJ_PROP_TABLE_SIZE) return;
+    n = grown_memory_size(MAX_OBJ_PROP_TABLE_SIZE, count);
+    my_regrow(&full_object_g.propdata, sizeof(assembly_operand),
+        MAX_OBJ_PROP_TABLE_SIZE, n, "object property data table");
+    MAX_OBJ_PROP_TABLE_SIZE = n;
+}
+
 static void property_inheritance_z(void)
 {
     /*  Apply the property inheritance rules to full_object, which should
@@ -402,12 +446,21 @@ static void property_inheritance_z(void)
         On exit, full_object contains the final state of the properties to
         be written.                                                          */
 
-    int i, j, k, kmax, class, mark,
+    int i, j, k, class, mark,
         prop_number, prop_length, prop_in_current_defn;
+    int prop_index[64];
     uchar *class_prop_block;
 
     ASSERT_ZCODE();
 
+    /*  prop_index[n] is where property n first appears in full_object, or
+        -1 if it doesn't, so that each class property can be matched up
+        without searching                                                    */
+
+    for (k=0; k<64; k++) prop_index[k] = -1;
+    for (k=full_object.l-1; k>=0; k--)
+        prop_index[full_object.pp[k].num] = k;
+
     for (class=0; class<no_classes_to_inherit_from; class++)
     {
         j=0;
@@ -436,92 +489,84 @@ static void property_inheritance_z(void)
 
             prop_in_current_defn = FALSE;
 
-            kmax = full_object.l;
+            k = prop_index[prop_number];
+            if (k >= 0)
+            {   prop_in_current_defn = TRUE;
 
-            for (k=0; k<kmax; k++)
-                if (full_object.pp[k].num == prop_number)
-                {   prop_in_current_defn = TRUE;
+                /*  (Note that the built-in "name" property is additive) */
 
-                    /*  (Note that the built-in "name" property is additive) */
-
-                    if ((prop_number==1) || (prop_is_additive[prop_number]))
-                    {
-                        /*  The additive case: we accumulate the class
-                            property values onto the end of the full_object
-                            property                                         */
-
-                        for (i=full_object.pp[k].l;
-                             i<full_object.pp[k].l+prop_length/2; i++)
-                        {   if (i >= 32)
-                            {   error("An additive property has inherited \
+                if ((prop_number==1) || (prop_is_additive[prop_number]))
+                {
+                    /*  The additive case: we accumulate the class
+                        property values onto the end of the full_object
+                        property                                             */
+
+                    for (i=full_object.pp[k].l;
+                         i<full_object.pp[k].l+prop_length/2; i++)
+                    {   if (i >= 32)
+                        {   error("An additive property has inherited \
 so many values that the list has overflowed the maximum 32 entries");
-                                break;
-                            }
-                            full_object.pp[k].ao[i].value = mark + j;
-                            j += 2;
-                            full_object.pp[k].ao[i].marker = INHERIT_MV;
-                            full_object.pp[k].ao[i].type = LONG_CONSTANT_OT;
+                            break;
                         }
-                        full_object.pp[k].l += prop_length/2;
+                        full_object.pp[k].ao[i].value = mark + j;
+                        j += 2;
+                        full_object.pp[k].ao[i].marker = INHERIT_MV;
+                        full_object.pp[k].ao[i].type = LONG_CONSTANT_OT;
                     }
-                    else
-                        /*  The ordinary case: the full_object property
-                            values simply overrides the class definition,
-                            so we skip over the values in the class table    */
-
-                        j+=prop_length;
-
-                    if (prop_number==3)
-                    {   int y, z, class_block_offset;
-                        uchar *p;
-
-                        /*  Property 3 holds the address of the table of
-                            instance variables, so this is the case where
-                            the object already has instance variables in its
-                            own table but must inherit some more from the
-                            class  */
-
-                        class_block_offset = class_prop_block[j-2]*256
-                                             + class_prop_block[j-1];
-
-                        p = individuals_table + class_block_offset;
-                        z = class_block_offset;
-                        while ((p[0]!=0)||(p[1]!=0))
-                        {   int already_present = FALSE, l;
-                            for (l = full_object.pp[k].ao[0].value; l < i_m;
-                                 l = l + 3 + individuals_table[l + 2])
-                                if (individuals_table[l] == p[0]
-                                    && individuals_table[l + 1] == p[1])
-                                {   already_present = TRUE; break;
-                                }
-                            if (already_present == FALSE)
-                            {   if (module_switch)
-                                    backpatch_zmachine(IDENT_MV,
-                                        INDIVIDUAL_PROP_ZA, i_m);
-                                if (i_m+3+p[2] > MAX_INDIV_PROP_TABLE_SIZE)
-                                    memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                                        MAX_INDIV_PROP_TABLE_SIZE);
-                                individuals_table[i_m++] = p[0];
-                                individuals_table[i_m++] = p[1];
-                                individuals_table[i_m++] = p[2];
-                                for (y=0;y < p[2]/2;y++)
-                                {   individuals_table[i_m++] = (z+3+y*2)/256;
-                                    individuals_table[i_m++] = (z+3+y*2)%256;
-                                    backpatch_zmachine(INHERIT_INDIV_MV,
-                                        INDIVIDUAL_PROP_ZA, i_m-2);
-                                }
+                    full_object.pp[k].l += prop_length/2;
+                }
+                else
+                    /*  The ordinary case: the full_object property
+                        values simply overrides the class definition,
+                        so we skip over the values in the class table        */
+
+                    j+=prop_length;
+
+                if (prop_number==3)
+                {   int y, z, class_block_offset;
+                    uchar *p;
+
+                    /*  Property 3 holds the address of the table of
+                        instance variables, so this is the case where
+                        the object already has instance variables in its
+                        own table but must inherit some more from the
+                        class  */
+
+                    class_block_offset = class_prop_block[j-2]*256
+                                         + class_prop_block[j-1];
+
+                    p = individuals_table + class_block_offset;
+                    z = class_block_offset;
+                    while ((p[0]!=0)||(p[1]!=0))
+                    {   int already_present = FALSE, l;
+                        for (l = full_object.pp[k].ao[0].value; l < i_m;
+                             l = l + 3 + individuals_table[l + 2])
+                            if (individuals_table[l] == p[0]
+                                && individuals_table[l + 1] == p[1])
+                            {   already_present = TRUE; break;
+                            }
+                        if (already_present == FALSE)
+                        {   if (module_switch)
+                                backpatch_zmachine(IDENT_MV,
+                                    INDIVIDUAL_PROP_ZA, i_m);
+                            ensure_individuals_table(i_m+3+p[2]);
+                            p = individuals_table + z;
+                            individuals_table[i_m++] = p[0];
+                            individuals_table[i_m++] = p[1];
+                            individuals_table[i_m++] = p[2];
+                            for (y=0;y < p[2]/2;y++)
+                            {   individuals_table[i_m++] = (z+3+y*2)/256;
+                                individuals_table[i_m++] = (z+3+y*2)%256;
+                                backpatch_zmachine(INHERIT_INDIV_MV,
+                                    INDIVIDUAL_PROP_ZA, i_m-2);
                             }
-                            z += p[2] + 3;
-                            p += p[2] + 3;
                         }
-                        individuals_length = i_m;
+                        z += p[2] + 3;
+                        p += p[2] + 3;
                     }
-
-                    /*  For efficiency we exit the loop now (this property
-                        number has been dealt with)                          */
-
-                    break;
+                    individuals_length = i_m;
                 }
+            }
 
             if (!prop_in_current_defn)
             {
@@ -530,6 +575,7 @@ so many values that the list has overflowed the maximum 32 entries");
                     a new property added to full_object                      */
 
                 k=full_object.l++;
+                prop_index[prop_number] = k;
                 full_object.pp[k].num = prop_number;
                 full_object.pp[k].l = prop_length/2;
                 for (i=0; i<prop_length/2; i++)
@@ -565,9 +611,8 @@ so many values that the list has overflowed the maximum 32 entries");
                     while ((p[0]!=0)||(p[1]!=0))
                     {   if (module_switch)
                         backpatch_zmachine(IDENT_MV, INDIVIDUAL_PROP_ZA, i_m);
-                        if (i_m+3+p[2] > MAX_INDIV_PROP_TABLE_SIZE)
-                            memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                                MAX_INDIV_PROP_TABLE_SIZE);
+                        ensure_individuals_table(i_m+3+p[2]);
+                        p = individuals_table + z;
                         individuals_table[i_m++] = p[0];
                         individuals_table[i_m++] = p[1];
                         individuals_table[i_m++] = p[2];
@@ -588,9 +633,7 @@ so many values that the list has overflowed the maximum 32 entries");
 
     if (individual_prop_table_size > 0)
     {
-        if (i_m+2 > MAX_INDIV_PROP_TABLE_SIZE)
-            memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                MAX_INDIV_PROP_TABLE_SIZE);
+        ensure_individuals_table(i_m+2);
 
         individuals_table[i_m++] = 0;
         individuals_table[i_m++] = 0;
@@ -598,6 +641,37 @@ so many values that the list has overflowed the maximum 32 entries");
     }
 }
 
+/*  For Glulx, where property numbers run into the thousands, the same
+    index is kept in arrays indexed by property number: prop_index_first[n]
+    is where property n first appears in full_object_g.props, and
+    prop_index_lastcont[n] the continuation number of its last block there.
+    An entry is only valid if prop_index_stamp[n] is the current stamp, which
+    changes with each object, so the arrays never need to be cleared.        */
+
+static int32 *prop_index_stamp;
+static int   *prop_index_first, *prop_index_lastcont;
+static int32  prop_index_size, prop_index_current_stamp;
+
+static void index_object_prop_g(int k)
+{   int num = full_object_g.props[k].num;
+    if (num < 0) return;
+    if (num >= prop_index_size)
+    {   int32 n = grown_memory_size(prop_index_size, num+1);
+        my_regrow(&prop_index_stamp, sizeof(int32), prop_index_size, n,
+            "property index stamps");
+        my_regrow(&prop_index_first, sizeof(int), prop_index_size, n,
+            "property index");
+        my_regrow(&prop_index_lastcont, sizeof(int), prop_index_size, n,
+            "property index continuations");
+        prop_index_size = n;
+    }
+    if (prop_index_stamp[num] != prop_index_current_stamp)
+    {   prop_index_stamp[num] = prop_index_current_stamp;
+        prop_index_first[num] = k;
+    }
+    prop_index_lastcont[num] = full_object_g.props[k].continuation;
+}
+
 static void property_inheritance_g(void)
 {
   /*  Apply the property inheritance rules to full_object, which should
@@ -614,6 +688,10 @@ static void property_inheritance_g(void)
 
   ASSERT_GLULX();
 
+  prop_index_current_stamp++;
+  for (k=0; k<full_object_g.numprops; k++)
+    index_object_prop_g(k);
+
   for (class=0; class<no_classes_to_inherit_from; class++) {
     mark = class_begins_at[classes_to_inherit_from[class]-1];
     cpb = (uchar *) (properties_table + mark);
@@ -637,14 +715,11 @@ static void property_inheritance_g(void)
           Question now is: is there already a value given in the
           current definition under this property name? */
 
-      prop_in_current_defn = FALSE;
-
-      for (k=0; k<full_object_g.numprops; k++) {
-        if (full_object_g.props[k].num == prop_number) {
-          prop_in_current_defn = TRUE;
-          break;
-        }
-      }
+      prop_in_current_defn =
+        ((prop_number < prop_index_size)
+         && (prop_index_stamp[prop_number] == prop_index_current_stamp));
+      if (prop_in_current_defn)
+        k = prop_index_first[prop_number];
 
       if (prop_in_current_defn) {
         if ((prop_number==1)
@@ -660,23 +735,17 @@ static void property_inheritance_g(void)
             prevcont = 1;
           }
           else {
-            prevcont = full_object_g.props[k].continuation;
-            for (k++; k<full_object_g.numprops; k++) {
-              if (full_object_g.props[k].num == prop_number) {
-                prevcont = full_object_g.props[k].continuation;
-              }
-            }
+            prevcont = prop_index_lastcont[prop_number];
           }
+          ensure_object_props_g(full_object_g.numprops+1);
           k = full_object_g.numprops++;
           full_object_g.props[k].num = prop_number;
           full_object_g.props[k].flags = 0;
           full_object_g.props[k].datastart = full_object_g.propdatasize;
           full_object_g.props[k].continuation = prevcont+1;
           full_object_g.props[k].datalen = prop_length;
-          if (full_object_g.propdatasize + prop_length 
-            > MAX_OBJ_PROP_TABLE_SIZE) {
-            memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-          }
+          index_object_prop_g(k);
+          ensure_object_propdata_g(full_object_g.propdatasize + prop_length);
 
           for (i=0; i<prop_length; i++) {
             int ppos = full_object_g.propdatasize++;
@@ -695,16 +764,16 @@ static void property_inheritance_g(void)
             /*  The case where the class defined a property which wasn't
                 defined at all in full_object_g: we copy out the data into
                 a new property added to full_object_g. */
+            ensure_object_props_g(full_object_g.numprops+1);
             k = full_object_g.numprops++;
             full_object_g.props[k].num = prop_number;
             full_object_g.props[k].flags = prop_flags;
             full_object_g.props[k].datastart = full_object_g.propdatasize;
             full_object_g.props[k].continuation = 0;
             full_object_g.props[k].datalen = prop_length;
-            if (full_object_g.propdatasize + prop_length 
-              > MAX_OBJ_PROP_TABLE_SIZE) {
-              memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-            }
+            index_object_prop_g(k);
+            ensure_object_propdata_g(full_object_g.propdatasize
+                + prop_length);
 
             for (i=0; i<prop_length; i++) {
               int ppos = full_object_g.propdatasize++;
@@ -713,10 +782,6 @@ static void property_inheritance_g(void)
               full_object_g.propdata[ppos].type = CONSTANT_OT;
             }
           }
-
-          if (full_object_g.numprops == MAX_OBJ_PROP_COUNT) {
-            memoryerror("MAX_OBJ_PROP_COUNT",MAX_OBJ_PROP_COUNT);
-          }
     }
   }
   
@@ -726,16 +791,16 @@ static void property_inheritance_g(void)
 /*   Construction of Z-machine-format property blocks.                       */
 /* ------------------------------------------------------------------------- */
 
-static int write_properties_between(uchar *p, int mark, int from, int to)
+static int write_properties_between(int mark, int from, int to)
 {   int j, k, prop_number, prop_length;
-    /* Note that p is properties_table. */
+    uchar *p;
     for (prop_number=to; prop_number>=from; prop_number--)
     {   for (j=0; j<full_object.l; j++)
         {   if ((full_object.pp[j].num == prop_number)
                 && (full_object.pp[j].l != 100))
             {   prop_length = 2*full_object.pp[j].l;
-                if (mark+2+prop_length >= MAX_PROP_TABLE_SIZE)
-                    memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
+                ensure_properties_table(mark+2+prop_length+1);
+                p = (uchar *) properties_table;
                 if (version_number == 3)
                     p[mark++] = prop_number + (prop_length - 1)*32;
                 else
@@ -761,6 +826,8 @@ static int write_properties_between(uchar *p, int mark, int from, int to)
         }
     }
 
+    ensure_properties_table(mark+1);
+    p = (uchar *) properties_table;
     p[mark++]=0;
     return(mark);
 }
@@ -775,14 +842,14 @@ static int write_property_block_z(char *shortname)
         Return the number of bytes written to the block.                     */
 
     int32 mark = properties_table_size, i;
-    uchar *p = (uchar *) properties_table;
+    uchar *p;
 
     /* printf("Object at %04x\n", mark); */
 
     if (shortname != NULL)
     {   uchar *tmp;
-        if (mark+1+510 >= MAX_PROP_TABLE_SIZE)
-            memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
+        ensure_properties_table(mark+1+510+1);
+        p = (uchar *) properties_table;
         tmp = translate_text(p+mark+1,p+mark+1+510,shortname);
         if (!tmp) error ("Short name of object exceeded 765 Z-characters");
         i = subtract_pointers(tmp,(p+mark+1));
@@ -790,13 +857,15 @@ static int write_property_block_z(char *shortname)
         mark += i+1;
     }
     if (current_defn_is_class)
-    {   mark = write_properties_between(p,mark,3,3);
+    {   mark = write_properties_between(mark,3,3);
+        ensure_properties_table(mark+6);
+        p = (uchar *) properties_table;
         for (i=0;i<6;i++)
             p[mark++] = full_object.atts[i];
         class_begins_at[no_classes++] = mark;
     }
 
-    mark = write_properties_between(p, mark, 1, (version_number==3)?31:63);
+    mark = write_properties_between(mark, 1, (version_number==3)?31:63);
 
     i = mark - properties_table_size;
     properties_table_size = mark;
@@ -833,7 +902,15 @@ static int32 write_property_block_g(void)
   int ix, jx, kx, totalprops;
   int32 mark = properties_table_size;
   int32 datamark;
-  uchar *p = (uchar *) properties_table;
+  uchar *p;
+
+  /* Reserve room for the whole block: the attributes, the count, ten
+     bytes of header and four bytes of data for each property. */
+  i = mark + NUM_ATTR_BYTES + 4;
+  for (ix=0; ix<full_object_g.numprops; ix++)
+    i += 10 + 4*full_object_g.props[ix].datalen;
+  ensure_properties_table(i);
+  p = (uchar *) properties_table;
 
   if (current_defn_is_class) {
     for (i=0;i<NUM_ATTR_BYTES;i++)
@@ -859,8 +936,6 @@ static int32 write_property_block_g(void)
   }
 
   /* Write out the number of properties in this table. */
-  if (mark+4 >= MAX_PROP_TABLE_SIZE)
-      memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
   WriteInt32(p+mark, totalprops);
   mark += 4;
 
@@ -877,8 +952,6 @@ static int32 write_property_block_g(void)
         jx<full_object_g.numprops && full_object_g.props[jx].num == propnum;
         jx++) {
       int32 datastart = full_object_g.props[jx].datastart;
-      if (datamark+4*full_object_g.props[jx].datalen >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
       for (kx=0; kx<full_object_g.props[jx].datalen; kx++) {
         int32 val = full_object_g.propdata[datastart+kx].value;
         WriteInt32(p+datamark, val);
@@ -889,8 +962,6 @@ static int32 write_property_block_g(void)
         datamark += 4;
       }
     }
-    if (mark+10 >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
     WriteInt16(p+mark, propnum);
     mark += 2;
     WriteInt16(p+mark, totallen);
@@ -912,6 +983,38 @@ static int32 write_property_block_g(void)
 /*   The final stage in Nearby/Object/Class definition processing.           */
 /* ------------------------------------------------------------------------- */
 
+/* ------------------------------------------------------------------------- */
+/*   The object and class tables grow as needed: MAX_OBJECTS and             */
+/*   MAX_CLASSES record how much has been allocated.                         */
+/* ------------------------------------------------------------------------- */
+
+static int32 classes_to_inherit_from_size; /* calloced size */
+
+static void ensure_objects(int32 count)
+{   int32 n;
+    if (count <= MAX_OBJECTS) return;
+    n = grown_memory_size(MAX_OBJECTS, count);
+    if (!glulx_mode)
+        my_regrow(&objectsz, sizeof(objecttz), MAX_OBJECTS, n, "z-objects");
+    else
+    {   my_regrow(&objectsg, sizeof(objecttg), MAX_OBJECTS, n, "g-objects");
+        my_regrow(&objectatts, NUM_ATTR_BYTES, MAX_OBJECTS, n,
+            "g-attributes");
+    }
+    MAX_OBJECTS = n;
+}
+
+static void ensure_classes(int32 count)
+{   int32 n;
+    if (count <= MAX_CLASSES) return;
+    n = grown_memory_size(MAX_CLASSES, count);
+    my_regrow(&class_begins_at, sizeof(int32), MAX_CLASSES, n,
+        "pointers to classes");
+    my_regrow(&class_object_numbers, sizeof(int), MAX_CLASSES, n,
+        "class object numbers");
+    MAX_CLASSES = n;
+}
+
 static void manufacture_object_z(void)
 {   int i, j;
 
@@ -920,6 +1023,7 @@ static void manufacture_object_z(void)
 
     property_inheritance_z();
 
+    ensure_objects(no_objects+1);
     objectsz[no_objects].parent = parent_of_this_obj;
     objectsz[no_objects].next = 0;
     objectsz[no_objects].child = 0;
@@ -941,8 +1045,6 @@ static void manufacture_object_z(void)
     j = write_property_block_z(shortname_buffer);
 
     objectsz[no_objects].propsize = j;
-    if (properties_table_size >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
 
     if (current_defn_is_class)
         for (i=0;i<6;i++) objectsz[no_objects].atts[i] = 0;
@@ -961,6 +1063,7 @@ static void manufacture_object_g(void)
 
     property_inheritance_g();
 
+    ensure_objects(no_objects+1);
     objectsg[no_objects].parent = parent_of_this_obj;
     objectsg[no_objects].next = 0;
     objectsg[no_objects].child = 0;
@@ -987,8 +1090,6 @@ static void manufacture_object_g(void)
     objectsg[no_objects].propaddr = full_object_g.finalpropaddr;
 
     objectsg[no_objects].propsize = j;
-    if (properties_table_size >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
 
     if (current_defn_is_class)
         for (i=0;i<NUM_ATTR_BYTES;i++) 
@@ -1093,6 +1194,7 @@ and may not be used as a property name too",
                 i_m = individuals_length;
                 full_object.l++;
             }
+            ensure_individuals_table(i_m+3);
             individuals_table[i_m] = this_identifier_number/256;
             if (this_segment == PRIVATE_SEGMENT)
                 individuals_table[i_m] |= 0x80;
@@ -1226,6 +1328,7 @@ the names '%s' and '%s' actually refer to the same property",
             {   if (AO.marker != 0)
                     backpatch_zmachine(AO.marker, INDIVIDUAL_PROP_ZA,
                         i_m+3+length);
+                ensure_individuals_table(i_m+3+length+2);
                 individuals_table[i_m+3+length++] = AO.value/256;
                 individuals_table[i_m+3+length++] = AO.value%256;
             }
@@ -1246,7 +1349,8 @@ the names '%s' and '%s' actually refer to the same property",
 
         if (length == 0)
         {   if (individual_property)
-            {   individuals_table[i_m+3+length++] = 0;
+            {   ensure_individuals_table(i_m+3+length+2);
+                individuals_table[i_m+3+length++] = 0;
                 individuals_table[i_m+3+length++] = 0;
             }
             else
@@ -1269,9 +1373,6 @@ the names '%s' and '%s' actually refer to the same property",
 
         if (individual_property)
         {
-            if (individuals_length+length+3 > MAX_INDIV_PROP_TABLE_SIZE)
-                memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                    MAX_INDIV_PROP_TABLE_SIZE);
             individuals_table[i_m + 2] = length;
             individuals_length += length+3;
             i_m = individuals_length;
@@ -1352,6 +1453,7 @@ and may not be used as a property name too",
             defined_this_segment[def_t_s++] = token_value;
             property_number = svals[token_value];
 
+            ensure_object_props_g(full_object_g.numprops+1);
             next_prop=full_object_g.numprops++;
             full_object_g.props[next_prop].num = property_number;
             full_object_g.props[next_prop].flags = 
@@ -1374,6 +1476,7 @@ not 'private':", token_text);
             defined_this_segment[def_t_s++] = token_value;
             property_number = svals[token_value];
 
+            ensure_object_props_g(full_object_g.numprops+1);
             next_prop=full_object_g.numprops++;
             full_object_g.props[next_prop].num = property_number;
             full_object_g.props[next_prop].flags = 0;
@@ -1398,10 +1501,6 @@ the names '%s' and '%s' actually refer to the same property",
                 error(error_b);
             }
 
-        if (full_object_g.numprops == MAX_OBJ_PROP_COUNT) {
-          memoryerror("MAX_OBJ_PROP_COUNT",MAX_OBJ_PROP_COUNT);
-        }
-
         property_name_symbol = token_value;
         sflags[token_value] |= USED_SFLAG;
 
@@ -1489,9 +1588,7 @@ the names '%s' and '%s' actually refer to the same property",
                 break;
             }
 
-            if (full_object_g.propdatasize >= MAX_OBJ_PROP_TABLE_SIZE) {
-              memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-            }
+            ensure_object_propdata_g(full_object_g.propdatasize+1);
 
             full_object_g.propdata[full_object_g.propdatasize++] = AO;
             length += 1;
@@ -1614,6 +1711,13 @@ static void add_class_to_inheritance_list(int class_number)
     /*  Remember the inheritance list so that property inheritance can
         be sorted out later on, when the definition has been finished:       */
 
+    if (no_classes_to_inherit_from >= classes_to_inherit_from_size)
+    {   int32 n = grown_memory_size(classes_to_inherit_from_size,
+            no_classes_to_inherit_from+1);
+        my_regrow(&classes_to_inherit_from, sizeof(int),
+            classes_to_inherit_from_size, n, "inherited classes list");
+        classes_to_inherit_from_size = n;
+    }
     classes_to_inherit_from[no_classes_to_inherit_from++] = class_number;
 
     /*  Inheriting attributes from the class at once:                        */
@@ -1746,8 +1850,7 @@ extern void make_class(char * metaclass_name)
     current_defn_is_class = TRUE; no_classes_to_inherit_from = 0;
     individual_prop_table_size = 0;
 
-    if (no_classes==MAX_CLASSES)
-        memoryerror("MAX_CLASSES", MAX_CLASSES);
+    ensure_classes(no_classes+1);
 
     if (no_classes==VENEER_CONSTRAINT_ON_CLASSES)
         fatalerror("Inform's maximum possible number of classes (whatever \
@@ -1923,8 +2026,6 @@ extern void make_object(int nearby_flag,
 
     directives.enabled = FALSE;
 
-    if (no_objects==MAX_OBJECTS) memoryerror("MAX_OBJECTS", MAX_OBJECTS);
-
     sprintf(internal_name, "nameless_obj__%d", no_objects+1);
     objectname_text = internal_name;
 
@@ -2138,6 +2239,12 @@ extern void init_objects_vars(void)
     objectatts = NULL;
     classes_to_inherit_from = NULL;
     class_begins_at = NULL;
+
+    prop_index_stamp = NULL;
+    prop_index_first = NULL;
+    prop_index_lastcont = NULL;
+    prop_index_size = 0;
+    prop_index_current_stamp = 0;
 }
 
 extern void objects_begin_pass(void)
@@ -2198,6 +2305,7 @@ extern void objects_allocate_arrays(void)
 
     classes_to_inherit_from = my_calloc(sizeof(int), MAX_CLASSES,
                                 "inherited classes list");
+    classes_to_inherit_from_size = MAX_CLASSES;
     class_begins_at       = my_calloc(sizeof(int32), MAX_CLASSES,
                                 "pointers to classes");
     class_object_numbers  = my_calloc(sizeof(int),     MAX_CLASSES,
@@ -2246,7 +2354,12 @@ extern void objects_free_arrays(void)
 
     my_free(&defined_this_segment,"defined this segment table");
 
-    if (!glulx_mode) {
+    my_free(&prop_index_stamp, "property index stamps");
+    my_free(&prop_index_first, "property index");
+    my_free(&prop_index_lastcont, "property index continuations");
+    prop_index_size = 0;
+
+    if (glulx_mode) {
         my_free(&full_object_g.props, "object property list");
         my_free(&full_object_g.propdata, "object property data table");
     }
@@ -66,7 +66,7 @@ int no_named_constants;                         /* Copied into story file    */
 /*   allocated as needed in chunks of size SYMBOLS_CHUNK_SIZE.               */
 /* ------------------------------------------------------------------------- */
 
-#define MAX_SYMBOL_CHUNKS (100)
+#define INITIAL_SYMBOL_CHUNKS (100)
 
 static uchar *symbols_free_space,       /* Next byte free to hold new names  */
            *symbols_ceiling;            /* Pointer to the end of the current
@@ -75,6 +75,7 @@ static uchar *symbols_free_space,       /* Next byte free to hold new names  */
 static char** symbol_name_space_chunks; /* For chunks of memory used to hold
                                            the name strings of symbols       */
 static int no_symbol_name_space_chunks;
+static int32 symbol_name_space_chunks_size; /* calloced size */
 
 typedef struct value_pair_struct {
     int original_symbol;
@@ -85,35 +86,37 @@ static int symbol_replacements_count;
 static int symbol_replacements_size; /* calloced size */
 
 /* ------------------------------------------------------------------------- */
-/*   The symbols table is "hash-coded" into a disjoint union of linked       */
-/*   lists, so that for any symbol i, next_entry[i] is either -1 (meaning    */
-/*   that it's the last in its list) or the next in the list.                */
+/*   The symbols table is found through an open-addressed hash table:       */
+/*   symbol_hash_table[] holds symbol numbers (or -1 for an empty slot, or   */
+/*   -2 for a symbol removed by Undef), and a search starts at the slot      */
+/*   given by the symbol name's hash code and walks forward until it finds   */
+/*   the name or an empty slot.                                              */
 /*                                                                           */
-/*   Each list contains, in alphabetical order, all the symbols which share  */
-/*   the same "hash code" (a numerical function of the text of the symbol    */
-/*   name, designed with the aim that roughly equal numbers of symbols are   */
-/*   given each possible hash code).  The hash codes are 0 to HASH_TAB_SIZE  */
-/*   (which is a memory setting) minus 1: start_of_list[h] gives the first   */
-/*   symbol with hash code h, or -1 if no symbol exists with hash code h.    */
+/*   For each symbol i, symbol_hash_codes[i] keeps the full 32-bit hash      */
+/*   code of its name and symbol_name_lengths[i] the length, so that a       */
+/*   probe only compares names when both of these already agree.             */
 /*                                                                           */
-/*   Note that the running time of the symbol search algorithm is about      */
-/*                                                                           */
-/*       O ( n^2 / HASH_TAB_SIZE )                                           */
-/*                                                                           */
-/*   (where n is the number of symbols in the program) so that it is a good  */
-/*   idea to choose HASH_TAB_SIZE as large as conveniently possible.         */
+/*   The table size is a power of two, and the table is doubled (and the    */
+/*   symbols rehashed into it) whenever it becomes half full, so that the    */
+/*   expected cost of a search stays constant however many symbols there     */
+/*   are.  (HASH_TAB_SIZE no longer affects the symbols table.)              */
 /* ------------------------------------------------------------------------- */
 
-static int   *next_entry;
-static int32 *start_of_list;
+static uint32 *symbol_hash_codes;
+static int    *symbol_name_lengths;
+static int32  *symbol_hash_table;
+static int32  symbol_hash_table_size;   /* Always a power of two             */
+static int32  symbol_hash_table_used;   /* Slots not empty, including those
+                                           left behind by Undef              */
 
 /* ------------------------------------------------------------------------- */
 /*   Initialisation.                                                         */
 /* ------------------------------------------------------------------------- */
 
 static void init_symbol_banks(void)
-{   int i;
-    for (i=0; i<HASH_TAB_SIZE; i++) start_of_list[i] = -1;
+{   int32 i;
+    for (i=0; i<symbol_hash_table_size; i++) symbol_hash_table[i] = -1;
+    symbol_hash_table_used = 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -122,6 +125,11 @@ static void init_symbol_banks(void)
 /*   so that similar names do not produce the same number.)  Note that       */
 /*   30011 is prime.  It doesn't matter if the unsigned int to int cast      */
 /*   behaves differently on different ports.                                 */
+/*                                                                           */
+/*   full_hash_code_from_string() gives the whole 32-bit code, which the     */
+/*   symbols table uses; hash_code_from_string() reduces it to the range     */
+/*   0 to HASH_TAB_SIZE-1 for the lexer's keyword and local variable         */
+/*   tables.                                                                 */
 /* ------------------------------------------------------------------------- */
 
 int case_conversion_grid[128];
@@ -136,10 +144,14 @@ static void make_case_conversion_grid(void)
     for (i=0; i<26; i++) case_conversion_grid['A'+i]='a'+i;
 }
 
-extern int hash_code_from_string(char *p)
+extern uint32 full_hash_code_from_string(char *p)
 {   uint32 hashcode=0;
     for (; *p; p++) hashcode=hashcode*30011 + case_conversion_grid[(uchar)*p];
-    return (int) (hashcode % HASH_TAB_SIZE);
+    return hashcode;
+}
+
+extern int hash_code_from_string(char *p)
+{   return (int) (full_hash_code_from_string(p) % HASH_TAB_SIZE);
 }
 
 extern int strcmpcis(char *p, char *q)
@@ -161,65 +173,129 @@ extern int strcmpcis(char *p, char *q)
 /*   Symbol finding, creating, and removing.                                 */
 /* ------------------------------------------------------------------------- */
 
-extern int symbol_index(char *p, int hashcode)
+static void grow_symbol_arrays(void)
+{   int32 n = grown_memory_size(MAX_SYMBOLS, no_symbols+1);
+
+    my_regrow(&symbs,  sizeof(char *), MAX_SYMBOLS, n, "symbols");
+    my_regrow(&svals,  sizeof(int32),  MAX_SYMBOLS, n, "symbol values");
+    if (glulx_mode)
+        my_regrow(&smarks, sizeof(int), MAX_SYMBOLS, n, "symbol markers");
+    my_regrow(&slines, sizeof(int32),  MAX_SYMBOLS, n, "symbol lines");
+    my_regrow(&stypes, sizeof(char),   MAX_SYMBOLS, n, "symbol types");
+    my_regrow(&sflags, sizeof(int),    MAX_SYMBOLS, n, "symbol flags");
+    if (debugfile_switch)
+    {   my_regrow(&symbol_debug_backpatch_positions,
+            sizeof(maybe_file_position), MAX_SYMBOLS, n,
+            "symbol debug information backpatch positions");
+        my_regrow(&replacement_debug_backpatch_positions,
+            sizeof(maybe_file_position), MAX_SYMBOLS, n,
+            "replacement debug information backpatch positions");
+    }
+    my_regrow(&symbol_hash_codes, sizeof(uint32), MAX_SYMBOLS, n,
+        "symbol hash codes");
+    my_regrow(&symbol_name_lengths, sizeof(int), MAX_SYMBOLS, n,
+        "symbol name lengths");
+    MAX_SYMBOLS = n;
+}
+
+static int32 symbol_hash_slot(uint32 hashcode)
+{
+    /*  The starting slot for a search.  The low bits of the hash code are
+        weak (they depend only on the low bits of each character), so the
+        high bits are folded down into them first.                           */
+
+    hashcode ^= hashcode >> 16;
+    hashcode *= 0x45d9f3bL;
+    hashcode ^= hashcode >> 16;
+    return (int32) (hashcode & (symbol_hash_table_size - 1));
+}
+
+static void rehash_symbols(int32 newsize)
+{
+    /*  Make a fresh table of the given size and put every visible symbol
+        back into it, which also clears out the slots left by Undef.         */
+
+    int32 i, slot, *old_table = symbol_hash_table,
+          old_size = symbol_hash_table_size;
+
+    symbol_hash_table = my_calloc(sizeof(int32), newsize,
+        "symbol hash table");
+    symbol_hash_table_size = newsize;
+    init_symbol_banks();
+
+    for (i=0; i<old_size; i++)
+    {   int32 this = old_table[i];
+        if (this < 0) continue;
+        slot = symbol_hash_slot(symbol_hash_codes[this]);
+        while (symbol_hash_table[slot] != -1)
+            slot = (slot + 1) & (newsize - 1);
+        symbol_hash_table[slot] = this;
+        symbol_hash_table_used++;
+    }
+    my_free(&old_table, "symbol hash table");
+}
+
+extern int symbol_index(char *p, int32 hashcode)
 {
     /*  Return the index in the symbs/svals/sflags/stypes/... arrays of symbol
         "p", creating a new symbol with that name if it isn't already there.
+        "hashcode" is either full_hash_code_from_string(p), if the caller
+        already knows it, or -1.
 
         New symbols are created with flag UNKNOWN_SFLAG, value 0x100
         (a 2-byte quantity in Z-machine terms) and type CONSTANT_T.
 
         The string "p" is undamaged.                                         */
 
-    int32 new_entry, this, last; char *r;
-
-    if (hashcode == -1) hashcode = hash_code_from_string(p);
+    int32 this, slot, free_slot; int length; uint32 code;
 
-    this = start_of_list[hashcode]; last = -1;
+    code = (hashcode == -1) ? full_hash_code_from_string(p) : (uint32) hashcode;
+    length = strlen(p);
 
-    do
-    {   if (this == -1) break;
-
-        r = (char *)symbs[this];
-        new_entry = strcmpcis(r, p);
-        if (new_entry == 0) 
+    slot = symbol_hash_slot(code); free_slot = -1;
+    while ((this = symbol_hash_table[slot]) != -1)
+    {   if (this == -2)
+        {   if (free_slot == -1) free_slot = slot;
+        }
+        else if ((symbol_hash_codes[this] == code)
+                 && (symbol_name_lengths[this] == length)
+                 && (strcmpcis((char *) symbs[this], p) == 0))
         {
             if (track_unused_routines)
                 df_note_function_symbol(this);
             return this;
         }
-        if (new_entry > 0) break;
-
-        last = this;
-        this = next_entry[this];
-    } while (this != -1);
+        slot = (slot + 1) & (symbol_hash_table_size - 1);
+    }
 
-    if (no_symbols >= MAX_SYMBOLS)
-        memoryerror("MAX_SYMBOLS", MAX_SYMBOLS);
+    if (no_symbols >= MAX_SYMBOLS) grow_symbol_arrays();
 
-    if (last == -1)
-    {   next_entry[no_symbols]=start_of_list[hashcode];
-        start_of_list[hashcode]=no_symbols;
-    }
+    if (free_slot != -1)
+        symbol_hash_table[free_slot] = no_symbols;
     else
-    {   next_entry[no_symbols]=this;
-        next_entry[last]=no_symbols;
+    {   symbol_hash_table[slot] = no_symbols;
+        symbol_hash_table_used++;
     }
+    symbol_hash_codes[no_symbols] = code;
+    symbol_name_lengths[no_symbols] = length;
 
     if (symbols_free_space+strlen(p)+1 >= symbols_ceiling)
-    {   symbols_free_space
-            = my_malloc(SYMBOLS_CHUNK_SIZE, "symbol names chunk");
-        symbols_ceiling = symbols_free_space + SYMBOLS_CHUNK_SIZE;
-        /* If we've passed MAX_SYMBOL_CHUNKS chunks, we print an error
-           message telling the user to increase SYMBOLS_CHUNK_SIZE.
-           That is the correct cure, even though the error comes out
-           worded inaccurately. */
-        if (no_symbol_name_space_chunks >= MAX_SYMBOL_CHUNKS)
-            memoryerror("SYMBOLS_CHUNK_SIZE", SYMBOLS_CHUNK_SIZE);
+    {   /*  A name longer than a whole chunk gets a chunk of its own  */
+        int32 chunk_size = SYMBOLS_CHUNK_SIZE;
+        if (chunk_size < (int32) strlen(p)+1) chunk_size = strlen(p)+1;
+        symbols_free_space
+            = my_malloc(chunk_size, "symbol names chunk");
+        symbols_ceiling = symbols_free_space + chunk_size;
+        if (no_symbol_name_space_chunks >= symbol_name_space_chunks_size)
+        {   int32 n = grown_memory_size(symbol_name_space_chunks_size,
+                no_symbol_name_space_chunks+1);
+            my_regrow(&symbol_name_space_chunks, sizeof(char *),
+                symbol_name_space_chunks_size, n,
+                "symbol names chunk addresses");
+            symbol_name_space_chunks_size = n;
+        }
         symbol_name_space_chunks[no_symbol_name_space_chunks++]
             = (char *) symbols_free_space;
-        if (symbols_free_space+strlen(p)+1 >= symbols_ceiling)
-            memoryerror("SYMBOLS_CHUNK_SIZE", SYMBOLS_CHUNK_SIZE);
     }
 
     strcpy((char *) symbols_free_space, p);
@@ -241,6 +317,10 @@ extern int symbol_index(char *p, int hashcode)
 
     if (track_unused_routines)
         df_note_function_symbol(no_symbols);
+
+    if (2*symbol_hash_table_used >= symbol_hash_table_size)
+        rehash_symbols(2*symbol_hash_table_size);
+
     return(no_symbols++);
 }
 
@@ -251,20 +331,14 @@ extern void end_symbol_scope(int k)
        If the symbol is not found, this silently does nothing.
     */
 
-    int j;
-    j = hash_code_from_string((char *) symbs[k]);
-    if (start_of_list[j] == k)
-    {   start_of_list[j] = next_entry[k];
-        return;
-    }
-    j = start_of_list[j];
-    while (j != -1)
-    {
-        if (next_entry[j] == k)
-        {   next_entry[j] = next_entry[k];
+    int32 j, slot;
+    slot = symbol_hash_slot(symbol_hash_codes[k]);
+    while ((j = symbol_hash_table[slot]) != -1)
+    {   if (j == k)
+        {   symbol_hash_table[slot] = -2;
             return;
         }
-        j = next_entry[j];
+        slot = (slot + 1) & (symbol_hash_table_size - 1);
     }
 }
 
@@ -824,7 +898,6 @@ struct df_function_struct {
 
     df_function_t *funcnext; /* in forward functions order */
     df_function_t *todonext; /* in the todo chain */
-    df_function_t *next; /* in the hash table */
 };
 
 struct df_reference_struct {
@@ -841,11 +914,6 @@ struct df_reference_struct {
 #define DF_USAGE_MAIN     (1<<2) /* Main() or Main__() */
 #define DF_USAGE_FUNCTION (1<<3) /* Used from another used function */
 
-#define DF_FUNCTION_HASH_BUCKETS (1023)
-
-/* Table of all compiled functions. (Only created if track_unused_routines
-   is set.) This is a hash table. */
-static df_function_t **df_functions;
 /* List of all compiled functions, in address order. The first entry
    has address DF_NOT_IN_FUNCTION, and stands in for the global namespace. */
 static df_function_t *df_functions_head;
@@ -854,10 +922,13 @@ static df_function_t *df_functions_tail;
    gotten. */
 static df_function_t *df_iterator;
 
-/* Array of all compiled functions in address order. (Does not include
-   the global namespace entry.) This is generated only if needed. */
+/* Array of all compiled functions in address order, added to as each
+   function is begun, so that any address can be found by binary search.
+   (Only created if track_unused_routines is set. Does not include the
+   global namespace entry.) */
 static df_function_t **df_functions_sorted;
-static int df_functions_sorted_count;
+static int32 df_functions_sorted_count;
+static int32 df_functions_sorted_size;
 
 #define DF_NOT_IN_FUNCTION ((uint32)0xFFFFFFFF)
 #define DF_SYMBOL_HASH_BUCKETS (4095)
@@ -887,7 +958,6 @@ extern void df_note_function_start(char *name, uint32 address,
     int embedded_flag, int32 source_line)
 {
     df_function_t *func;
-    int bucket;
 
     if (df_tables_closed)
         error("Internal error in stripping: Tried to start a new function after tables were closed.");
@@ -918,9 +988,19 @@ extern void df_note_function_start(char *name, uint32 address,
         df_functions_tail = func;
     }
 
-    bucket = address % DF_FUNCTION_HASH_BUCKETS;
-    func->next = df_functions[bucket];
-    df_functions[bucket] = func;
+    if (address != DF_NOT_IN_FUNCTION) {
+        if (df_functions_sorted_count > 0
+            && df_functions_sorted[df_functions_sorted_count-1]->address >= address)
+            compiler_error("DF: Function addresses are not increasing");
+        if (df_functions_sorted_count == df_functions_sorted_size) {
+            int32 n = grown_memory_size(df_functions_sorted_size,
+                df_functions_sorted_count+1);
+            my_regrow(&df_functions_sorted, sizeof(df_function_t *),
+                df_functions_sorted_size, n, "df function sorted table");
+            df_functions_sorted_size = n;
+        }
+        df_functions_sorted[df_functions_sorted_count++] = func;
+    }
 
     df_current_function = func;
 }
@@ -937,17 +1017,36 @@ extern void df_note_function_end(uint32 endaddress)
     df_current_function = df_functions_head; /* the global namespace */
 }
 
-/* Find the function record for a given address. (Addresses are offsets
-   in zcode_area.)
+/* Find the function record containing a given address, by binary search
+   of the sorted table: that is, the last function which begins at or
+   before it. Returns NULL if the address comes before every function.
+   (Addresses are offsets in zcode_area.)
 */
-static df_function_t *df_function_for_address(uint32 address)
+static df_function_t *df_function_containing_address(uint32 address)
 {
-    int bucket = address % DF_FUNCTION_HASH_BUCKETS;
-    df_function_t *func;
-    for (func = df_functions[bucket]; func; func = func->next) {
-        if (func->address == address)
-            return func;
+    int32 beg = 0, end = df_functions_sorted_count, mid;
+
+    /* Maintain: every entry before beg begins at or before the address,
+       and every entry from end on begins after it. */
+    while (beg < end) {
+        mid = (beg + end) / 2;
+        if (df_functions_sorted[mid]->address <= address)
+            beg = mid+1;
+        else
+            end = mid;
     }
+    if (beg == 0)
+        return NULL;
+    return df_functions_sorted[beg-1];
+}
+
+/* Find the function record for a given function address.
+*/
+static df_function_t *df_function_for_address(uint32 address)
+{
+    df_function_t *func = df_function_containing_address(address);
+    if (func && func->address == address)
+        return func;
     return NULL;
 }
 
@@ -1210,71 +1309,22 @@ extern uint32 df_stripped_address_for_address(uint32 addr)
 uint32 df_stripped_offset_for_code_offset(uint32 offset, int *stripped)
 {
     df_function_t *func;
-    int count;
 
     if (!track_unused_routines)
         compiler_error("DF: df_stripped_offset_for_code_offset called, but function references have not been mapped");
 
-    if (!df_functions_sorted) {
-        /* To do this efficiently, we need a binary-searchable table. Fine,
-           we'll make one. Include both used and unused functions. */
-
-        for (func = df_functions_head, count = 0; func; func = func->funcnext) {
-            if (func->address == DF_NOT_IN_FUNCTION)
-                continue;
-            count++;
-        }
-        df_functions_sorted_count = count;
-
-        df_functions_sorted = my_calloc(sizeof(df_function_t *), df_functions_sorted_count, "df function sorted table");
-
-        for (func = df_functions_head, count = 0; func; func = func->funcnext) {
-            if (func->address == DF_NOT_IN_FUNCTION)
-                continue;
-            df_functions_sorted[count] = func;
-            count++;
-        }
-    }
-
-    /* Do a binary search. Maintain beg <= res < end, where res is the
-       function containing the desired address. */
-    int beg = 0;
-    int end = df_functions_sorted_count;
-
     /* Set stripped flag until we decide on a non-stripped function. */
     *stripped = TRUE;
 
-    while (1) {
-        if (beg >= end) {
-            error("DF: offset_for_code_offset: Could not locate address.");
-            return 0;
-        }
-        if (beg+1 == end) {
-            func = df_functions_sorted[beg];
-            if (func->usage == 0)
-                return 0;
-            *stripped = FALSE;
-            return func->newaddress + (offset - func->address);
-        }
-        int new = (beg + end) / 2;
-        if (new <= beg || new >= end)
-            compiler_error("DF: binary search went off the rails");
-
-        func = df_functions_sorted[new];
-        if (offset >= func->address) {
-            if (offset < func->address+func->length) {
-                /* We don't need to loop further; decide here. */
-                if (func->usage == 0)
-                    return 0;
-                *stripped = FALSE;
-                return func->newaddress + (offset - func->address);
-            }
-            beg = new;
-        }
-        else {
-            end = new;
-        }
+    func = df_function_containing_address(offset);
+    if (!func || offset >= func->address+func->length) {
+        error("DF: offset_for_code_offset: Could not locate address.");
+        return 0;
     }
+    if (func->usage == 0)
+        return 0;
+    *stripped = FALSE;
+    return func->newaddress + (offset - func->address);
 }
 
 /* The output_file() routines in files.c have to run down the list of
@@ -1319,8 +1369,10 @@ extern void init_symbols_vars(void)
     smarks = NULL;
     stypes = NULL;
     sflags = NULL;
-    next_entry = NULL;
-    start_of_list = NULL;
+    symbol_hash_codes = NULL;
+    symbol_name_lengths = NULL;
+    symbol_hash_table = NULL;
+    symbol_hash_table_size = 0;
 
     symbol_name_space_chunks = NULL;
     no_symbol_name_space_chunks = 0;
@@ -1338,12 +1390,12 @@ extern void init_symbols_vars(void)
     track_unused_routines = (WARN_UNUSED_ROUTINES || OMIT_UNUSED_ROUTINES);
     df_tables_closed = FALSE;
     df_symbol_map = NULL;
-    df_functions = NULL;
     df_functions_head = NULL;
     df_functions_tail = NULL;
     df_current_function = NULL;
     df_functions_sorted = NULL;
     df_functions_sorted_count = 0;
+    df_functions_sorted_size = 0;
 }
 
 extern void symbols_begin_pass(void) 
@@ -1371,13 +1423,19 @@ extern void symbols_allocate_arrays(void)
             my_calloc(sizeof(maybe_file_position), MAX_SYMBOLS,
                       "replacement debug information backpatch positions");
     }
-    next_entry = my_calloc(sizeof(int),     MAX_SYMBOLS,
-                     "symbol linked-list forward links");
-    start_of_list = my_calloc(sizeof(int32), HASH_TAB_SIZE,
-                     "hash code list beginnings");
+    symbol_hash_codes = my_calloc(sizeof(uint32), MAX_SYMBOLS,
+                     "symbol hash codes");
+    symbol_name_lengths = my_calloc(sizeof(int), MAX_SYMBOLS,
+                     "symbol name lengths");
+    for (symbol_hash_table_size = 256;
+         symbol_hash_table_size < 2*MAX_SYMBOLS;
+         symbol_hash_table_size *= 2) ;
+    symbol_hash_table = my_calloc(sizeof(int32), symbol_hash_table_size,
+                     "symbol hash table");
 
     symbol_name_space_chunks
-        = my_calloc(sizeof(char *), MAX_SYMBOL_CHUNKS, "symbol names chunk addresses");
+        = my_calloc(sizeof(char *), INITIAL_SYMBOL_CHUNKS, "symbol names chunk addresses");
+    symbol_name_space_chunks_size = INITIAL_SYMBOL_CHUNKS;
 
     if (track_unused_routines) {
         df_tables_closed = FALSE;
@@ -1385,13 +1443,12 @@ extern void symbols_allocate_arrays(void)
         df_symbol_map = my_calloc(sizeof(df_reference_t *), DF_SYMBOL_HASH_BUCKETS, "df symbol-map hash table");
         memset(df_symbol_map, 0, sizeof(df_reference_t *) * DF_SYMBOL_HASH_BUCKETS);
 
-        df_functions = my_calloc(sizeof(df_function_t *), DF_FUNCTION_HASH_BUCKETS, "df function hash table");
-        memset(df_functions, 0, sizeof(df_function_t *) * DF_FUNCTION_HASH_BUCKETS);
         df_functions_head = NULL;
         df_functions_tail = NULL;
 
         df_functions_sorted = NULL;
         df_functions_sorted_count = 0;
+        df_functions_sorted_size = 0;
 
         df_note_function_start("<global namespace>", DF_NOT_IN_FUNCTION, FALSE, -1);
         df_note_function_end(DF_NOT_IN_FUNCTION);
@@ -1434,8 +1491,9 @@ extern void symbols_free_arrays(void)
             (&replacement_debug_backpatch_positions,
              "replacement debug information backpatch positions");
     }
-    my_free(&next_entry, "symbol linked-list forward links");
-    my_free(&start_of_list, "hash code list beginnings");
+    my_free(&symbol_hash_codes, "symbol hash codes");
+    my_free(&symbol_name_lengths, "symbol name lengths");
+    my_free(&symbol_hash_table, "symbol hash table");
 
     if (symbol_replacements)
         my_free(&symbol_replacements, "symbol replacement table");
@@ -1452,18 +1510,14 @@ extern void symbols_free_arrays(void)
         my_free(&df_symbol_map, "df symbol-map hash table");
     }
     if (df_functions_sorted) {
-        my_free(&df_functions, "df function sorted table");
+        my_free(&df_functions_sorted, "df function sorted table");
     }
-    if (df_functions) {
-        for (i=0; i<DF_FUNCTION_HASH_BUCKETS; i++) {
-            df_function_t *func = df_functions[i];
-            while (func) {
-                df_function_t *next = func->next;
-                my_free(&func, "df function entry");
-                func = next;
-            }
-        }
-        my_free(&df_functions, "df function hash table");
+    df_functions_sorted_count = 0;
+    df_functions_sorted_size = 0;
+    while (df_functions_head) {
+        df_function_t *next = df_functions_head->funcnext;
+        my_free(&df_functions_head, "df function entry");
+        df_functions_head = next;
     }
     df_functions_head = NULL;
     df_functions_tail = NULL;
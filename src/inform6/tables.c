@@ -863,6 +863,7 @@ or less.");
 
     /*  ---- Backpatch the Z-machine, now that all information is in ------- */
 
+    profile_phase(BACKPATCHING_PHASE);
     if (!module_switch && !skip_backpatching)
     {   backpatch_zmachine_image_z();
         for (i=1; i<id_names_length; i++)
@@ -922,6 +923,7 @@ or less.");
             }
         }
     }
+    profile_phase(CONSTRUCTION_PHASE);
 
     /*  ---- From here on, it's all reportage: construction is finished ---- */
 
@@ -988,6 +990,15 @@ Out:   Version %d \"%s\" %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
                  100 * (float)diff / (float)df_total_size_before_stripping);
             }
 
+            if (peephole_switch)
+            {   printf(
+"%6ld jumps removed by peephole    %6ld branches threaded by peephole\n\
+%6ld bytes saved by peephole optimisation\n",
+                 (long int) peephole_jumps_removed,
+                 (long int) peephole_branches_threaded,
+                 (long int) peephole_bytes_saved);
+            }
+
             printf(
 "%6ld characters used in text      %6ld bytes compressed (rate %d.%3ld)\n\
 %6d abbreviations (maximum %d)   %6d routines (unlimited)\n\
@@ -1202,7 +1213,9 @@ static void construct_storyfile_g(void)
     write_the_identifier_names();
     threespaces = compile_string("   ", FALSE, FALSE);
 
+    profile_phase(COMPRESSION_PHASE);
     compress_game_text();
+    profile_phase(CONSTRUCTION_PHASE);
 
     /*  We now know how large the buffer to hold our construction has to be  */
 
@@ -1556,6 +1569,7 @@ table format requested (producing number 2 format instead)");
 
     /*  ------ Backpatch the machine, now that all information is in ------- */
 
+    profile_phase(BACKPATCHING_PHASE);
     if (!module_switch)
     {   backpatch_zmachine_image_g();
 
@@ -1600,6 +1614,7 @@ table format requested (producing number 2 format instead)");
         }
 
     }
+    profile_phase(CONSTRUCTION_PHASE);
 
     /*  ---- From here on, it's all reportage: construction is finished ---- */
 
@@ -1670,6 +1685,15 @@ Out:   %s %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
                  100 * (float)diff / (float)df_total_size_before_stripping);
             }
 
+            if (peephole_switch)
+            {   printf(
+"%6ld jumps removed by peephole    %6ld branches threaded by peephole\n\
+%6ld bytes saved by peephole optimisation\n",
+                 (long int) peephole_jumps_removed,
+                 (long int) peephole_branches_threaded,
+                 (long int) peephole_bytes_saved);
+            }
+
             printf(
 "%6ld characters used in text      %6ld bytes compressed (rate %d.%3ld)\n\
 %6d abbreviations (maximum %d)   %6d routines (unlimited)\n\
@@ -84,7 +84,7 @@ int32 *compressed_offsets;             /* The beginning of every string in
 
 #define UNICODE_HASH_BUCKETS (64)
 unicode_usage_t *unicode_usage_entries;
-static unicode_usage_t *unicode_usage_hash[UNICODE_HASH_BUCKETS];
+static int unicode_usage_hash[UNICODE_HASH_BUCKETS];
 
 static int unicode_entity_index(int32 unicode);
 
@@ -218,15 +218,26 @@ extern void make_abbreviation(char *text)
 /* ------------------------------------------------------------------------- */
 
 extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
-{   int i, j; uchar *c;
+{   int i, j; uchar *c; int32 bound;
 
     is_abbreviation = is_abbrev;
 
+    /* Make sure the translation will fit in whichever area it goes into    */
+
+    bound = translated_text_size_bound(b);
+
     /* Put into the low memory pool (at 0x100 in the Z-machine) of strings   */
     /* which may be wanted as possible entries in the abbreviations table    */
 
     if (!glulx_mode && in_low_memory)
     {   j=subtract_pointers(low_strings_top,low_strings);
+        if (j + bound > MAX_LOW_STRINGS)
+        {   int32 n = grown_memory_size(MAX_LOW_STRINGS, j + bound);
+            my_realloc(&low_strings, MAX_LOW_STRINGS, n,
+                "low (abbreviation) strings");
+            low_strings_top = low_strings + j;
+            MAX_LOW_STRINGS = n;
+        }
         low_strings_top=translate_text(low_strings_top, low_strings+MAX_LOW_STRINGS, b);
         if (!low_strings_top)
             memoryerror("MAX_LOW_STRINGS", MAX_LOW_STRINGS);
@@ -237,6 +248,15 @@ extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
     if (glulx_mode && done_compression)
         compiler_error("Tried to add a string after compression was done.");
 
+    /* (allowing for the null bytes of packed-address alignment, too)      */
+
+    if (bound + 32 > MAX_STATIC_STRINGS)
+    {   int32 n = grown_memory_size(MAX_STATIC_STRINGS, bound + 32);
+        my_realloc(&strings_holding_area, MAX_STATIC_STRINGS, n,
+            "static strings holding area");
+        MAX_STATIC_STRINGS = n;
+    }
+
     c = translate_text(strings_holding_area, strings_holding_area+MAX_STATIC_STRINGS, b);
     if (!c)
         memoryerror("MAX_STATIC_STRINGS",MAX_STATIC_STRINGS);
@@ -263,14 +283,14 @@ extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
     j = static_strings_extent;
 
     if (temporary_files_switch)
-        for (c=strings_holding_area; c<strings_holding_area+i;
-             c++, static_strings_extent++)
-            fputc(*c,Temp1_fp);
+    {   fwrite(strings_holding_area, 1, i, Temp1_fp);
+        static_strings_extent += i;
+    }
     else
-        for (c=strings_holding_area; c<strings_holding_area+i;
-             c++, static_strings_extent++)
-            write_byte_to_memory_block(&static_strings_area,
-                static_strings_extent, *c);
+    {   write_bytes_to_memory_block(&static_strings_area,
+            static_strings_extent, strings_holding_area, i);
+        static_strings_extent += i;
+    }
 
     is_abbreviation = FALSE;
 
@@ -368,6 +388,18 @@ static void write_z_char_g(int i)
 /*   Note that the source text may be corrupted by this routine.             */
 /* ------------------------------------------------------------------------- */
 
+/* ------------------------------------------------------------------------- */
+/*   An upper bound on the number of bytes translate_text() can write for a  */
+/*   given source text: no source character becomes more than 8 Z-chars     */
+/*   (two four-Z-char ZSCII escapes), or more than 6 bytes of Glulx text     */
+/*   (an "@U" entity reference).  Growable buffers use this to make room     */
+/*   before translating, since a translation can't safely be retried.        */
+/* ------------------------------------------------------------------------- */
+
+extern int32 translated_text_size_bound(char *s_text)
+{   return 6*((int32) strlen(s_text)) + 16;
+}
+
 extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text)
 {   int i, j, k, in_alphabet, lookup_value;
     int32 unicode; int zscii;
@@ -406,7 +438,14 @@ extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text)
     if ((!is_abbreviation) && (store_the_text))
     {   no_chars_transcribed += strlen(s_text)+2;
         if (no_chars_transcribed >= MAX_TRANSCRIPT_SIZE)
-            memoryerror("MAX_TRANSCRIPT_SIZE", MAX_TRANSCRIPT_SIZE);
+        {   int32 used = subtract_pointers(all_text_top, all_text);
+            int32 n = grown_memory_size(MAX_TRANSCRIPT_SIZE,
+                no_chars_transcribed+1);
+            my_realloc(&all_text, MAX_TRANSCRIPT_SIZE, n,
+                "transcription text");
+            all_text_top = all_text + used;
+            MAX_TRANSCRIPT_SIZE = n;
+        }
         sprintf(all_text_top, "%s\n\n", s_text);
         all_text_top += strlen(all_text_top);
     }
@@ -759,35 +798,93 @@ static int unicode_entity_index(int32 unicode)
   int j;
   int buck = unicode % UNICODE_HASH_BUCKETS;
 
-  for (uptr = unicode_usage_hash[buck]; uptr; uptr=uptr->next) {
+  for (j = unicode_usage_hash[buck]; j != -1; j = uptr->next) {
+    uptr = unicode_usage_entries + j;
     if (uptr->ch == unicode)
-      break;
-  }
-  if (uptr) {
-    j = (uptr - unicode_usage_entries);
+      return j;
   }
-  else {
-    if (no_unicode_chars >= MAX_UNICODE_CHARS) {
-      memoryerror("MAX_UNICODE_CHARS", MAX_UNICODE_CHARS);
-      j = 0;
-    }
-    else {
-      j = no_unicode_chars;
-      no_unicode_chars++;
-      uptr = unicode_usage_entries + j;
-      uptr->ch = unicode;
-      uptr->next = unicode_usage_hash[buck];
-      unicode_usage_hash[buck] = uptr;
-    }
+
+  if (no_unicode_chars >= MAX_UNICODE_CHARS) {
+    int32 n = grown_memory_size(MAX_UNICODE_CHARS, no_unicode_chars+1);
+    my_regrow(&unicode_usage_entries, sizeof(unicode_usage_t),
+      MAX_UNICODE_CHARS, n, "unicode entity entries");
+    MAX_UNICODE_CHARS = n;
   }
+  j = no_unicode_chars;
+  no_unicode_chars++;
+  uptr = unicode_usage_entries + j;
+  uptr->ch = unicode;
+  uptr->next = unicode_usage_hash[buck];
+  unicode_usage_hash[buck] = j;
 
   return j;
 }
 
 /* ------------------------------------------------------------------------- */
 /*   Glulx compression code                                                  */
+/*                                                                           */
+/*   The uncompressed static strings are read back one "entity" at a time:   */
+/*   a character, the string terminator (256), or the entity which an @A,    */
+/*   @D or @U escape stands for (an abbreviation, dynamic string or Unicode  */
+/*   character).  The same reader serves both passes of compress_game_text() */
+/*   and the output of the strings in files.c.                               */
 /* ------------------------------------------------------------------------- */
 
+static int32 static_strings_read_pos;
+
+extern void begin_reading_static_strings(void)
+{ static_strings_read_pos = 0;
+  if (temporary_files_switch)
+    begin_reading_temp_file(Temp1_fp);
+}
+
+static int read_static_strings_byte(void)
+{ int ch;
+  if (static_strings_read_pos++ >= static_strings_extent) {
+    compiler_error("Read too much not-yet-compressed text.");
+    return 0;
+  }
+  if (!temporary_files_switch)
+    return static_strings_area.data[static_strings_read_pos-1];
+  ch = read_temp_file_byte();
+  if (ch < 0) {
+    compiler_error("Read too much not-yet-compressed text.");
+    return 0;
+  }
+  return ch;
+}
+
+extern int read_static_string_entity(void)
+{ int ch, escapetype, jx;
+  int32 escapeval;
+
+  ch = read_static_strings_byte();
+  if (ch == 0)
+    return 256;
+  if (ch != '@')
+    return ch;
+
+  ch = read_static_strings_byte();
+  if (ch == '@')
+    return '@';
+  if (ch == '0')
+    return 0;
+  if (ch != 'A' && ch != 'D' && ch != 'U') {
+    compiler_error("Strange @ escape in processed text.");
+    return ch;
+  }
+
+  escapetype = ch;
+  escapeval = 0;
+  for (jx=0; jx<4; jx++)
+    escapeval = (escapeval << 4) | ((read_static_strings_byte()-'A') & 0x0F);
+  if (escapetype == 'A')
+    return huff_abbrev_start+escapeval;
+  if (escapetype == 'D')
+    return huff_dynam_start+escapeval;
+  return huff_unicode_start+escapeval;
+}
+
 
 static void compress_makebits(int entnum, int depth, int prevbit,
   huffbitlist_t *bits);
@@ -817,8 +914,16 @@ void compress_game_text()
     huff_dynam_start = entities;
     entities += no_dynamic_strings;
 
-    if (entities > MAX_CHARACTER_SET)
-      memoryerror("MAX_CHARACTER_SET",MAX_CHARACTER_SET);
+    if (entities > MAX_CHARACTER_SET) {
+      /* There were more Unicode characters than MAX_UNICODE_CHARS
+         first allowed for */
+      int32 n = grown_memory_size(MAX_CHARACTER_SET, entities);
+      my_regrow(&huff_entities, sizeof(huffentity_t), MAX_CHARACTER_SET*2+1,
+        n*2+1, "huffman entities");
+      my_regrow(&hufflist, sizeof(huffentity_t *), MAX_CHARACTER_SET, n,
+        "huffman node list");
+      MAX_CHARACTER_SET = n;
+    }
 
     /* Characters */
     for (jx=0; jx<256; jx++) {
@@ -866,68 +971,12 @@ void compress_game_text()
 
   if (compression_switch) {
 
-    for (lx=0, ix=0; lx<no_strings; lx++) {
-      int escapelen=0, escapetype=0;
-      int done=FALSE;
-      int32 escapeval=0;
-      while (!done) {
-        if (temporary_files_switch)
-          ch = fgetc(Temp1_fp);
-        else
-          ch = read_byte_from_memory_block(&static_strings_area, ix);
-        ix++;
-        if (ix > static_strings_extent || ch < 0)
-          compiler_error("Read too much not-yet-compressed text.");
-        if (escapelen == -1) {
-          escapelen = 0;
-          if (ch == '@') {
-            ch = '@';
-          }
-          else if (ch == '0') {
-            ch = '\0';
-          }
-          else if (ch == 'A' || ch == 'D' || ch == 'U') {
-            escapelen = 4;
-            escapetype = ch;
-            escapeval = 0;
-            continue;
-          }
-          else {
-            compiler_error("Strange @ escape in processed text.");
-          }
-        }
-        else if (escapelen) {
-          escapeval = (escapeval << 4) | ((ch-'A') & 0x0F);
-          escapelen--;
-          if (escapelen == 0) {
-            if (escapetype == 'A') {
-              ch = huff_abbrev_start+escapeval;
-            }
-            else if (escapetype == 'D') {
-              ch = huff_dynam_start+escapeval;
-            }
-            else if (escapetype == 'U') {
-              ch = huff_unicode_start+escapeval;
-            }
-            else {
-              compiler_error("Strange @ escape in processed text.");
-            }
-          }
-          else
-            continue;
-        }
-        else {
-          if (ch == '@') {
-            escapelen = -1;
-            continue;
-          }
-          if (ch == 0) {
-            ch = 256;
-            done = TRUE;
-          }
-        }
+    begin_reading_static_strings();
+    for (lx=0; lx<no_strings; lx++) {
+      do {
+        ch = read_static_string_entity();
         huff_entities[ch].count++;
-      }
+      } while (ch != 256);
     }
 
     numlive = 0;
@@ -999,76 +1048,21 @@ void compress_game_text()
      without actually doing the compression. */
   compression_string_size = 0;
 
-  if (temporary_files_switch) {
-    fseek(Temp1_fp, 0, SEEK_SET);
-  }
+  begin_reading_static_strings();
 
-  if (no_strings >= MAX_NUM_STATIC_STRINGS) 
-    memoryerror("MAX_NUM_STATIC_STRINGS", MAX_NUM_STATIC_STRINGS);
+  if (no_strings >= MAX_NUM_STATIC_STRINGS) {
+    int32 n = grown_memory_size(MAX_NUM_STATIC_STRINGS, no_strings+1);
+    my_regrow(&compressed_offsets, sizeof(int32), MAX_NUM_STATIC_STRINGS, n,
+      "static strings index table");
+    MAX_NUM_STATIC_STRINGS = n;
+  }
 
-  for (lx=0, ix=0; lx<no_strings; lx++) {
-    int escapelen=0, escapetype=0;
-    int done=FALSE;
-    int32 escapeval=0;
+  for (lx=0; lx<no_strings; lx++) {
     jx = 0; 
     compressed_offsets[lx] = compression_table_size + compression_string_size;
     compression_string_size++; /* for the type byte */
-    while (!done) {
-      if (temporary_files_switch)
-        ch = fgetc(Temp1_fp);
-      else
-        ch = read_byte_from_memory_block(&static_strings_area, ix);
-      ix++;
-      if (ix > static_strings_extent || ch < 0)
-        compiler_error("Read too much not-yet-compressed text.");
-      if (escapelen == -1) {
-        escapelen = 0;
-        if (ch == '@') {
-          ch = '@';
-        }
-        else if (ch == '0') {
-          ch = '\0';
-        }
-        else if (ch == 'A' || ch == 'D' || ch == 'U') {
-          escapelen = 4;
-          escapetype = ch;
-          escapeval = 0;
-          continue;
-        }
-        else {
-          compiler_error("Strange @ escape in processed text.");
-        }
-      }
-      else if (escapelen) {
-        escapeval = (escapeval << 4) | ((ch-'A') & 0x0F);
-        escapelen--;
-        if (escapelen == 0) {
-          if (escapetype == 'A') {
-            ch = huff_abbrev_start+escapeval;
-          }
-          else if (escapetype == 'D') {
-            ch = huff_dynam_start+escapeval;
-          }
-          else if (escapetype == 'U') {
-            ch = huff_unicode_start+escapeval;
-          }
-          else {
-            compiler_error("Strange @ escape in processed text.");
-          }
-        }
-        else
-          continue;
-      }
-      else {
-        if (ch == '@') {
-          escapelen = -1;
-          continue;
-        }
-        if (ch == 0) {
-          ch = 256;
-          done = TRUE;
-        }
-      }
+    do {
+      ch = read_static_string_entity();
 
       if (compression_switch) {
         jx += huff_entities[ch].depth;
@@ -1086,7 +1080,7 @@ should be impossible.");
         else
           compression_string_size += 1;
       }
-    }
+    } while (ch != 256);
     if (compression_switch && jx)
       compression_string_size++;
   }
@@ -1135,22 +1129,33 @@ static void compress_makebits(int entnum, int depth, int prevbit,
 /* ------------------------------------------------------------------------- */
 /*   The abbreviations optimiser                                             */
 /*                                                                           */
-/*   This is a very complex, memory and time expensive algorithm to          */
-/*   approximately solve the problem of which abbreviation strings would     */
-/*   minimise the total number of Z-chars to which the game text translates. */
-/*   It is in some ways a quite separate program but remains inside Inform   */
-/*   for compatibility with previous releases.                               */
+/*   This is an algorithm to approximately solve the problem of which        */
+/*   abbreviation strings would minimise the total number of Z-chars to      */
+/*   which the game text translates.  It is in some ways a quite separate    */
+/*   program but remains inside Inform for compatibility with previous       */
+/*   releases.                                                               */
+/*                                                                           */
+/*   It works on the game text as transcribed into all_text, in which '\n'   */
+/*   marks both the ends of strings and text already claimed by a chosen     */
+/*   abbreviation.  A suffix array -- the positions of all the suffixes of   */
+/*   the text, in alphabetical order, each compared only as far as the next  */
+/*   '\n' and for at most ABBREV_CANDIDATE_LENGTH characters -- brings       */
+/*   repeated substrings together.  A run of adjacent suffixes sharing a     */
+/*   prefix of length L gives a candidate abbreviation of length L, which    */
+/*   occurs at each of their positions, and all such runs are found in a     */
+/*   single sweep through the array of longest common prefixes (the LCP      */
+/*   array) of neighbouring suffixes.                                        */
+/*                                                                           */
+/*   A candidate's score is the number of Z-chars it would save, and the     */
+/*   candidates are chosen greedily from a priority queue, best first.       */
+/*   Choosing one blanks out its occurrences, which can only lower the       */
+/*   scores of the others: so a score is recalculated whenever a candidate   */
+/*   reaches the head of the queue, and the candidate is put back if it has  */
+/*   fallen behind the next one.                                             */
 /* ------------------------------------------------------------------------- */
 
-typedef struct tlb_s
-{   char text[4];
-    int32 intab, occurrences;
-} tlb;
-static tlb *tlbtab;
-static int32 no_occs;
+#define ABBREV_CANDIDATE_LENGTH (MAX_ABBREV_LENGTH-1)
 
-static int32 *grandtable;
-static int32 *grandflags;
 typedef struct optab_s
 {   int32  length;
     int32  popularity;
@@ -1158,127 +1163,178 @@ typedef struct optab_s
     int32  location;
     char text[MAX_ABBREV_LENGTH];
 } optab;
-static optab *bestyet, *bestyet2;
+static optab *bestyet2;                 /* The abbreviations chosen          */
+
+typedef struct abbrev_candidate_s
+{   int32 from, to;                     /* It occurs at the positions
+                                           suffix_array[from] to [to]        */
+    int32 length;
+    int32 cost;                         /* Z-chars needed to spell it out    */
+    int32 score;
+} abbrev_candidate;
+
+static int32 *suffix_array;
+static int32 *suffix_lcp;
+static int32 *occurrences;              /* Workspace for one candidate       */
+static abbrev_candidate *candidates;
+static int32 no_candidates, candidates_size;
+static int32 *candidate_queue;          /* A binary heap of candidate
+                                           numbers, highest score first      */
+static int32 queue_length;
+
+static int32 common_prefix_length(int32 p1, int32 p2)
+{   int32 i; int c;
+    for (i=0; i<ABBREV_CANDIDATE_LENGTH; i++)
+    {   c = all_text[p1+i];
+        if ((c == '\n') || (c == 0) || (c != all_text[p2+i])) break;
+    }
+    return i;
+}
 
-static int pass_no;
+static int compare_suffixes(const void *x1, const void *x2)
+{   int32 p1 = *((int32 *) x1), p2 = *((int32 *) x2);
+    int32 i = common_prefix_length(p1, p2);
+    int c1 = 0, c2 = 0;
 
-static char *sub_buffer;
+    /*  The end of a string sorts before any character; suffixes which
+        agree as far as we compare them are kept in text order               */
 
-static void optimise_pass(void)
-{   int32 i; int t1, t2;
-    int32 j, j2, k, nl, matches, noflags, score, min, minat=0, x, scrabble, c;
-    for (i=0; i<256; i++) bestyet[i].length=0;
-    for (i=0; i<no_occs; i++)
-    {   if ((*(tlbtab[i].text)!=(int) '\n')&&(tlbtab[i].occurrences!=0))
-        {
+    if (i < ABBREV_CANDIDATE_LENGTH)
+    {   c1 = (uchar) all_text[p1+i]; if ((c1 == '\n') || (c1 == 0)) c1 = 0;
+        c2 = (uchar) all_text[p2+i]; if ((c2 == '\n') || (c2 == 0)) c2 = 0;
+    }
+    if (c1 != c2) return c1 - c2;
+    return (p1 < p2) ? -1 : 1;
+}
+
+static int compare_positions(const void *x1, const void *x2)
+{   int32 p1 = *((int32 *) x1), p2 = *((int32 *) x2);
+    return (p1 < p2) ? -1 : ((p1 > p2) ? 1 : 0);
+}
+
+static int32 count_occurrences(abbrev_candidate *AC)
+{
+    /*  Gather into occurrences[] the positions at which the candidate's
+        text is still intact and which do not overlap each other, in text
+        order, and return how many there are                                 */
+
+    int32 i, n = 0, p, last_end = 0;
+    for (i=AC->from; i<=AC->to; i++)
+    {   p = suffix_array[i];
+        if (memchr(all_text+p, '\n', AC->length) == NULL)
+            occurrences[n++] = p;
+    }
+    qsort(occurrences, n, sizeof(int32), compare_positions);
+    for (i=0, p=0; i<n; i++)
+        if (occurrences[i] >= last_end)
+        {   occurrences[p++] = occurrences[i];
+            last_end = occurrences[i] + AC->length;
+        }
+    return p;
+}
+
+static int32 score_candidate(abbrev_candidate *AC)
+{   int32 matches = count_occurrences(AC);
+    if (matches < 2) return 0;
+    return (matches-1)*(AC->cost-2);
+}
+
+static void add_candidate(int32 from, int32 to, int32 length)
+{   abbrev_candidate *AC;
+    int32 i; int c;
+
+    if (no_candidates >= candidates_size)
+    {   int32 n = grown_memory_size(candidates_size, no_candidates+1);
+        my_regrow(&candidates, sizeof(abbrev_candidate), candidates_size, n,
+            "abbreviation candidates");
+        candidates_size = n;
+    }
+    AC = candidates + no_candidates;
+    AC->from = from; AC->to = to; AC->length = length;
+
+    AC->cost = 0;
+    for (i=0; i<length; i++)
+    {   c = (uchar) all_text[suffix_array[from]+i];
+        AC->cost++;
+        if (c != ' ')
+        {   if (iso_to_alphabet_grid[c] < 0) AC->cost += 2;
+            else if (iso_to_alphabet_grid[c] >= 26) AC->cost++;
+        }
+    }
+
+    AC->score = score_candidate(AC);
+    if (AC->score > 0) no_candidates++;
+}
+
+static void find_candidates(int32 no_suffixes)
+{
+    /*  Sweep through the LCP array, keeping a stack of the runs still open
+        (with strictly increasing prefix lengths): when the common prefix
+        drops, each run longer than it has ended and becomes a candidate     */
+
+    int32 *stack_lcp, *stack_from, sp, k, from, lcp;
+
+    stack_lcp  = my_calloc(sizeof(int32), ABBREV_CANDIDATE_LENGTH+2,
+        "abbreviation run stack");
+    stack_from = my_calloc(sizeof(int32), ABBREV_CANDIDATE_LENGTH+2,
+        "abbreviation run stack");
+    sp = 0; stack_lcp[0] = 0; stack_from[0] = 0;
+
+    for (k=1; k<=no_suffixes; k++)
+    {
 #ifdef MAC_FACE
-            if (i%((**g_pm_hndl).linespercheck) == 0)
-            {   ProcessEvents (&g_proc);
-                if (g_proc != true)
-                {   free_arrays();
-                    if (store_the_text)
-                        my_free(&all_text,"transcription text");
-                    longjmp (g_fallback, 1);
-                }
+        if (k%((**g_pm_hndl).linespercheck) == 0)
+        {   ProcessEvents (&g_proc);
+            if (g_proc != true)
+            {   free_arrays();
+                if (store_the_text)
+                    my_free(&all_text,"transcription text");
+                longjmp (g_fallback, 1);
             }
+        }
 #endif
-            printf("Pass %d, %4ld/%ld '%s' (%ld occurrences) ",
-                pass_no, (long int) i, (long int) no_occs, tlbtab[i].text,
-                (long int) tlbtab[i].occurrences);
-            t1=(int) (time(0));
-            for (j=0; j<tlbtab[i].occurrences; j++)
-            {   for (j2=0; j2<tlbtab[i].occurrences; j2++) grandflags[j2]=1;
-                nl=2; noflags=tlbtab[i].occurrences;
-                while ((noflags>=2)&&(nl<=62))
-                {   nl++;
-                    for (j2=0; j2<nl; j2++)
-                        if (all_text[grandtable[tlbtab[i].intab+j]+j2]=='\n')
-                            goto FinishEarly;
-                    matches=0;
-                    for (j2=j; j2<tlbtab[i].occurrences; j2++)
-                    {   if (grandflags[j2]==1)
-                        {   x=grandtable[tlbtab[i].intab+j2]
-                              - grandtable[tlbtab[i].intab+j];
-                         if (((x>-nl)&&(x<nl))
-                            || (memcmp(all_text+grandtable[tlbtab[i].intab+j],
-                                       all_text+grandtable[tlbtab[i].intab+j2],
-                                       nl)!=0))
-                            {   grandflags[j2]=0; noflags--; }
-                            else matches++;
-                        }
-                    }
-                    scrabble=0;
-                    for (k=0; k<nl; k++)
-                    {   scrabble++;
-                        c=all_text[grandtable[tlbtab[i].intab+j+k]];
-                        if (c!=(int) ' ')
-                        {   if (iso_to_alphabet_grid[c]<0)
-                                scrabble+=2;
-                            else
-                                if (iso_to_alphabet_grid[c]>=26)
-                                    scrabble++;
-                        }
-                    }
-                    score=(matches-1)*(scrabble-2);
-                    min=score;
-                    for (j2=0; j2<256; j2++)
-                    {   if ((nl==bestyet[j2].length)
-                                && (memcmp(all_text+bestyet[j2].location,
-                                       all_text+grandtable[tlbtab[i].intab+j],
-                                       nl)==0))
-                        {   j2=256; min=score; }
-                        else
-                        {   if (bestyet[j2].score<min)
-                            {   min=bestyet[j2].score; minat=j2;
-                            }
-                        }
-                    }
-                    if (min!=score)
-                    {   bestyet[minat].score=score;
-                        bestyet[minat].length=nl;
-                        bestyet[minat].location=grandtable[tlbtab[i].intab+j];
-                        bestyet[minat].popularity=matches;
-                        for (j2=0; j2<nl; j2++) sub_buffer[j2]=
-                            all_text[bestyet[minat].location+j2];
-                        sub_buffer[nl]=0;
-                    }
-                }
-                FinishEarly: ;
-            }
-            t2=((int) time(0)) - t1;
-            printf(" (%d seconds)\n",t2);
+        lcp = (k < no_suffixes) ? suffix_lcp[k] : 0;
+        from = k-1;
+        while (stack_lcp[sp] > lcp)
+        {   from = stack_from[sp];
+            if (stack_lcp[sp] >= 3)
+                add_candidate(from, k-1, stack_lcp[sp]);
+            sp--;
+        }
+        if (stack_lcp[sp] < lcp)
+        {   sp++; stack_lcp[sp] = lcp; stack_from[sp] = from;
         }
     }
+
+    my_free(&stack_lcp, "abbreviation run stack");
+    my_free(&stack_from, "abbreviation run stack");
 }
 
-static int any_overlap(char *s1, char *s2)
-{   int a, b, i, j, flag;
-    a=strlen(s1); b=strlen(s2);
-    for (i=1-b; i<a; i++)
-    {   flag=0;
-        for (j=0; j<b; j++)
-            if ((0<=i+j)&&(i+j<=a-1))
-                if (s1[i+j]!=s2[j]) flag=1;
-        if (flag==0) return(1);
-    }
-    return(0);
+static int queue_before(int32 q1, int32 q2)
+{   abbrev_candidate *A1 = candidates + candidate_queue[q1],
+                     *A2 = candidates + candidate_queue[q2];
+    if (A1->score != A2->score) return (A1->score > A2->score);
+    return (candidate_queue[q1] < candidate_queue[q2]);
 }
 
-#define MAX_TLBS 8000
+static void queue_sift_down(int32 q)
+{   int32 child, t;
+    while ((child = 2*q+1) < queue_length)
+    {   if ((child+1 < queue_length) && queue_before(child+1, child))
+            child++;
+        if (!queue_before(child, q)) break;
+        t = candidate_queue[q]; candidate_queue[q] = candidate_queue[child];
+        candidate_queue[child] = t;
+        q = child;
+    }
+}
 
 extern void optimise_abbreviations(void)
-{   int32 i, j, t, max=0, MAX_GTABLE;
-    int32 j2, selected, available, maxat=0, nl;
-    tlb test;
+{   int32 i, j, n, selected, best, no_suffixes;
+    abbrev_candidate *AC;
 
     printf("Beginning calculation of optimal abbreviations...\n");
 
-    pass_no = 0;
-    tlbtab=my_calloc(sizeof(tlb), MAX_TLBS, "tlb table"); no_occs=0;
-    sub_buffer=my_calloc(sizeof(char), 4000, "sub_buffer");
-    for (i=0; i<MAX_TLBS; i++) tlbtab[i].occurrences=0;
-
-    bestyet=my_calloc(sizeof(optab), 256, "bestyet");
     bestyet2=my_calloc(sizeof(optab), 64, "bestyet2");
 
     bestyet2[0].text[0]='.';
@@ -1307,145 +1363,78 @@ extern void optimise_abbreviations(void)
         }
     }
 
-    MAX_GTABLE=subtract_pointers(all_text_top,all_text)+1;
-    grandtable=my_calloc(4*sizeof(int32), MAX_GTABLE/4, "grandtable");
-
-    for (i=0, t=0; all_text+i<all_text_top; i++)
-    {   test.text[0]=all_text[i];
-        test.text[1]=all_text[i+1];
-        test.text[2]=all_text[i+2];
-        test.text[3]=0;
-        if ((test.text[0]=='\n')||(test.text[1]=='\n')||(test.text[2]=='\n'))
-            goto DontKeep;
-        for (j=0; j<no_occs; j++)
-            if (strcmp(test.text,tlbtab[j].text)==0)
-                goto DontKeep;
-        test.occurrences=0;
-        for (j=i+3; all_text+j<all_text_top; j++)
-        {
-#ifdef MAC_FACE
-            if (j%((**g_pm_hndl).linespercheck) == 0)
-            {   ProcessEvents (&g_proc);
-                if (g_proc != true)
-                {   free_arrays();
-                    if (store_the_text)
-                        my_free(&all_text,"transcription text");
-                    longjmp (g_fallback, 1);
-                }
-            }
-#endif
-            if ((all_text[i]==all_text[j])
-                 && (all_text[i+1]==all_text[j+1])
-                 && (all_text[i+2]==all_text[j+2]))
-                 {   grandtable[t+test.occurrences]=j;
-                     test.occurrences++;
-                     if (t+test.occurrences==MAX_GTABLE)
-                     {   printf("All %ld cross-references used\n",
-                             (long int) MAX_GTABLE);
-                         goto Built;
-                     }
-                 }
-        }
-        if (test.occurrences>=2)
-        {   tlbtab[no_occs]=test;
-            tlbtab[no_occs].intab=t; t+=tlbtab[no_occs].occurrences;
-            if (max<tlbtab[no_occs].occurrences)
-                max=tlbtab[no_occs].occurrences;
-            no_occs++;
-            if (no_occs==MAX_TLBS)
-            {   printf("All %d three-letter-blocks used\n",
-                    MAX_TLBS);
-                goto Built;
-            }
-        }
-        DontKeep: ;
-    }
+    /*  Build the suffix array and the LCP array  */
 
-    Built:
-    grandflags=my_calloc(sizeof(int), max, "grandflags");
+    n = subtract_pointers(all_text_top,all_text);
+    suffix_array = my_calloc(sizeof(int32), n+1, "suffix array");
+    for (i=0, no_suffixes=0; i<n; i++)
+        if (all_text[i] != '\n') suffix_array[no_suffixes++] = i;
+    qsort(suffix_array, no_suffixes, sizeof(int32), compare_suffixes);
 
+    suffix_lcp = my_calloc(sizeof(int32), no_suffixes+1, "LCP array");
+    for (i=1; i<no_suffixes; i++)
+        suffix_lcp[i] = common_prefix_length(suffix_array[i-1],
+            suffix_array[i]);
 
-    printf("Cross-reference table (%ld entries) built...\n",
-        (long int) no_occs);
-    /*  for (i=0; i<no_occs; i++)
-            printf("%4d %4d '%s' %d\n",i,tlbtab[i].intab,tlbtab[i].text,
-                tlbtab[i].occurrences);
-    */
+    occurrences = my_calloc(sizeof(int32), no_suffixes+1,
+        "abbreviation occurrences");
 
-    for (i=0; i<64; i++) bestyet2[i].length=0; selected=2;
-    available=256;
-    while ((available>0)&&(selected<64))
-    {   printf("Pass %d\n", ++pass_no);
-
-        optimise_pass();
-        available=0;
-        for (i=0; i<256; i++)
-            if (bestyet[i].score!=0)
-            {   available++;
-                nl=bestyet[i].length;
-                for (j2=0; j2<nl; j2++) bestyet[i].text[j2]=
-                    all_text[bestyet[i].location+j2];
-                bestyet[i].text[nl]=0;
-            }
+    printf("Suffix array (%ld positions) built...\n", (long int) no_suffixes);
 
-    /*  printf("End of pass results:\n");
-        printf("\nno   score  freq   string\n");
-        for (i=0; i<256; i++)
-            if (bestyet[i].score>0)
-                printf("%02d:  %4d   %4d   '%s'\n", i, bestyet[i].score,
-                    bestyet[i].popularity, bestyet[i].text);
-    */
+    no_candidates = 0; candidates_size = 0; candidates = NULL;
+    find_candidates(no_suffixes);
 
-        do
-        {   max=0;
-            for (i=0; i<256; i++)
-                if (max<bestyet[i].score)
-                {   max=bestyet[i].score;
-                    maxat=i;
-                }
+    printf("%ld candidate abbreviations found...\n", (long int) no_candidates);
 
-            if (max>0)
-            {   bestyet2[selected++]=bestyet[maxat];
+    candidate_queue = my_calloc(sizeof(int32), no_candidates+1,
+        "abbreviation candidate queue");
+    for (i=0; i<no_candidates; i++) candidate_queue[i] = i;
+    queue_length = no_candidates;
+    for (i=queue_length/2-1; i>=0; i--) queue_sift_down(i);
 
-                printf(
-                    "Selection %2ld: '%s' (repeated %ld times, scoring %ld)\n",
-                    (long int) selected,bestyet[maxat].text,
-                    (long int) bestyet[maxat].popularity,
-                    (long int) bestyet[maxat].score);
+    for (i=0; i<64; i++) bestyet2[i].length=0; selected=2;
+    while ((queue_length > 0) && (selected < 64))
+    {   best = candidate_queue[0];
+        AC = candidates + best;
+        AC->score = score_candidate(AC);
+        if (AC->score <= 0)
+        {   candidate_queue[0] = candidate_queue[--queue_length];
+            queue_sift_down(0);
+            continue;
+        }
 
-                test.text[0]=bestyet[maxat].text[0];
-                test.text[1]=bestyet[maxat].text[1];
-                test.text[2]=bestyet[maxat].text[2];
-                test.text[3]=0;
+        /*  If the score has fallen, this may no longer be the best  */
 
-                for (i=0; i<no_occs; i++)
-                    if (strcmp(test.text,tlbtab[i].text)==0)
-                        break;
+        queue_sift_down(0);
+        if (candidate_queue[0] != best) continue;
 
-                for (j=0; j<tlbtab[i].occurrences; j++)
-                {   if (memcmp(bestyet[maxat].text,
-                               all_text+grandtable[tlbtab[i].intab+j],
-                               bestyet[maxat].length)==0)
-                    {   for (j2=0; j2<bestyet[maxat].length; j2++)
-                            all_text[grandtable[tlbtab[i].intab+j]+j2]='\n';
-                    }
-                }
+        candidate_queue[0] = candidate_queue[--queue_length];
+        queue_sift_down(0);
 
-                for (i=0; i<256; i++)
-                    if ((bestyet[i].score>0)&&
-                        (any_overlap(bestyet[maxat].text,bestyet[i].text)==1))
-                    {   bestyet[i].score=0;
-                       /* printf("Discarding '%s' as overlapping\n",
-                            bestyet[i].text); */
-                    }
-            }
-        } while ((max>0)&&(available>0)&&(selected<64));
+        n = count_occurrences(AC);
+        bestyet2[selected].length = AC->length;
+        bestyet2[selected].popularity = n;
+        bestyet2[selected].score = AC->score;
+        bestyet2[selected].location = occurrences[0];
+        for (j=0; j<AC->length; j++)
+            bestyet2[selected].text[j] = all_text[occurrences[0]+j];
+        bestyet2[selected].text[AC->length] = 0;
+        selected++;
+
+        printf("Selection %2ld: '%s' (repeated %ld times, scoring %ld)\n",
+            (long int) selected, bestyet2[selected-1].text,
+            (long int) n, (long int) AC->score);
+
+        for (i=0; i<n; i++)
+            for (j=0; j<AC->length; j++)
+                all_text[occurrences[i]+j] = '\n';
     }
 
     printf("\nChosen abbreviations (in Inform syntax):\n\n");
     for (i=0; i<selected; i++)
         printf("Abbreviate \"%s\";\n", bestyet2[i].text);
 
+    ao_free_arrays();
     text_free_arrays();
 }
 
@@ -1456,8 +1445,8 @@ extern void optimise_abbreviations(void)
 /*   routine were used to search the dictionary words so far built up, then  */
 /*   Inform would crawl.                                                     */
 /*                                                                           */
-/*   Instead, the dictionary is stored as a binary tree, which is kept       */
-/*   balanced with the red-black algorithm.                                  */
+/*   Instead, words are found through a hash table on their sort codes, and */
+/*   the dictionary is sorted once at the end.                               */
 /* ------------------------------------------------------------------------- */
 /*   A dictionary table similar to the Z-machine format is kept: there is a  */
 /*   7-byte header (left blank here to be filled in at the                   */
@@ -1528,8 +1517,18 @@ int dict_entries;                     /* Total number of records entered     */
 /* ------------------------------------------------------------------------- */
 
 extern int compare_sorts(uchar *d1, uchar *d2)
-{   int i;
-    for (i=0; i<DICT_WORD_BYTES; i++) 
+{   int i; uint32 w1, w2;
+
+    /*  Skip a word at a time over the part where the two agree, which in
+        the long Glulx sort codes is usually most of them; the words are
+        copied out since sort codes needn't be aligned                       */
+
+    for (i=0; i+(int)sizeof(uint32)<=DICT_WORD_BYTES; i+=sizeof(uint32))
+    {   memcpy(&w1, d1+i, sizeof(uint32));
+        memcpy(&w2, d2+i, sizeof(uint32));
+        if (w1 != w2) break;
+    }
+    for (; i<DICT_WORD_BYTES; i++) 
         if (d1[i]!=d2[i]) return((int)(d1[i]) - (int)(d2[i]));
     /* (since memcmp(d1, d2, DICT_WORD_BYTES); runs into a bug on some Unix 
        libraries) */
@@ -1740,32 +1739,171 @@ extern void dictionary_prepare(char *dword, uchar *optresult)
 /*                          n counts upward from 0                           */
 /*                          (n is also called the "accession number")        */
 /*                                                                           */
-/*   The tree structure encodes an ordering.  The special value VACANT means */
-/*   "no node here": otherwise, node numbers are the same as accession       */
-/*   numbers.  At all times, "root" holds the node number of the top of the  */
-/*   tree; each node has up to two branches, such that the subtree of the    */
-/*   left branch is always alphabetically before what's at the node, and     */
-/*   the subtree to the right is always after; and all branches are coloured */
-/*   either "black" or "red".  These colours are used to detect points where */
-/*   the tree is growing asymmetrically (and therefore becoming inefficient  */
-/*   to search).                                                             */
+/*   Duplicates are caught by an open-addressed hash table on the sort       */
+/*   codes: dict_hash_table[] holds accession numbers, or VACANT, and a      */
+/*   search walks forward from the slot given by the hash of the sort code   */
+/*   until it finds the word or a vacant slot.  The table size is a power    */
+/*   of two, and it is doubled whenever it becomes half full.                */
+/*                                                                           */
+/*   Since sort codes are unique, the alphabetical order is then found by a  */
+/*   single qsort at the end of the pass (or whenever the dictionary is      */
+/*   listed), and so does not depend on the order in which words arrive.     */
 /* ------------------------------------------------------------------------- */
 
-#define RED    'r'
-#define BLACK  'b'
 #define VACANT -1
 
-static int root;
-typedef struct dict_tree_node_s
-{   int  branch[2];               /* Branch 0 is "left", 1 is "right" */
-    char colour;                  /* The colour of the branch to the parent */
-} dict_tree_node;
-
-static dict_tree_node *dtree;
+static int *dict_hash_table;
+static int32 dict_hash_table_size;       /* Always a power of two            */
 
 int   *final_dict_order;
 static uchar *dict_sort_codes;
 
+static int32 dict_hash_slot(uchar *sort_code)
+{   uint32 hashcode = 2166136261UL; int i;
+    for (i=0; i<DICT_WORD_BYTES; i++)
+        hashcode = (hashcode ^ sort_code[i]) * 16777619UL;
+    return (int32) (hashcode & (dict_hash_table_size - 1));
+}
+
+static void make_dict_hash_table(int32 size)
+{
+    /*  (Re)build the hash table at the given size from the sort codes of
+        the words entered so far                                             */
+
+    int32 i, slot;
+    if (dict_hash_table != NULL)
+        my_free(&dict_hash_table, "dictionary hash table");
+    dict_hash_table = my_calloc(sizeof(int), size, "dictionary hash table");
+    dict_hash_table_size = size;
+    for (i=0; i<size; i++) dict_hash_table[i] = VACANT;
+    for (i=0; i<dict_entries; i++)
+    {   slot = dict_hash_slot(dict_sort_codes+i*DICT_WORD_BYTES);
+        while (dict_hash_table[slot] != VACANT)
+            slot = (slot + 1) & (size - 1);
+        dict_hash_table[slot] = i;
+    }
+}
+
+static int32 dict_hash_search(uchar *sort_code)
+{
+    /*  Return the slot holding the word with this sort code, or else the
+        vacant slot where it would go                                        */
+
+    int32 slot = dict_hash_slot(sort_code);
+    int at;
+    while ((at = dict_hash_table[slot]) != VACANT)
+    {   if (compare_sorts(sort_code, dict_sort_codes+at*DICT_WORD_BYTES) == 0)
+            break;
+        slot = (slot + 1) & (dict_hash_table_size - 1);
+    }
+    return slot;
+}
+
+/* ------------------------------------------------------------------------- */
+/*   Preparing a sort code costs much more than looking one up, and most     */
+/*   words are entered many times over (I7 writes out every 'word' of every  */
+/*   grammar line and name property), so dictionary_add() also remembers     */
+/*   which accession number each raw text came to.  This memo is another     */
+/*   open-addressed hash table, this time on the text:                       */
+/*                                                                           */
+/*   dict_memo_table[]      memo numbers, or VACANT                          */
+/*   dict_memos[m]          the text's offset in dict_memo_text, its         */
+/*                          accession number and its "//" flags              */
+/*                                                                           */
+/*   A text is not remembered if preparing it caused an error or warning,    */
+/*   so that this is still reported each time the text is used; and the      */
+/*   memo is forgotten whenever the alphabet or character set changes,       */
+/*   since the same text may then prepare to a different sort code.          */
+/* ------------------------------------------------------------------------- */
+
+typedef struct dict_memo_s
+{   int32 text;
+    int accession;
+    int number_and_case;
+} dict_memo;
+
+static int *dict_memo_table;
+static int32 dict_memo_table_size;       /* Always a power of two            */
+
+static dict_memo *dict_memos;
+static int32 dict_memo_count, dict_memo_limit;
+
+static char *dict_memo_text;
+static int32 dict_memo_text_used, dict_memo_text_limit;
+
+static int32 dict_memo_slot(char *dword)
+{   uint32 hashcode = 2166136261UL;
+    for (; *dword != 0; dword++)
+        hashcode = (hashcode ^ (uchar) *dword) * 16777619UL;
+    return (int32) (hashcode & (dict_memo_table_size - 1));
+}
+
+static void make_dict_memo_table(int32 size)
+{   int32 i, slot;
+    if (dict_memo_table != NULL)
+        my_free(&dict_memo_table, "dictionary memo table");
+    dict_memo_table = my_calloc(sizeof(int), size, "dictionary memo table");
+    dict_memo_table_size = size;
+    for (i=0; i<size; i++) dict_memo_table[i] = VACANT;
+    for (i=0; i<dict_memo_count; i++)
+    {   slot = dict_memo_slot(dict_memo_text + dict_memos[i].text);
+        while (dict_memo_table[slot] != VACANT)
+            slot = (slot + 1) & (size - 1);
+        dict_memo_table[slot] = i;
+    }
+}
+
+static int32 dict_memo_search(char *dword)
+{
+    /*  Return the slot holding the memo of this text, or else the vacant
+        slot where it would go                                               */
+
+    int32 slot = dict_memo_slot(dword);
+    int m;
+    while ((m = dict_memo_table[slot]) != VACANT)
+    {   if (strcmp(dword, dict_memo_text + dict_memos[m].text) == 0)
+            break;
+        slot = (slot + 1) & (dict_memo_table_size - 1);
+    }
+    return slot;
+}
+
+static void remember_dictionary_word(char *dword, int32 slot, int at)
+{   int32 length = strlen(dword) + 1, n;
+
+    if (dict_memo_count == dict_memo_limit)
+    {   n = grown_memory_size(dict_memo_limit, dict_memo_count+1);
+        my_realloc(&dict_memos, sizeof(dict_memo)*dict_memo_limit,
+            sizeof(dict_memo)*n, "dictionary memos");
+        dict_memo_limit = n;
+    }
+    if (dict_memo_text_used + length > dict_memo_text_limit)
+    {   n = grown_memory_size(dict_memo_text_limit,
+                dict_memo_text_used + length);
+        my_realloc(&dict_memo_text, dict_memo_text_limit, n,
+            "dictionary memo text");
+        dict_memo_text_limit = n;
+    }
+
+    strcpy(dict_memo_text + dict_memo_text_used, dword);
+    dict_memos[dict_memo_count].text = dict_memo_text_used;
+    dict_memos[dict_memo_count].accession = at;
+    dict_memos[dict_memo_count].number_and_case = number_and_case;
+    dict_memo_table[slot] = dict_memo_count;
+    dict_memo_text_used += length;
+
+    dict_memo_count++;
+    if (2*dict_memo_count >= dict_memo_table_size)
+        make_dict_memo_table(2*dict_memo_table_size);
+}
+
+extern void forget_dictionary_memo(void)
+{   int32 i;
+    dict_memo_count = 0;
+    dict_memo_text_used = 0;
+    for (i=0; i<dict_memo_table_size; i++) dict_memo_table[i] = VACANT;
+}
+
 static void dictionary_begin_pass(void)
 {
     /*  Leave room for the 7-byte header (added in "tables.c" much later)    */
@@ -1776,30 +1914,40 @@ static void dictionary_begin_pass(void)
     else
         dictionary_top=dictionary+4;
 
-    root = VACANT;
     dict_entries = 0;
+    make_dict_hash_table(dict_hash_table_size);
+    forget_dictionary_memo();
+}
+
+static int compare_accessions(const void *a1, const void *a2)
+{   return compare_sorts(dict_sort_codes + (*(int *) a1)*DICT_WORD_BYTES,
+                         dict_sort_codes + (*(int *) a2)*DICT_WORD_BYTES);
 }
 
-static int fdo_count;
-static void recursively_sort(int node)
-{   if (dtree[node].branch[0] != VACANT)
-        recursively_sort(dtree[node].branch[0]);
-    final_dict_order[node] = fdo_count++;
-    if (dtree[node].branch[1] != VACANT)
-        recursively_sort(dtree[node].branch[1]);
+static int *sorted_dictionary(void)
+{
+    /*  Return a newly allocated array of the accession numbers of the
+        words in alphabetical order (the caller must free it)                */
+
+    int i; int *order;
+    order = my_calloc(sizeof(int), dict_entries+1, "dictionary sort order");
+    for (i=0; i<dict_entries; i++) order[i] = i;
+    qsort(order, dict_entries, sizeof(int), compare_accessions);
+    return order;
 }
 
 extern void sort_dictionary(void)
-{   int i;
+{   int i; int *order;
     if (module_switch)
     {   for (i=0; i<dict_entries; i++)
             final_dict_order[i] = i;
         return;
     }
 
-    if (root != VACANT)
-    {   fdo_count = 0; recursively_sort(root);
-    }
+    order = sorted_dictionary();
+    for (i=0; i<dict_entries; i++)
+        final_dict_order[order[i]] = i;
+    my_free(&order, "dictionary sort order");
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1808,16 +1956,10 @@ extern void sort_dictionary(void)
 /* ------------------------------------------------------------------------- */
 
 static int dictionary_find(char *dword)
-{   int at = root, n;
-
+{
     dictionary_prepare(dword, NULL);
 
-    while (at != VACANT)
-    {   n = compare_sorts(prepared_sort, dict_sort_codes+at*DICT_WORD_BYTES);
-        if (n==0) return at + 1;
-        if (n>0) at = dtree[at].branch[1]; else at = dtree[at].branch[0];
-    }
-    return 0;
+    return dict_hash_table[dict_hash_search(prepared_sort)] + 1;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1829,126 +1971,49 @@ static int dictionary_find(char *dword)
 /*  Returns: the accession number.                                           */
 /* ------------------------------------------------------------------------- */
 
-extern int dictionary_add(char *dword, int x, int y, int z)
-{   int n; uchar *p;
-    int ggfr = 0, gfr = 0, fr = 0, r = 0;
-    int ggf = VACANT, gf = VACANT, f = VACANT, at = root;
-    int a, b;
-    int res=((version_number==3)?4:6);
+static void grow_dictionary(void)
+{   int32 n = grown_memory_size(MAX_DICT_ENTRIES, dict_entries+1);
+    int32 used = subtract_pointers(dictionary_top, dictionary);
 
-    dictionary_prepare(dword, NULL);
+    my_regrow(&final_dict_order, sizeof(int), MAX_DICT_ENTRIES, n,
+        "final dictionary ordering table");
+    my_regrow(&dict_sort_codes, DICT_WORD_BYTES, MAX_DICT_ENTRIES, n,
+        "dictionary sort codes");
+    if (!glulx_mode)
+        my_realloc(&dictionary, 9*MAX_DICT_ENTRIES+7, 9*n+7,
+            "dictionary");
+    else
+        my_realloc(&dictionary, DICT_ENTRY_BYTE_LENGTH*MAX_DICT_ENTRIES+4,
+            DICT_ENTRY_BYTE_LENGTH*n+4, "dictionary");
+    dictionary_top = dictionary + used;
+    MAX_DICT_ENTRIES = n;
+}
 
-    if (root == VACANT)
-    {   root = 0; goto CreateEntry;
-    }
-    while (TRUE)
-    {
-        n = compare_sorts(prepared_sort, dict_sort_codes+at*DICT_WORD_BYTES);
-        if (n==0)
-        {
-            if (!glulx_mode) {
-                p = dictionary+7 + at*(3+res) + res;
-                p[0]=(p[0])|x; p[1]=(p[1])|y; p[2]=(p[2])|z;
-                if (x & 128) p[0] = (p[0])|number_and_case;
-            }
-            else {
-                p = dictionary+4 + at*DICT_ENTRY_BYTE_LENGTH + DICT_ENTRY_FLAG_POS;
-                p[0]=(p[0])|(x/256); p[1]=(p[1])|(x%256); 
-                p[2]=(p[2])|(y/256); p[3]=(p[3])|(y%256); 
-                p[4]=(p[4])|(z/256); p[5]=(p[5])|(z%256);
-                if (x & 128) p[1] = (p[1]) | number_and_case;
-            }
-            return at;
-        }
-        if (n>0) r=1; else r=0;
-
-        a = dtree[at].branch[0]; b = dtree[at].branch[1];
-        if ((a != VACANT) && (dtree[a].colour == RED) &&
-            (b != VACANT) && (dtree[b].colour == RED))
-        {   dtree[a].colour = BLACK;
-            dtree[b].colour = BLACK;
-
-            dtree[at].colour = RED;
-
-        /* A tree rotation may be needed to avoid two red links in a row:
-           e.g.
-             ggf   (or else gf is root)         ggf (or f is root)
-              |                                  |
-              gf                                 f
-             / \(red)                           / \ (both red)
-                f            becomes          gf   at
-               / \(red)                      /  \ /  \
-                  at
-                 /  \
-
-           In effect we rehang the "gf" subtree from "f".
-           See the Technical Manual for further details.
-        */
-
-            if ((f != VACANT) && (gf != VACANT) && (dtree[f].colour == RED))
-            {
-              if (fr == gfr)
-              { if (ggf == VACANT) root = f; else dtree[ggf].branch[ggfr] = f;
-                dtree[gf].branch[gfr] = dtree[f].branch[1-fr];
-                dtree[f].branch[1-fr] = gf;
-                dtree[f].colour = BLACK;
-                dtree[gf].colour = RED;
-                gf = ggf; gfr = ggfr;
-              }
-              else
-              { if (ggf == VACANT) root = at; else dtree[ggf].branch[ggfr] = at;
-                dtree[at].colour = BLACK;
-                dtree[gf].colour = RED;
-                dtree[f].branch[fr] = dtree[at].branch[gfr];
-                dtree[gf].branch[gfr] = dtree[at].branch[fr];
-                dtree[at].branch[gfr] = f;
-                dtree[at].branch[fr] = gf;
-
-                r = 1-r; n = at; if (r==fr) at = f; else at = gf;
-                f = n; gf = ggf; fr = 1-r; gfr = ggfr;
-              }
-            }
-        }
+static void merge_dictionary_data(int at, int x, int y, int z)
+{   uchar *p;
+    int res=((version_number==3)?4:6);
 
-        if (dtree[at].branch[r] == VACANT)
-        {   dtree[at].colour = RED;
-
-            if ((f != VACANT) && (gf != VACANT) && (dtree[f].colour == RED))
-            { if (fr == gfr)
-              { if (ggf == VACANT) root = f; else dtree[ggf].branch[ggfr] = f;
-                dtree[gf].branch[gfr] = dtree[f].branch[1-fr];
-                dtree[f].branch[1-fr] = gf;
-                dtree[f].colour = BLACK;
-                dtree[gf].colour = RED;
-              }
-              else
-              { if (ggf == VACANT) root = at; else dtree[ggf].branch[ggfr] = at;
-                dtree[at].colour = BLACK;
-                dtree[gf].colour = RED;
-                dtree[f].branch[fr] = dtree[at].branch[gfr];
-                dtree[gf].branch[gfr] = dtree[at].branch[fr];
-                dtree[at].branch[gfr] = f;
-                dtree[at].branch[fr] = gf;
-
-                r = 1-r; n = at; if (r==fr) at = f; else at = gf;
-                f = n; gf = ggf;
-              }
-            }
-            dtree[at].branch[r] = dict_entries;
-            goto CreateEntry;
-        }
-        ggf = gf; gf = f; f = at; at = dtree[at].branch[r];
-        ggfr = gfr; gfr = fr; fr = r;
+    if (!glulx_mode) {
+        p = dictionary+7 + at*(3+res) + res;
+        p[0]=(p[0])|x; p[1]=(p[1])|y; p[2]=(p[2])|z;
+        if (x & 128) p[0] = (p[0])|number_and_case;
+    }
+    else {
+        p = dictionary+4 + at*DICT_ENTRY_BYTE_LENGTH + DICT_ENTRY_FLAG_POS;
+        p[0]=(p[0])|(x/256); p[1]=(p[1])|(x%256); 
+        p[2]=(p[2])|(y/256); p[3]=(p[3])|(y%256); 
+        p[4]=(p[4])|(z/256); p[5]=(p[5])|(z%256);
+        if (x & 128) p[1] = (p[1]) | number_and_case;
     }
+}
 
-    CreateEntry:
+static int new_dictionary_entry(int32 slot, int x, int y, int z)
+{   uchar *p;
+    int res=((version_number==3)?4:6);
 
-    if (dict_entries==MAX_DICT_ENTRIES)
-        memoryerror("MAX_DICT_ENTRIES",MAX_DICT_ENTRIES);
+    if (dict_entries==MAX_DICT_ENTRIES) grow_dictionary();
 
-    dtree[dict_entries].branch[0] = VACANT;
-    dtree[dict_entries].branch[1] = VACANT;
-    dtree[dict_entries].colour    = BLACK;
+    dict_hash_table[slot] = dict_entries;
 
     /*  Address in Inform's own dictionary table to write the record to      */
 
@@ -1991,7 +2056,37 @@ extern int dictionary_add(char *dword, int x, int y, int z)
 
     copy_sorts(dict_sort_codes+dict_entries*DICT_WORD_BYTES, prepared_sort);
 
-    return dict_entries++;
+    dict_entries++;
+    if (2*dict_entries >= dict_hash_table_size)
+        make_dict_hash_table(2*dict_hash_table_size);
+
+    return dict_entries-1;
+}
+
+extern int dictionary_add(char *dword, int x, int y, int z)
+{   int at; int32 slot, memo_slot, diagnostics;
+
+    memo_slot = dict_memo_search(dword);
+    if (dict_memo_table[memo_slot] != VACANT)
+    {   /*  This text has been entered before: no need to prepare it again   */
+
+        dict_memo *memo = dict_memos + dict_memo_table[memo_slot];
+        number_and_case = memo->number_and_case;
+        merge_dictionary_data(memo->accession, x, y, z);
+        return memo->accession;
+    }
+
+    diagnostics = no_errors + no_warnings + no_suppressed_warnings;
+    dictionary_prepare(dword, NULL);
+
+    slot = dict_hash_search(prepared_sort);
+    at = dict_hash_table[slot];
+    if (at != VACANT) merge_dictionary_data(at, x, y, z);
+    else at = new_dictionary_entry(slot, x, y, z);
+
+    if (diagnostics == no_errors + no_warnings + no_suppressed_warnings)
+        remember_dictionary_word(dword, memo_slot, at);
+    return at;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -2076,14 +2171,11 @@ extern void word_to_ascii(uchar *p, char *results)
     results[cc] = 0;
 }
 
-static void recursively_show_z(int node)
+static void show_dictionary_word_z(int node)
 {   int i, cprinted, flags; uchar *p;
     char textual_form[32];
     int res = (version_number == 3)?4:6;
 
-    if (dtree[node].branch[0] != VACANT)
-        recursively_show_z(dtree[node].branch[0]);
-
     p = (uchar *)dictionary + 7 + (3+res)*node;
 
     word_to_ascii(p, textual_form);
@@ -2121,14 +2213,18 @@ static void recursively_show_z(int node)
             d_show_to[0] = 0;
         }
     }
-
-    if (dtree[node].branch[1] != VACANT)
-        recursively_show_z(dtree[node].branch[1]);
 }
 
-static void recursively_show_g(int node)
-{
-  warning("### Glulx dictionary-show not yet implemented.\n");
+static void show_dictionary_words(void)
+{   int i; int *order;
+    if (glulx_mode)
+    {   warning("### Glulx dictionary-show not yet implemented.\n");
+        return;
+    }
+    order = sorted_dictionary();
+    for (i=0; i<dict_entries; i++)
+        show_dictionary_word_z(order[i]);
+    my_free(&order, "dictionary sort order");
 }
 
 static void show_alphabet(int i)
@@ -2151,10 +2247,7 @@ extern void show_dictionary(void)
 {   printf("Dictionary contains %d entries:\n",dict_entries);
     if (dict_entries != 0)
     {   d_show_total = 0; d_show_to = NULL; 
-        if (!glulx_mode)    
-            recursively_show_z(root);
-        else
-            recursively_show_g(root);
+        show_dictionary_words();
     }
     printf("\nZ-machine alphabet entries:\n");
     show_alphabet(0);
@@ -2171,10 +2264,7 @@ extern void write_dictionary_to_transcript(void)
 
     if (dict_entries != 0)
     {   d_show_total = 0; d_show_to = d_buffer; 
-        if (!glulx_mode)    
-            recursively_show_z(root);
-        else
-            recursively_show_g(root);
+        show_dictionary_words();
     }
     if (d_show_total != 0) write_to_transcript_file(d_buffer);
 }
@@ -2185,11 +2275,12 @@ extern void write_dictionary_to_transcript(void)
 
 extern void init_text_vars(void)
 {   int j;
-    bestyet = NULL;
     bestyet2 = NULL;
-    tlbtab = NULL;
-    grandtable = NULL;
-    grandflags = NULL;
+    suffix_array = NULL;
+    suffix_lcp = NULL;
+    occurrences = NULL;
+    candidates = NULL;
+    candidate_queue = NULL;
     no_chars_transcribed = 0;
     is_abbreviation = FALSE;
     put_strings_in_low_memory = FALSE;
@@ -2198,7 +2289,14 @@ extern void init_text_vars(void)
 
     total_zchars_trans = 0;
 
-    dtree = NULL;
+    dict_hash_table = NULL;
+    dict_hash_table_size = 0;
+    dict_memo_table = NULL;
+    dict_memo_table_size = 0;
+    dict_memos = NULL;
+    dict_memo_count = 0; dict_memo_limit = 0;
+    dict_memo_text = NULL;
+    dict_memo_text_used = 0; dict_memo_text_limit = 0;
     final_dict_order = NULL;
     dict_sort_codes = NULL;
     dict_entries=0;
@@ -2229,12 +2327,15 @@ extern void text_allocate_arrays(void)
     abbrev_quality   = my_calloc(sizeof(int), MAX_ABBREVS, "abbrev quality");
     abbrev_freqs     = my_calloc(sizeof(int),   MAX_ABBREVS, "abbrev freqs");
 
-    dtree            = my_calloc(sizeof(dict_tree_node), MAX_DICT_ENTRIES,
-                                 "red-black tree for dictionary");
     final_dict_order = my_calloc(sizeof(int),  MAX_DICT_ENTRIES,
                                  "final dictionary ordering table");
     dict_sort_codes  = my_calloc(DICT_WORD_BYTES, MAX_DICT_ENTRIES,
                                  "dictionary sort codes");
+    for (dict_hash_table_size = 64;
+         dict_hash_table_size < 2*MAX_DICT_ENTRIES;
+         dict_hash_table_size *= 2) ;
+    make_dict_hash_table(dict_hash_table_size);
+    make_dict_memo_table(dict_hash_table_size);
 
     if (!glulx_mode)
         dictionary = my_malloc(9*MAX_DICT_ENTRIES+7,
@@ -2268,7 +2369,7 @@ extern void text_allocate_arrays(void)
         unicode_usage_entries = my_calloc(sizeof(unicode_usage_t), 
           MAX_UNICODE_CHARS, "unicode entity entries");
         for (ix=0; ix<UNICODE_HASH_BUCKETS; ix++)
-          unicode_usage_hash[ix] = NULL;
+          unicode_usage_hash[ix] = -1;
       }
       compressed_offsets = my_calloc(sizeof(int32), MAX_NUM_STATIC_STRINGS,
         "static strings index table");
@@ -2284,7 +2385,13 @@ extern void text_free_arrays(void)
     my_free(&abbrev_quality,   "abbrev quality");
     my_free(&abbrev_freqs,     "abbrev freqs");
 
-    my_free(&dtree,            "red-black tree for dictionary");
+    my_free(&dict_hash_table,  "dictionary hash table");
+    my_free(&dict_memo_table,  "dictionary memo table");
+    my_free(&dict_memos,       "dictionary memos");
+    my_free(&dict_memo_text,   "dictionary memo text");
+    dict_memo_table_size = 0;
+    dict_memo_count = 0; dict_memo_limit = 0;
+    dict_memo_text_used = 0; dict_memo_text_limit = 0;
     my_free(&final_dict_order, "final dictionary ordering table");
     my_free(&dict_sort_codes,  "dictionary sort codes");
 
@@ -2299,12 +2406,12 @@ extern void text_free_arrays(void)
 }
 
 extern void ao_free_arrays(void)
-{   my_free (&tlbtab,"tlb table");
-    my_free (&sub_buffer,"sub_buffer");
-    my_free (&bestyet,"bestyet");
-    my_free (&bestyet2,"bestyet2");
-    my_free (&grandtable,"grandtable");
-    my_free (&grandflags,"grandflags");
+{   my_free (&bestyet2,"bestyet2");
+    my_free (&suffix_array,"suffix array");
+    my_free (&suffix_lcp,"LCP array");
+    my_free (&occurrences,"abbreviation occurrences");
+    my_free (&candidates,"abbreviation candidates");
+    my_free (&candidate_queue,"abbreviation candidate queue");
 }
 
 /* ========================================================================= */
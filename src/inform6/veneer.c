@@ -88,7 +88,40 @@ typedef struct VeneerRoutine_s
     char *source6;
 } VeneerRoutine;
 
+/* ------------------------------------------------------------------------- */
+/*   The veneer routines are compiled from source afresh on every pass.      */
+/*   Keeping their assembled code from one compilation to the next would     */
+/*   not be safe: the source tests game symbols (#ifdef DEBUG, INFIX,        */
+/*   LibSerial, action), and the code embeds values which vary from game     */
+/*   to game -- property and attribute numbers, class and object numbers,    */
+/*   and symbol numbers in its backpatch markers.  So each routine's six     */
+/*   pieces of source are simply joined into veneer_source_area (which       */
+/*   grows to fit the longest) and compiled.                                 */
+/* ------------------------------------------------------------------------- */
+
 static char *veneer_source_area;
+static int32 veneer_source_area_size;   /* malloced size                     */
+
+static char *veneer_routine_source(VeneerRoutine *VR)
+{   char *pieces[6]; int32 lengths[6], total = 0, at = 0; int i;
+
+    pieces[0] = VR->source1; pieces[1] = VR->source2;
+    pieces[2] = VR->source3; pieces[3] = VR->source4;
+    pieces[4] = VR->source5; pieces[5] = VR->source6;
+    for (i=0; i<6; i++) total += (lengths[i] = strlen(pieces[i]));
+
+    if (total+1 > veneer_source_area_size)
+    {   my_realloc(&veneer_source_area, veneer_source_area_size, total+1,
+            "veneer source code area");
+        veneer_source_area_size = total+1;
+    }
+    for (i=0; i<6; i++)
+    {   memcpy(veneer_source_area+at, pieces[i], lengths[i]);
+        at += lengths[i];
+    }
+    veneer_source_area[at] = 0;
+    return veneer_source_area;
+}
 
 static VeneerRoutine VRs_z[VENEER_ROUTINES] =
 {
@@ -2333,14 +2366,8 @@ extern void compile_veneer(void)
             {   j = symbol_index(VRs[i].name, -1);
                 if (sflags[j] & UNKNOWN_SFLAG)
                 {   veneer_mode = TRUE;
-                    strcpy(veneer_source_area, VRs[i].source1);
-                    strcat(veneer_source_area, VRs[i].source2);
-                    strcat(veneer_source_area, VRs[i].source3);
-                    strcat(veneer_source_area, VRs[i].source4);
-                    strcat(veneer_source_area, VRs[i].source5);
-                    strcat(veneer_source_area, VRs[i].source6);
                     assign_symbol(j,
-                        parse_routine(veneer_source_area, FALSE,
+                        parse_routine(veneer_routine_source(VRs+i), FALSE,
                             VRs[i].name, TRUE, j),
                         ROUTINE_T);
                     veneer_mode = FALSE;
@@ -2384,6 +2411,7 @@ extern void veneer_begin_pass(void)
 
 extern void veneer_allocate_arrays(void)
 {   veneer_source_area = my_malloc(16384, "veneer source code area");
+    veneer_source_area_size = 16384;
 }
 
 extern void veneer_free_arrays(void)
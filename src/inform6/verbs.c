@@ -92,6 +92,48 @@ static int English_verb_list_size;     /* Size of the list in bytes
           *grammar_token_routine,
           *adjectives;
   static uchar *adjective_sort_code;
+  static int32 grammar_token_routine_size; /* calloced size */
+
+/* ------------------------------------------------------------------------- */
+/*   These tables grow as needed: MAX_VERBS, MAX_ACTIONS, MAX_ADJECTIVES,    */
+/*   MAX_LINESPACE and MAX_VERBSPACE record how much has been allocated.     */
+/* ------------------------------------------------------------------------- */
+
+static void ensure_verbs(int32 count)
+{   int32 n;
+    if (count <= MAX_VERBS) return;
+    n = grown_memory_size(MAX_VERBS, count);
+    my_regrow(&Inform_verbs, sizeof(verbt), MAX_VERBS, n, "verbs");
+    MAX_VERBS = n;
+}
+
+static void ensure_actions(int32 count)
+{   int32 n;
+    if (count <= MAX_ACTIONS) return;
+    n = grown_memory_size(MAX_ACTIONS, count);
+    my_regrow(&action_byte_offset, sizeof(int32), MAX_ACTIONS, n, "actions");
+    my_regrow(&action_symbol, sizeof(int32), MAX_ACTIONS, n,
+        "action symbols");
+    MAX_ACTIONS = n;
+}
+
+static void ensure_adjectives(int32 count)
+{   int32 n;
+    if (count <= MAX_ADJECTIVES) return;
+    n = grown_memory_size(MAX_ADJECTIVES, count);
+    my_regrow(&adjectives, sizeof(int32), MAX_ADJECTIVES, n, "adjectives");
+    my_regrow(&adjective_sort_code, DICT_WORD_BYTES, MAX_ADJECTIVES, n,
+        "adjective sort codes");
+    MAX_ADJECTIVES = n;
+}
+
+static void ensure_grammar_lines(int32 size)
+{   int32 n;
+    if (size <= MAX_LINESPACE) return;
+    n = grown_memory_size(MAX_LINESPACE, size);
+    my_realloc(&grammar_lines, MAX_LINESPACE, n, "grammar lines");
+    MAX_LINESPACE = n;
+}
 
 /* ------------------------------------------------------------------------- */
 /*   Tracing for compiler maintenance                                        */
@@ -186,7 +228,7 @@ extern assembly_operand action_of_name(char *name)
 
     if (sflags[j] & UNKNOWN_SFLAG)
     {
-        if (no_actions>=MAX_ACTIONS) memoryerror("MAX_ACTIONS",MAX_ACTIONS);
+        ensure_actions(no_actions+1);
         new_action(name, no_actions);
         action_symbol[no_actions] = j;
         assign_symbol(j, no_actions++, CONSTANT_T);
@@ -256,8 +298,7 @@ static int make_adjective(char *English_word)
     int i; 
     uchar new_sort_code[MAX_DICT_WORD_BYTES];
 
-    if (no_adjectives >= MAX_ADJECTIVES)
-        memoryerror("MAX_ADJECTIVES", MAX_ADJECTIVES);
+    ensure_adjectives(no_adjectives+1);
 
     dictionary_prepare(English_word, new_sort_code);
     for (i=0; i<no_adjectives; i++)
@@ -285,6 +326,12 @@ static int make_parsing_routine(int32 routine_address)
         if (grammar_token_routine[l] == routine_address)
             return l;
 
+    if (l >= grammar_token_routine_size)
+    {   int32 n = grown_memory_size(grammar_token_routine_size, l+1);
+        my_regrow(&grammar_token_routine, sizeof(int32),
+            grammar_token_routine_size, n, "grammar token routines");
+        grammar_token_routine_size = n;
+    }
     grammar_token_routine[l] = routine_address;
     return(no_grammar_token_routines++);
 }
@@ -333,7 +380,12 @@ static void register_verb(char *English_verb, int number)
 
     English_verb_list_size += strlen(English_verb)+4;
     if (English_verb_list_size >= MAX_VERBSPACE)
-        memoryerror("MAX_VERBSPACE", MAX_VERBSPACE);
+    {   int32 used = English_verb_list_top - English_verb_list;
+        int32 n = grown_memory_size(MAX_VERBSPACE, English_verb_list_size+1);
+        my_realloc(&English_verb_list, MAX_VERBSPACE, n, "register of verbs");
+        English_verb_list_top = English_verb_list + used;
+        MAX_VERBSPACE = n;
+    }
 
     English_verb_list_top[0] = 4+strlen(English_verb);
     English_verb_list_top[1] = number/256;
@@ -420,18 +472,10 @@ into Inform, so suggest rewriting grammar using general parsing routines");
     /*  In Glulx, that's 5*32 + 4 = 164 bytes */
 
     mark = grammar_lines_top;
-    if (!glulx_mode) {
-        if (mark + 100 >= MAX_LINESPACE)
-        {   discard_token_location(beginning_debug_location);
-            memoryerror("MAX_LINESPACE", MAX_LINESPACE);
-        }
-    }
-    else {
-        if (mark + 165 >= MAX_LINESPACE)
-        {   discard_token_location(beginning_debug_location);
-            memoryerror("MAX_LINESPACE", MAX_LINESPACE);
-        }
-    }
+    if (!glulx_mode)
+        ensure_grammar_lines(mark + 100 + 1);
+    else
+        ensure_grammar_lines(mark + 165 + 1);
 
     Inform_verbs[verbnum].l[line] = mark;
 
@@ -735,8 +779,7 @@ extern void make_verb(void)
     }
     else
     {   Inform_verb = no_Inform_verbs;
-        if (no_Inform_verbs == MAX_VERBS)
-            memoryerror("MAX_VERBS",MAX_VERBS);
+        ensure_verbs(no_Inform_verbs+1);
     }
 
     for (i=0; i<no_given; i++)
@@ -782,8 +825,7 @@ extern void extend_verb(void)
     get_next_token();
     if ((token_type == DIR_KEYWORD_TT) && (token_value == ONLY_DK))
     {   l = -1;
-        if (no_Inform_verbs == MAX_VERBS)
-            memoryerror("MAX_VERBS", MAX_VERBS);
+        ensure_verbs(no_Inform_verbs+1);
         while (get_next_token(),
                ((token_type == DQ_TT) || (token_type == SQ_TT)))
         {   Inform_verb = get_verb();
@@ -898,6 +940,7 @@ extern void verbs_allocate_arrays(void)
                                 "action symbols");
     grammar_token_routine = my_calloc(sizeof(int32),   MAX_ACTIONS,
                                 "grammar token routines");
+    grammar_token_routine_size = MAX_ACTIONS;
     adjectives            = my_calloc(sizeof(int32),   MAX_ADJECTIVES,
                                 "adjectives");
     adjective_sort_code   = my_calloc(DICT_WORD_BYTES, MAX_ADJECTIVES,
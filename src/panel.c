@@ -668,6 +668,7 @@ enum _I7PanelSignalType {
 	SELECT_VIEW_SIGNAL,
 	PASTE_CODE_SIGNAL,
 	JUMP_TO_LINE_SIGNAL,
+	JUMP_TO_I6_LINE_SIGNAL,
 	DISPLAY_DOCPAGE_SIGNAL,
 	DISPLAY_EXTENSIONS_DOCPAGE_SIGNAL,
 	DISPLAY_INDEX_PAGE_SIGNAL,
@@ -893,6 +894,10 @@ i7_panel_class_init(I7PanelClass *klass)
 		G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
 		G_STRUCT_OFFSET(I7PanelClass, jump_to_line), NULL, NULL,
 		g_cclosure_marshal_VOID__UINT, G_TYPE_NONE, 1, G_TYPE_UINT);
+	i7_panel_signals[JUMP_TO_I6_LINE_SIGNAL] = g_signal_new("jump-to-i6-line",
+		G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
+		G_STRUCT_OFFSET(I7PanelClass, jump_to_i6_line), NULL, NULL,
+		g_cclosure_marshal_VOID__UINT, G_TYPE_NONE, 1, G_TYPE_UINT);
 	i7_panel_signals[DISPLAY_DOCPAGE_SIGNAL] = g_signal_new("display-docpage",
 		G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_FIRST | G_SIGNAL_ACTION,
 		G_STRUCT_OFFSET(I7PanelClass, display_docpage), NULL, NULL,
@@ -1164,15 +1169,25 @@ on_navigation_requested(WebKitWebView *webview, WebKitWebFrame *frame, WebKitNet
 
 	} else if(strcmp(scheme, "source") == 0) {
 		guint line;
-		gchar *path = g_strdup(uri + strlen("source:"));
-		gchar *ptr = strrchr(path, '#');
-		gchar *anchor = g_strdup(ptr);
-		*ptr = 0;
+		gchar *escaped_path = g_strdup(uri + strlen("source:"));
+		gchar *ptr = strrchr(escaped_path, '#');
+		gchar *anchor = g_strdup(ptr? ptr : "");
+		if(ptr)
+			*ptr = 0;
+		/* WebKit escapes characters such as spaces in the path */
+		gchar *path = g_uri_unescape_string(escaped_path, NULL);
+		if(path == NULL)
+			path = g_strdup(escaped_path);
+		g_free(escaped_path);
 
 		/* If it links to the source file, just jump to the line */
 		if(strcmp(path, "story.ni") == 0) {
 			if(sscanf(anchor, "#line%u", &line))
 				g_signal_emit_by_name(panel, "jump-to-line", line);
+		} else if(strcmp(path, "auto.inf") == 0) {
+			/* The I6 code that ni generated is shown in the Inform 6 tab */
+			if(sscanf(anchor, "#line%u", &line))
+				g_signal_emit_by_name(panel, "jump-to-i6-line", line);
 		} else {
 			GFile *file = g_file_new_for_path(path);
 			/* Else it's a link to an extension, open it in a new window */
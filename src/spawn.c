@@ -72,7 +72,8 @@ write_channel_hook(GIOChannel *ioc, GIOCondition cond, IOHookData *data)
 		gsize chars_read = 0;
 
 		memset(scratch, 0, BUFSIZE); /* clear the buffer */
-		result = g_io_channel_read_chars(ioc, scratch, BUFSIZE, &chars_read,
+		/* Leave room for a terminating zero, the callback expects a string */
+		result = g_io_channel_read_chars(ioc, scratch, BUFSIZE - 1, &chars_read,
 		  NULL);
 
 		if (chars_read <= 0 || result != G_IO_STATUS_NORMAL)
@@ -111,8 +112,15 @@ set_up_io_channel(gint fd, GtkTextBuffer *output)
 	g_io_channel_unref(ioc);
 }
 
-/* Echo the command invocation to the output buffer */
-static void
+/**
+ * echo_invocation_to_output:
+ * @argv: an array of strings with the command line arguments.
+ * @output: a #GtkTextBuffer in which to show the command line.
+ *
+ * Shows the command line in @output, the same way as run_command() does. This
+ * is for tools that are run without spawning a process.
+ */
+void
 echo_invocation_to_output(gchar **argv, GtkTextBuffer *output)
 {
 	gchar *args = g_strjoinv(" ", argv + 1);
@@ -26,5 +26,6 @@ GPid run_command(GFile *wd_file, char **argv, GtkTextBuffer *output);
 GPid run_command_hook(GFile *wd_file, char **argv, GtkTextBuffer *output,
 					  IOHookFunc *callback, gpointer data, gboolean get_out,
 					  gboolean get_err);
+void echo_invocation_to_output(gchar **argv, GtkTextBuffer *output);
 
 #endif /* _SPAWN_H */
@@ -39,6 +39,13 @@
 #endif
 
 #define INFORM6_COMPILER_NAME "inform6"
+#define BUILD_CACHE_FILE_NAME "build-cache.ini"
+#define BUILD_CACHE_GROUP "Fingerprints"
+#define BUILD_CACHE_KEY_NI "ni"
+#define BUILD_CACHE_KEY_I6 "i6"
+#define BUFFER_LOAD_CHUNK_SIZE (64 * 1024)
+#define I6_PROFILE_FILE_NAME "profile.json"
+#define I6_PROBLEMS_FILE_NAME "ProblemsI6.html"
 
 #include "story.h"
 #include "story-private.h"
@@ -46,6 +53,32 @@
 #include "error.h"
 #include "html.h"
 #include "spawn.h"
+#include "inform6lib.h"
+
+/* Kinds of diagnostics that the I6 compiler reports */
+typedef enum {
+	I6_DIAGNOSTIC_WARNING = INFORM_WARNING,
+	I6_DIAGNOSTIC_ERROR = INFORM_ERROR,
+	I6_DIAGNOSTIC_FATAL_ERROR = INFORM_FATAL_ERROR,
+	I6_DIAGNOSTIC_COMPILER_ERROR = INFORM_COMPILER_ERROR
+} I6DiagnosticKind;
+
+/* Which help page to show for the last error the I6 compiler printed */
+typedef enum {
+	I6_PROBLEM_NONE = 0,
+	I6_PROBLEM_GENERIC,
+	I6_PROBLEM_MEMORY_SETTING,
+	I6_PROBLEM_READABLE_MEMORY,
+	I6_PROBLEM_TOO_BIG
+} I6ProblemPage;
+
+/* One diagnostic, as reported by the I6 compiler */
+typedef struct {
+	I6DiagnosticKind kind;
+	gchar *filename;
+	guint line;
+	gchar *message;
+} I6Diagnostic;
 
 typedef struct _CompilerData {
 	I7Story *story;
@@ -56,6 +89,19 @@ typedef struct _CompilerData {
 	GFile *output_file;
 	GFile *builddir_file;
 	GFile *results_file;
+	gchar *fingerprint;
+	gchar *i6_fingerprint;
+	/* The I6 compiler's arguments and source, for the compiler thread */
+	gchar *i6_switches;
+	GFile *i6_output_file;
+	gchar **i6_commandline;
+	char *i6_source;
+	gsize i6_source_length;
+	int i6_exit_code;
+	gboolean i6_skipped;
+	/* I6 diagnostics, collected while the compiler is running */
+	GSList *i6_diagnostics;
+	I6ProblemPage i6_problem_page;
 } CompilerData;
 
 /* Declare these functions static so they can stay in this order */
@@ -64,7 +110,8 @@ static void start_ni_compiler(CompilerData *data);
 static void finish_ni_compiler(GPid pid, gint status, CompilerData *data);
 static void prepare_i6_compiler(CompilerData *data);
 static void start_i6_compiler(CompilerData *data);
-static void finish_i6_compiler(GPid pid, gint status, CompilerData *data);
+static gboolean finish_i6_compiler(CompilerData *data);
+static void continue_after_i6_compiler(CompilerData *data);
 static void prepare_cblorb_compiler(CompilerData *data);
 static void start_cblorb_compiler(CompilerData *data);
 static void finish_cblorb_compiler(GPid pid, gint status, CompilerData *data);
@@ -79,6 +126,448 @@ i7_story_set_compile_finished_action(I7Story *story, CompileActionFunc callback,
 	priv->compile_finished_callback_data = data;
 }
 
+/* Helper function: add the path, size, and modification time of @file to
+@checksum. This is much cheaper than reading the contents. The time includes
+the microseconds, so that a file saved twice within one second (for example, an
+extension edited in the IDE) still changes the checksum. */
+static void
+checksum_update_file_stamp(GChecksum *checksum, GFile *file)
+{
+	char *path = g_file_get_path(file);
+	g_checksum_update(checksum, (guchar *)path, -1);
+	g_free(path);
+
+	GFileInfo *info = g_file_query_info(file,
+		G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+		G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+		G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if(info == NULL) {
+		g_checksum_update(checksum, (guchar *)"-", 1);
+		return;
+	}
+	gchar *stamp = g_strdup_printf(":%" G_GINT64_FORMAT ":%" G_GUINT64_FORMAT ".%06u;",
+		g_file_info_get_size(info),
+		g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+		g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+	g_checksum_update(checksum, (guchar *)stamp, -1);
+	g_free(stamp);
+	g_object_unref(info);
+}
+
+/* Helper function: add the Inform 6 compiler to @checksum. The compiler is
+linked into the IDE rather than run as a program of its own, so use the build
+identifier it was compiled with, which changes whenever it is rebuilt. */
+static void
+checksum_update_i6_compiler(GChecksum *checksum)
+{
+	g_checksum_update(checksum, (guchar *)inform_library_build_id(), -1);
+	g_checksum_update(checksum, (guchar *)";", 1);
+}
+
+/* Helper function: add the contents of @file to @checksum. A missing file is
+recorded as such, so that creating it changes the checksum. */
+static void
+checksum_update_file_contents(GChecksum *checksum, GFile *file)
+{
+	char *contents;
+	gsize length;
+
+	if(!g_file_load_contents(file, NULL, &contents, &length, NULL, NULL)) {
+		g_checksum_update(checksum, (guchar *)"-", 1);
+		return;
+	}
+	g_checksum_update(checksum, (guchar *)contents, length);
+	g_checksum_update(checksum, (guchar *)";", 1);
+	g_free(contents);
+}
+
+/* Helper function: GCompareFunc for sorting a GPtrArray of GFiles by path */
+static int
+compare_file_paths(GFile **a, GFile **b)
+{
+	char *path_a = g_file_get_path(*a);
+	char *path_b = g_file_get_path(*b);
+	int retval = g_strcmp0(path_a, path_b);
+	g_free(path_a);
+	g_free(path_b);
+	return retval;
+}
+
+/* Helper function: add the stamps of all the files in an extensions directory
+(@dir/Author/Extension.i7x) to @checksum. We can't tell which extensions the
+story includes without running ni, so we check all of them. The entries are
+sorted, since the enumeration order is not guaranteed. */
+static void
+checksum_update_extensions_dir(GChecksum *checksum, GFile *dir)
+{
+	GPtrArray *files = g_ptr_array_new_with_free_func(g_object_unref);
+	GFileEnumerator *root = g_file_enumerate_children(dir,
+		G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+		G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	GFileInfo *author_info;
+
+	if(root == NULL) {
+		g_ptr_array_free(files, TRUE);
+		return;
+	}
+
+	while((author_info = g_file_enumerator_next_file(root, NULL, NULL)) != NULL) {
+		if(g_file_info_get_file_type(author_info) == G_FILE_TYPE_DIRECTORY) {
+			GFile *author_file = g_file_get_child(dir, g_file_info_get_name(author_info));
+			GFileEnumerator *author_dir = g_file_enumerate_children(author_file,
+				G_FILE_ATTRIBUTE_STANDARD_NAME, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+			if(author_dir != NULL) {
+				GFileInfo *extension_info;
+				while((extension_info = g_file_enumerator_next_file(author_dir, NULL, NULL)) != NULL) {
+					g_ptr_array_add(files, g_file_get_child(author_file, g_file_info_get_name(extension_info)));
+					g_object_unref(extension_info);
+				}
+				g_file_enumerator_close(author_dir, NULL, NULL);
+				g_object_unref(author_dir);
+			}
+			g_object_unref(author_file);
+		}
+		g_object_unref(author_info);
+	}
+	g_file_enumerator_close(root, NULL, NULL);
+	g_object_unref(root);
+
+	g_ptr_array_sort(files, (GCompareFunc)compare_file_paths);
+	unsigned ix;
+	for(ix = 0; ix < files->len; ix++)
+		checksum_update_file_stamp(checksum, g_ptr_array_index(files, ix));
+	g_ptr_array_free(files, TRUE);
+}
+
+/* Helper function: add all the regular files under @dir, at any depth, to
+@files */
+static void
+collect_files_in_tree(GPtrArray *files, GFile *dir)
+{
+	GFileEnumerator *enumerator = g_file_enumerate_children(dir,
+		G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+		G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	GFileInfo *info;
+
+	if(enumerator == NULL)
+		return;
+
+	while((info = g_file_enumerator_next_file(enumerator, NULL, NULL)) != NULL) {
+		GFile *child = g_file_get_child(dir, g_file_info_get_name(info));
+		switch(g_file_info_get_file_type(info)) {
+		case G_FILE_TYPE_DIRECTORY:
+			collect_files_in_tree(files, child);
+			g_object_unref(child);
+			break;
+		case G_FILE_TYPE_REGULAR:
+			g_ptr_array_add(files, child); /* takes ownership */
+			break;
+		default:
+			g_object_unref(child);
+		}
+		g_object_unref(info);
+	}
+	g_file_enumerator_close(enumerator, NULL, NULL);
+	g_object_unref(enumerator);
+}
+
+/* Helper function: add the stamps of all the files under @dir to @checksum.
+This is for the directory that ni is given with -internal, which holds the
+built-in extensions as well as the I6 templates, the language definitions, and
+whatever else ni may read; these can be updated without ni itself changing. The
+files are sorted, since the enumeration order is not guaranteed. */
+static void
+checksum_update_dir_tree(GChecksum *checksum, GFile *dir)
+{
+	GPtrArray *files = g_ptr_array_new_with_free_func(g_object_unref);
+	collect_files_in_tree(files, dir);
+
+	g_ptr_array_sort(files, (GCompareFunc)compare_file_paths);
+	unsigned ix;
+	for(ix = 0; ix < files->len; ix++)
+		checksum_update_file_stamp(checksum, g_ptr_array_index(files, ix));
+	g_ptr_array_free(files, TRUE);
+}
+
+/* Fingerprint everything that goes into the ni stage of the tool chain: the
+compiler settings, the source text, the project settings, the extensions, the
+rest of ni's internal directory, and the compiler binaries themselves. Free
+return value when done. */
+static gchar *
+get_ni_fingerprint(CompilerData *data)
+{
+	I7App *theapp = i7_app_get();
+	GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+
+	gchar *parameters = g_strdup_printf("%s:%d:%d:%d;",
+		i7_story_get_extension(data->story), data->create_blorb,
+		data->use_debug_flags, i7_story_get_nobble_rng(data->story));
+	g_checksum_update(checksum, (guchar *)parameters, -1);
+	g_free(parameters);
+
+	GFile *source_dir = g_file_get_child(data->input_file, "Source");
+	GFile *file = g_file_get_child(source_dir, "story.ni");
+	checksum_update_file_contents(checksum, file);
+	g_object_unref(file);
+	g_object_unref(source_dir);
+
+	file = g_file_get_child(data->input_file, "Settings.plist");
+	checksum_update_file_contents(checksum, file);
+	g_object_unref(file);
+	file = g_file_get_child(data->input_file, "uuid.txt");
+	checksum_update_file_contents(checksum, file);
+	g_object_unref(file);
+
+	file = i7_app_get_extension_file(theapp, NULL, NULL);
+	checksum_update_extensions_dir(checksum, file);
+	g_object_unref(file);
+	/* This includes the built-in extensions */
+	file = i7_app_get_internal_dir(theapp);
+	checksum_update_dir_tree(checksum, file);
+	g_object_unref(file);
+	GFile *materials_file = i7_story_get_materials_file(data->story);
+	file = g_file_get_child(materials_file, "Extensions");
+	checksum_update_extensions_dir(checksum, file);
+	g_object_unref(file);
+	g_object_unref(materials_file);
+
+	file = i7_app_get_binary_file(theapp, "ni");
+	checksum_update_file_stamp(checksum, file);
+	g_object_unref(file);
+	checksum_update_i6_compiler(checksum);
+
+	gchar *retval = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+	return retval;
+}
+
+/* Fingerprint everything that goes into the I6 stage of the tool chain: the
+compiler switches, the I6 source that ni generated (already loaded into
+@data->i6_source, or NULL if it is missing), and the compiler itself. Free
+return value when done. */
+static gchar *
+get_i6_fingerprint(CompilerData *data, const gchar *switches)
+{
+	GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+
+	g_checksum_update(checksum, (guchar *)switches, -1);
+	g_checksum_update(checksum, (guchar *)";", 1);
+
+	if(data->i6_source != NULL) {
+		g_checksum_update(checksum, (guchar *)data->i6_source, data->i6_source_length);
+		g_checksum_update(checksum, (guchar *)";", 1);
+	} else {
+		g_checksum_update(checksum, (guchar *)"-", 1);
+	}
+
+	checksum_update_i6_compiler(checksum);
+
+	gchar *retval = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+	return retval;
+}
+
+/* Helper function: read the build cache in the project's Build directory, or
+create an empty one if it doesn't exist yet. Free with g_key_file_free(). */
+static GKeyFile *
+load_build_cache(CompilerData *data)
+{
+	GKeyFile *cache = g_key_file_new();
+	GFile *cache_file = g_file_get_child(data->builddir_file, BUILD_CACHE_FILE_NAME);
+	char *path = g_file_get_path(cache_file);
+	g_object_unref(cache_file);
+
+	g_key_file_load_from_file(cache, path, G_KEY_FILE_NONE, NULL); /* ignore error */
+	g_free(path);
+	return cache;
+}
+
+/* Look up the fingerprint of the last successful run of one stage of the tool
+chain. Returns NULL if there was none. Free return value when done. */
+static gchar *
+read_cached_fingerprint(CompilerData *data, const char *key)
+{
+	GKeyFile *cache = load_build_cache(data);
+	gchar *retval = g_key_file_get_string(cache, BUILD_CACHE_GROUP, key, NULL);
+	g_key_file_free(cache);
+	return retval;
+}
+
+/* Record @fingerprint as the fingerprint of the last successful run of one
+stage of the tool chain, or forget it if @fingerprint is NULL. Errors are
+ignored; the worst that can happen is an unnecessary recompile. */
+static void
+store_cached_fingerprint(CompilerData *data, const char *key, const gchar *fingerprint)
+{
+	GKeyFile *cache = load_build_cache(data);
+
+	if(fingerprint != NULL)
+		g_key_file_set_string(cache, BUILD_CACHE_GROUP, key, fingerprint);
+	else if(!g_key_file_remove_key(cache, BUILD_CACHE_GROUP, key, NULL)) {
+		g_key_file_free(cache);
+		return; /* nothing to forget */
+	}
+
+	gsize length;
+	gchar *contents = g_key_file_to_data(cache, &length, NULL);
+	GFile *cache_file = g_file_get_child(data->builddir_file, BUILD_CACHE_FILE_NAME);
+	g_file_replace_contents(cache_file, contents, length, NULL, FALSE,
+		G_FILE_CREATE_NONE, NULL, NULL, NULL);
+	g_object_unref(cache_file);
+	g_free(contents);
+	g_key_file_free(cache);
+}
+
+/* Helper function: check whether @fingerprint matches the cached one for that
+stage, and whether the stage's output file is still there. */
+static gboolean
+stage_is_up_to_date(CompilerData *data, const char *key, const gchar *fingerprint, GFile *output)
+{
+	gchar *cached = read_cached_fingerprint(data, key);
+	gboolean retval = cached != NULL && strcmp(cached, fingerprint) == 0
+		&& g_file_query_exists(output, NULL);
+	g_free(cached);
+	return retval;
+}
+
+/* Check whether the story file and Problems page from the last build can be
+reused as they are. */
+static gboolean
+build_is_up_to_date(CompilerData *data)
+{
+	GFile *problems_file = g_file_get_child(data->builddir_file, "Problems.html");
+	gboolean retval = g_file_query_exists(problems_file, NULL)
+		&& stage_is_up_to_date(data, BUILD_CACHE_KEY_NI, data->fingerprint, data->output_file);
+	g_object_unref(problems_file);
+	return retval;
+}
+
+/* Helper function: tell the user in the Progress tab that a stage of the tool
+chain was skipped. The GDK lock must be held. */
+static void
+display_skipped_stage(I7Story *story, const gchar *message)
+{
+	I7_STORY_USE_PRIVATE(story, priv);
+	GtkTextIter iter;
+	gtk_text_buffer_get_end_iter(priv->progress, &iter);
+	gtk_text_buffer_insert(priv->progress, &iter, message, -1);
+}
+
+/* Finish the compile without running any of the tools, because nothing has
+changed since the last build. This is an idle function, so the GDK lock is not
+held and must be acquired for any GUI calls. */
+static gboolean
+skip_compiling(CompilerData *data)
+{
+	I7_STORY_USE_PRIVATE(data->story, priv);
+	I7Story *story = data->story;
+
+	gdk_threads_enter();
+	gtk_text_buffer_set_text(priv->progress, "", -1);
+	display_skipped_stage(story, _("Nothing has changed since the last build; "
+		"using the existing story file.\n"));
+	gdk_threads_leave();
+
+	g_clear_object(&data->results_file);
+	data->results_file = g_file_get_child(data->builddir_file, "Problems.html");
+
+	/* Make sure the manifest is loaded, in case this is the first build since
+	opening the project */
+	if(priv->manifest == NULL) {
+		GFile *manifest_file = g_file_get_child(data->input_file, "manifest.plist");
+		priv->manifest = plist_read_file(manifest_file, NULL, NULL);
+		g_object_unref(manifest_file);
+	}
+
+	finish_compiling(TRUE, data);
+	/* Hold the GDK lock for the callback */
+	gdk_threads_enter();
+	(priv->compile_finished_callback)(story, priv->compile_finished_callback_data);
+	gdk_threads_leave();
+
+	return FALSE; /* one-shot idle function */
+}
+
+/* Data for loading a file into a text buffer a piece at a time */
+typedef struct {
+	GtkTextBuffer *buffer;
+	GCancellable *cancellable;
+	char *contents;
+	gsize length;
+	gsize position;
+} BufferLoadData;
+
+static void
+buffer_load_data_free(BufferLoadData *load)
+{
+	g_object_unref(load->buffer);
+	g_object_unref(load->cancellable);
+	g_free(load->contents);
+	g_slice_free(BufferLoadData, load);
+}
+
+/* Idle function to insert the next piece of a loaded file into a text buffer,
+so that large files such as auto.inf don't freeze the user interface. Pieces
+end at a line break where possible, otherwise at a character boundary. This is
+called with the GDK lock held. */
+static gboolean
+insert_next_chunk_idle(BufferLoadData *load)
+{
+	if(g_cancellable_is_cancelled(load->cancellable))
+		return FALSE; /* quit the cycle */
+
+	gsize remaining = load->length - load->position;
+	gsize chunk_length = MIN(remaining, BUFFER_LOAD_CHUNK_SIZE);
+	const char *start = load->contents + load->position;
+	if(chunk_length < remaining) {
+		const char *newline = g_strrstr_len(start, chunk_length, "\n");
+		if(newline != NULL)
+			chunk_length = newline + 1 - start;
+		else
+			chunk_length = g_utf8_find_prev_char(start, start + chunk_length) - start;
+	}
+
+	GtkTextIter end;
+	gtk_text_buffer_get_end_iter(load->buffer, &end);
+	gtk_text_buffer_insert(load->buffer, &end, start, chunk_length);
+	load->position += chunk_length;
+
+	return load->position < load->length; /* more to come? */
+}
+
+/* Callback for when a file has finished loading from disk. Starts inserting it
+into the text buffer. */
+static void
+on_buffer_file_loaded(GFile *file, GAsyncResult *result, BufferLoadData *load)
+{
+	if(!g_file_load_contents_finish(file, result, &load->contents, &load->length, NULL, NULL)
+		|| g_cancellable_is_cancelled(load->cancellable)) {
+		buffer_load_data_free(load);
+		return;
+	}
+
+	gdk_threads_enter();
+	gtk_text_buffer_set_text(load->buffer, "", -1);
+	gdk_threads_leave();
+
+	gdk_threads_add_idle_full(G_PRIORITY_DEFAULT_IDLE,
+		(GSourceFunc)insert_next_chunk_idle, load,
+		(GDestroyNotify)buffer_load_data_free);
+}
+
+/* Replace the contents of @buffer with the contents of @file, without blocking
+the user interface. Cancel @cancellable to stop loading. If @file can't be read,
+the buffer is left alone. */
+static void
+load_file_into_buffer_async(GFile *file, GtkTextBuffer *buffer, GCancellable *cancellable)
+{
+	BufferLoadData *load = g_slice_new0(BufferLoadData);
+	load->buffer = g_object_ref(buffer);
+	load->cancellable = g_object_ref(cancellable);
+	g_file_load_contents_async(file, cancellable,
+		(GAsyncReadyCallback)on_buffer_file_loaded, load);
+}
+
 /* Start the compiling process. Called from the main thread. */
 void
 i7_story_compile(I7Story *story, gboolean release, gboolean refresh)
@@ -118,6 +607,20 @@ i7_story_compile(I7Story *story, gboolean release, gboolean refresh)
 	data->output_file = g_file_get_child(data->builddir_file, filename);
 	g_free(filename);
 
+	/* Skip the whole tool chain if nothing has changed since the last
+	successful build. Release builds are always done from scratch. */
+	if(data->use_debug_flags) {
+		data->fingerprint = get_ni_fingerprint(data);
+		if(build_is_up_to_date(data)) {
+			/* The GDK lock is held here, but the rest of the tool chain expects
+			to be called without it, as from a child watch */
+			g_idle_add((GSourceFunc)skip_compiling, data);
+			return;
+		}
+	}
+	/* The previous build's results will be overwritten */
+	store_cached_fingerprint(data, BUILD_CACHE_KEY_NI, NULL);
+
 	prepare_ni_compiler(data);
 	start_ni_compiler(data);
 }
@@ -267,32 +770,21 @@ finish_ni_compiler(GPid pid, gint status, CompilerData *data)
 	data->results_file = problems_file; /* assumes reference */
 
 	if(g_settings_get_boolean(prefs, PREFS_SHOW_DEBUG_LOG)) {
-		/* Update */
-		gdk_threads_enter();
-		while(gtk_events_pending())
-			gtk_main_iteration();
-		gdk_threads_leave();
+		/* Stop loading the files from any previous compile */
+		if(priv->debug_files_cancellable) {
+			g_cancellable_cancel(priv->debug_files_cancellable);
+			g_object_unref(priv->debug_files_cancellable);
+		}
+		priv->debug_files_cancellable = g_cancellable_new();
 
-		/* Refresh the debug log */
-		gchar *text;
+		/* Refresh the debug log and the I6 code in the background; ignore
+		errors, just don't show them if they're not there */
 		GFile *debug_file = g_file_get_child(data->builddir_file, "Debug log.txt");
-		/* Ignore errors, just don't show it if it's not there */
-		if(g_file_load_contents(debug_file, NULL, &text, NULL, NULL, NULL)) {
-			gdk_threads_enter();
-			gtk_text_buffer_set_text(priv->debug_log, text, -1);
-			gdk_threads_leave();
-			g_free(text);
-		}
+		load_file_into_buffer_async(debug_file, priv->debug_log, priv->debug_files_cancellable);
 		g_object_unref(debug_file);
 
-		/* Refresh the I6 code */
 		GFile *i6_file = g_file_get_child(data->builddir_file, "auto.inf");
-		if(g_file_load_contents(i6_file, NULL, &text, NULL, NULL, NULL)) {
-			gdk_threads_enter();
-			gtk_text_buffer_set_text(GTK_TEXT_BUFFER(priv->i6_source), text, -1);
-			gdk_threads_leave();
-			g_free(text);
-		}
+		load_file_into_buffer_async(i6_file, GTK_TEXT_BUFFER(priv->i6_source), priv->debug_files_cancellable);
 		g_object_unref(i6_file);
 	}
 
@@ -372,57 +864,298 @@ get_i6_compiler_switches(gboolean use_debug_flags, int format)
 	return retval;
 }
 
-/* Pulse the progress bar every time the I6 compiler outputs a '#' (which
- happens whenever it has processed 100 source lines.) This function is
- called from a child process watch, so the GDK lock is not held and must be
- acquired for any GUI calls. */
+/* Free an I6Diagnostic */
 static void
-display_i6_status(I7Document *document, gchar *text)
+i6_diagnostic_free(I6Diagnostic *diagnostic)
 {
-	if(strchr(text, '#')) {
-		gdk_threads_enter();
-		i7_document_display_progress_busy(document);
-		gdk_threads_leave();
-	}
+	g_free(diagnostic->filename);
+	g_free(diagnostic->message);
+	g_slice_free(I6Diagnostic, diagnostic);
 }
 
-/* Run the I6 compiler. This function is called from a child process watch, so
- the GDK lock is not held and must be acquired for any GUI calls. */
+/* Inform 6 runs inside this process, in a thread of its own. The compiler
+keeps all its state in global variables, so only one copy of it may run at a
+time, even if several stories are being compiled. */
+G_LOCK_DEFINE_STATIC(inform6);
+
+/* Receive the text that the I6 compiler would print to its standard output,
+and pulse the progress bar every time it prints a '#' (which happens whenever
+it has processed 100 source lines). This function is called from the compiler
+thread, so the GDK lock must be acquired for any GUI calls. */
 static void
-start_i6_compiler(CompilerData *data)
+display_i6_output(const char *text, CompilerData *data)
 {
 	I7_STORY_USE_PRIVATE(data->story, priv);
 
-	GFile *i6_compiler = i7_app_get_binary_file(i7_app_get(), INFORM6_COMPILER_NAME);
+	GtkTextIter end;
+	gdk_threads_enter();
+	gtk_text_buffer_get_end_iter(priv->progress, &end);
+	gtk_text_buffer_insert(priv->progress, &end, text, -1);
+	if(strchr(text, '#'))
+		i7_document_display_progress_busy(I7_DOCUMENT(data->story));
+	gdk_threads_leave();
+}
+
+/* Record one error or warning from the I6 compiler, and work out which help
+page to show for it. This function is called from the compiler thread; nothing
+else looks at the diagnostics until the compiler has finished. */
+static void
+record_i6_diagnostic(int kind, const char *filename, int line, const char *message, CompilerData *data)
+{
+	I6Diagnostic *diagnostic = g_slice_new0(I6Diagnostic);
+	diagnostic->kind = kind;
+	diagnostic->message = g_strstrip(g_strdup(message));
+	if(*filename != '\0') {
+		diagnostic->filename = g_strdup(filename);
+		diagnostic->line = line;
+	}
+
+	data->i6_diagnostics = g_slist_prepend(data->i6_diagnostics, diagnostic);
+
+	if(kind == I6_DIAGNOSTIC_WARNING)
+		return;
+
+	/* The last error determines which help page is shown */
+	if(strstr(diagnostic->message, "The memory setting ") && strstr(diagnostic->message, " has been exceeded."))
+		data->i6_problem_page = I6_PROBLEM_MEMORY_SETTING;
+	else if(strstr(diagnostic->message, "This program has overflowed the maximum readable-memory size of the "))
+		data->i6_problem_page = I6_PROBLEM_READABLE_MEMORY;
+	else if(strstr(diagnostic->message, "The story file exceeds "))
+		data->i6_problem_page = I6_PROBLEM_TOO_BIG;
+	else
+		data->i6_problem_page = I6_PROBLEM_GENERIC;
+}
+
+/* Worker thread function for running the I6 compiler. The I6 source is read
+and fingerprinted here rather than in start_i6_compiler(), because auto.inf can
+be several megabytes. The story file is still written to disk, because cBlorb
+and the interpreter read it from there. */
+static gpointer
+i6_compiler_thread(CompilerData *data)
+{
+	I7_STORY_USE_PRIVATE(data->story, priv);
+
+	/* Load the I6 source; the compiler reads it from memory */
+	GFile *i6_source = g_file_get_child(data->builddir_file, "auto.inf");
+	if(!g_file_load_contents(i6_source, NULL, &data->i6_source, &data->i6_source_length, NULL, NULL))
+		data->i6_source = NULL; /* the compiler will report it missing */
+	g_object_unref(i6_source);
+
+	/* Skip this stage if ni generated exactly the same code as last time */
+	data->i6_fingerprint = get_i6_fingerprint(data, data->i6_switches);
+	if(stage_is_up_to_date(data, BUILD_CACHE_KEY_I6, data->i6_fingerprint, data->i6_output_file)) {
+		data->i6_skipped = TRUE;
+		g_idle_add((GSourceFunc)finish_i6_compiler, data);
+		return NULL;
+	}
+	/* The previous story file will be overwritten */
+	store_cached_fingerprint(data, BUILD_CACHE_KEY_I6, NULL);
+
+	/* Don't show a stale profile if this run stops before writing one */
+	GFile *profile_file = g_file_get_child(data->builddir_file, I6_PROFILE_FILE_NAME);
+	g_file_delete(profile_file, NULL, NULL); /* ignore error */
+	g_object_unref(profile_file);
+
+	gdk_threads_enter();
+	echo_invocation_to_output(data->i6_commandline, priv->progress);
+	gdk_threads_leave();
+
+	inform_library_callbacks callbacks = {
+		.print = (void (*)(const char *, void *))display_i6_output,
+		.diagnostic = (void (*)(int, const char *, int, const char *, void *))record_i6_diagnostic,
+		.story_file = NULL,
+		.data = data
+	};
+
+	G_LOCK(inform6);
+	data->i6_exit_code = inform_library_compile(g_strv_length(data->i6_commandline),
+		data->i6_commandline, data->i6_source, data->i6_source_length, &callbacks);
+	G_UNLOCK(inform6);
+
+	g_idle_add((GSourceFunc)finish_i6_compiler, data);
+	return NULL;
+}
+
+/* Start the I6 compiler in a thread of its own. This function is called from
+ the child process watch for ni, so the GDK lock is not held and must be
+ acquired for any GUI calls. Reading auto.inf is left to the thread. */
+static void
+start_i6_compiler(CompilerData *data)
+{
 	char *i6out = g_strconcat("output.", i7_story_get_extension(data->story), NULL);
-	GFile *i6_output = g_file_get_child(data->builddir_file, i6out);
+	data->i6_output_file = g_file_get_child(data->builddir_file, i6out);
 	g_free(i6out);
+	data->i6_switches = get_i6_compiler_switches(data->use_debug_flags, i7_story_get_story_format(data->story));
 
-	/* Build the command line */
-	gchar **commandline = g_new(gchar *, 6);
+	GFile *i6_source = g_file_get_child(data->builddir_file, "auto.inf");
+	GFile *profile_file = g_file_get_child(data->builddir_file, I6_PROFILE_FILE_NAME);
+	GFile *i6_compiler = i7_app_get_binary_file(i7_app_get(), INFORM6_COMPILER_NAME);
+
+	/* Build the command line. The compiler doesn't run in the Build directory,
+	so every file it reads or writes must be given with its full path. */
+	char *builddir_path = g_file_get_path(data->builddir_file);
+	char *profile_path = g_file_get_path(profile_file);
+	gchar **commandline = g_new(gchar *, 8);
 	commandline[0] = g_file_get_path(i6_compiler);
-	commandline[1] = get_i6_compiler_switches(data->use_debug_flags, i7_story_get_story_format(data->story));
+	commandline[1] = g_strdup(data->i6_switches);
 	commandline[2] = g_strdup("$huge");
-	commandline[3] = g_strdup("auto.inf");
-	commandline[4] = g_file_get_path(i6_output);
-	commandline[5] = NULL;
-
+	commandline[3] = g_strconcat("+debugging_name=", builddir_path, G_DIR_SEPARATOR_S "gameinfo.dbg", NULL);
+	commandline[4] = g_strconcat("+profile_name=", profile_path, NULL);
+	commandline[5] = g_file_get_path(i6_source);
+	commandline[6] = g_file_get_path(data->i6_output_file);
+	commandline[7] = NULL;
+	data->i6_commandline = commandline;
+
+	g_free(builddir_path);
+	g_free(profile_path);
+	g_object_unref(profile_file);
 	g_object_unref(i6_compiler);
-	g_object_unref(i6_output);
+	g_object_unref(i6_source);
 
-	GPid child_pid = run_command_hook(data->builddir_file, commandline,
-		priv->progress, (IOHookFunc *)display_i6_status, data->story, TRUE, TRUE);
-	/* set up a watch for the exit status */
-	g_child_watch_add(child_pid, (GChildWatchFunc)finish_i6_compiler, data);
+	GThread *thread = g_thread_new("inform6", (GThreadFunc)i6_compiler_thread, data);
+	g_thread_unref(thread); /* the thread reports back through an idle function */
+}
 
-	g_strfreev(commandline);
+/* Show how long each phase of the I6 compiler took, and how much memory it
+allocated, from the profile it writes. The compiler puts each phase on a line of
+its own, so the lines can be picked apart without a JSON parser. This function
+is called from finish_i6_compiler(), an idle function queued by the compiler
+thread, so the GDK lock is not held and must be acquired for any GUI calls. */
+static void
+display_i6_profile(CompilerData *data)
+{
+	I7_STORY_USE_PRIVATE(data->story, priv);
+
+	GFile *profile_file = g_file_get_child(data->builddir_file, I6_PROFILE_FILE_NAME);
+	char *contents;
+	gboolean loaded = g_file_load_contents(profile_file, NULL, &contents, NULL, NULL, NULL);
+	g_object_unref(profile_file);
+	if(!loaded)
+		return; /* the compiler stopped with a fatal error */
+
+	GString *report = g_string_new(_("\nTime spent in each phase of Inform 6:\n"));
+	gchar **lines = g_strsplit(contents, "\n", -1);
+	g_free(contents);
+	gchar **line;
+	double total = -1.0;
+	for(line = lines; *line; line++) {
+		char phase[32], seconds[32];
+		long allocated_bytes, allocations;
+		/* The numbers always have a decimal point, whatever the locale, so
+		they are read as strings and converted with g_ascii_strtod() */
+		if(sscanf(*line, " { \"phase\": \"%31[^\"]\", \"seconds\": %31[0-9.], "
+			"\"allocated_bytes\": %ld, \"allocations\": %ld",
+			phase, seconds, &allocated_bytes, &allocations) == 4) {
+			gchar *size = g_format_size(allocated_bytes);
+			g_string_append_printf(report, _("  %-13s %8.3f s  %10s in %ld allocations\n"),
+				phase, g_ascii_strtod(seconds, NULL), size, allocations);
+			g_free(size);
+		} else if(sscanf(*line, " \"seconds\": %31[0-9.]", seconds) == 1) {
+			total = g_ascii_strtod(seconds, NULL);
+		}
+	}
+	g_strfreev(lines);
+	if(total >= 0.0)
+		g_string_append_printf(report, _("  %-13s %8.3f s\n"), _("total"), total);
+
+	GtkTextIter end;
+	gdk_threads_enter();
+	gtk_text_buffer_get_end_iter(priv->progress, &end);
+	gtk_text_buffer_insert(priv->progress, &end, report->str, -1);
+	gdk_threads_leave();
+	g_string_free(report, TRUE);
 }
 
-/* Display any errors from Inform 6 and decide what to do next. This function is
- called from a child process watch, so the GDK lock is not held and must be
- acquired for any GUI calls. */
+/* Helper function: add the source location of @diagnostic to @page, linked to
+the line it refers to if it is in a real file. Links of the form used here are
+handled by the Problems tab: "auto.inf" stands for the I6 code that ni generated
+(@auto_inf_path), which is shown in the Inform 6 tab. */
 static void
-finish_i6_compiler(GPid pid, gint status, CompilerData *data)
+append_i6_diagnostic_location(GString *page, I6Diagnostic *diagnostic, const char *auto_inf_path)
+{
+	/* Veneer routines, for example, have a description instead of a file */
+	if(!g_path_is_absolute(diagnostic->filename)
+		|| !g_file_test(diagnostic->filename, G_FILE_TEST_IS_REGULAR)) {
+		gchar *description = g_markup_escape_text(diagnostic->filename, -1);
+		g_string_append_printf(page, " (%s)", description);
+		g_free(description);
+		return;
+	}
+
+	gchar *href;
+	if(strcmp(diagnostic->filename, auto_inf_path) == 0)
+		href = g_strdup("auto.inf");
+	else
+		href = g_uri_escape_string(diagnostic->filename, "/", FALSE);
+	gchar *basename = g_path_get_basename(diagnostic->filename);
+	gchar *location = g_strdup_printf(_("%s, line %u"), basename, diagnostic->line);
+	gchar *escaped_location = g_markup_escape_text(location, -1);
+	g_string_append_printf(page, " (<a href=\"source:%s#line%u\">%s</a>)",
+		href, diagnostic->line, escaped_location);
+	g_free(href);
+	g_free(basename);
+	g_free(location);
+	g_free(escaped_location);
+}
+
+/* Write a page for the Problems tab listing the diagnostics from the I6
+compiler, each with a link to the line of source it refers to, and a link to
+@help_file (which may be NULL) explaining what they mean. Returns the page, or
+NULL if it could not be written. */
+static GFile *
+write_i6_problems_page(CompilerData *data, GFile *help_file)
+{
+	const char *kinds[] = {
+		[I6_DIAGNOSTIC_WARNING] = _("Warning"),
+		[I6_DIAGNOSTIC_ERROR] = _("Error"),
+		[I6_DIAGNOSTIC_FATAL_ERROR] = _("Fatal error"),
+		[I6_DIAGNOSTIC_COMPILER_ERROR] = _("Compiler error")
+	};
+
+	GString *page = g_string_new("<html><head><meta http-equiv=\"Content-Type\" "
+		"content=\"text/html; charset=UTF-8\"></head><body>\n");
+	g_string_append_printf(page, "<h2>%s</h2>\n<ul>\n", _("Problems reported by Inform 6"));
+
+	GFile *auto_inf = g_file_get_child(data->builddir_file, "auto.inf");
+	char *auto_inf_path = g_file_get_path(auto_inf);
+	g_object_unref(auto_inf);
+
+	GSList *iter;
+	for(iter = data->i6_diagnostics; iter; iter = g_slist_next(iter)) {
+		I6Diagnostic *diagnostic = (I6Diagnostic *)iter->data;
+		g_string_append_printf(page, "<li><b>%s</b>", kinds[diagnostic->kind]);
+		if(diagnostic->filename != NULL)
+			append_i6_diagnostic_location(page, diagnostic, auto_inf_path);
+		gchar *message = g_markup_escape_text(diagnostic->message, -1);
+		g_string_append_printf(page, ": %s</li>\n", message);
+		g_free(message);
+	}
+	g_string_append(page, "</ul>\n");
+	g_free(auto_inf_path);
+
+	if(help_file != NULL) {
+		gchar *uri = g_file_get_uri(help_file);
+		gchar *escaped_uri = g_markup_escape_text(uri, -1);
+		g_string_append_printf(page, "<p><a href=\"%s\">%s</a></p>\n", escaped_uri,
+			_("What do these problems mean?"));
+		g_free(uri);
+		g_free(escaped_uri);
+	}
+	g_string_append(page, "</body></html>\n");
+
+	GFile *page_file = g_file_get_child(data->builddir_file, I6_PROBLEMS_FILE_NAME);
+	if(!g_file_replace_contents(page_file, page->str, page->len, NULL, FALSE,
+		G_FILE_CREATE_NONE, NULL, NULL, NULL))
+		g_clear_object(&page_file); /* show only the help page instead */
+	g_string_free(page, TRUE);
+	return page_file;
+}
+
+/* Display any errors from Inform 6, or that it was skipped, and decide what to
+ do next. This is an idle function, called once the compiler thread has
+ finished; the GDK lock is not held and must be acquired for any GUI calls. */
+static gboolean
+finish_i6_compiler(CompilerData *data)
 {
 	I7_STORY_USE_PRIVATE(data->story, priv);
 
@@ -432,48 +1165,59 @@ finish_i6_compiler(GPid pid, gint status, CompilerData *data)
 	i7_document_clear_progress(I7_DOCUMENT(data->story));
 	gdk_threads_leave();
 
-	/* Get exit code from I6 process */
-	int exit_code = WIFEXITED(status)? WEXITSTATUS(status) : -1;
+	/* The compiler thread found that the existing story file is still good */
+	if(data->i6_skipped) {
+		gdk_threads_enter();
+		display_skipped_stage(data->story, _("\nThe Inform 6 code has not "
+			"changed since the last build; using the existing story file.\n"));
+		gdk_threads_leave();
+		continue_after_i6_compiler(data);
+		return FALSE; /* one-shot idle function */
+	}
+
+	int exit_code = data->i6_exit_code;
+	data->i6_diagnostics = g_slist_reverse(data->i6_diagnostics);
 
 	/* Display the exit status of the I6 compiler in the Progress tab */
-	gchar *statusmsg = g_strdup_printf(_("\nCompiler finished with code %d\n"),
-	  exit_code);
-	GtkTextIter iter;
+	unsigned errors = 0, warnings = 0;
+	GSList *iter;
+	for(iter = data->i6_diagnostics; iter; iter = g_slist_next(iter)) {
+		if(((I6Diagnostic *)iter->data)->kind == I6_DIAGNOSTIC_WARNING)
+			warnings++;
+		else
+			errors++;
+	}
+	gchar *statusmsg = g_strdup_printf(_("\nCompiler finished with code %d "
+		"(%u errors, %u warnings)\n"), exit_code, errors, warnings);
+	GtkTextIter end;
 	gdk_threads_enter();
-	gtk_text_buffer_get_end_iter(priv->progress, &iter);
-	gtk_text_buffer_insert(priv->progress, &iter, statusmsg, -1);
+	gtk_text_buffer_get_end_iter(priv->progress, &end);
+	gtk_text_buffer_insert(priv->progress, &end, statusmsg, -1);
 	gdk_threads_leave();
 	g_free(statusmsg);
 
-	GtkTextIter start, end;
-	int line;
-	GFile *loadfile = NULL;
+	display_i6_profile(data);
 
 	/* Display the appropriate HTML error pages */
-	gdk_threads_enter();
-	for(line = gtk_text_buffer_get_line_count(priv->progress); line >= 0; line--) {
-		gchar *msg;
-		gtk_text_buffer_get_iter_at_line(priv->progress, &start, line);
-		end = start;
-		gtk_text_iter_forward_to_line_end(&end);
-		msg = gtk_text_iter_get_text(&start, &end);
-		if(strstr(msg, "rror:")) { /* "Error:", "Fatal error:" */
-			if(strstr(msg, "The memory setting ") && strstr(msg, " has been exceeded."))
-				loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", "ErrorI6MemorySetting.html", NULL);
-			else if(strstr(msg, "This program has overflowed the maximum readable-memory size of the "))
-				loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", "ErrorI6Readable.html", NULL);
-			else if(strstr(msg, "The story file exceeds "))
-				loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", "ErrorI6TooBig.html", NULL);
-			else
-				loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", "ErrorI6.html", NULL);
-			g_free(msg);
-			break;
-		}
-		g_free(msg);
-	}
-	gdk_threads_leave();
+	GFile *loadfile = NULL;
+	const char *pages[] = {
+		[I6_PROBLEM_GENERIC] = "ErrorI6.html",
+		[I6_PROBLEM_MEMORY_SETTING] = "ErrorI6MemorySetting.html",
+		[I6_PROBLEM_READABLE_MEMORY] = "ErrorI6Readable.html",
+		[I6_PROBLEM_TOO_BIG] = "ErrorI6TooBig.html",
+	};
+	if(data->i6_problem_page != I6_PROBLEM_NONE)
+		loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", pages[data->i6_problem_page], NULL);
 	if(!loadfile && exit_code != 0)
 		loadfile = i7_app_get_data_file_va(i7_app_get(), "Resources", "en", "ErrorI6.html", NULL);
+	/* List the problems themselves, linking to the help page */
+	if(exit_code != 0 && data->i6_diagnostics != NULL) {
+		GFile *problems_file = write_i6_problems_page(data, loadfile);
+		if(problems_file != NULL) {
+			g_clear_object(&loadfile);
+			loadfile = problems_file;
+		}
+	}
 	if(loadfile) {
 		g_clear_object(&data->results_file);
 		data->results_file = loadfile; /* assumes reference */
@@ -482,9 +1226,29 @@ finish_i6_compiler(GPid pid, gint status, CompilerData *data)
 	/* Stop here and show the Results/Report tab if there was an error */
 	if(exit_code != 0) {
 		finish_compiling(FALSE, data);
-		return;
+		return FALSE; /* one-shot idle function */
 	}
 
+	store_cached_fingerprint(data, BUILD_CACHE_KEY_I6, data->i6_fingerprint);
+
+	continue_after_i6_compiler(data);
+	return FALSE; /* one-shot idle function */
+}
+
+/* Decide what to do once Inform 6 has produced a story file, or once we have
+found that the existing one is still good. This function is called from a child
+process watch or an idle function, so the GDK lock is not held and must be
+acquired for any GUI calls. */
+static void
+continue_after_i6_compiler(CompilerData *data)
+{
+	I7_STORY_USE_PRIVATE(data->story, priv);
+
+	/* The story file is now up to date with the source; remember that, so that
+	the next build can be skipped if nothing changes */
+	if(data->fingerprint)
+		store_cached_fingerprint(data, BUILD_CACHE_KEY_NI, data->fingerprint);
+
 	/* Decide what to do next */
 	if(!data->create_blorb) {
 		I7Story *story = data->story;
@@ -501,8 +1265,8 @@ finish_i6_compiler(GPid pid, gint status, CompilerData *data)
 }
 
 /* Get ready to run the CBlorb compiler. This function is called from a child
- process watch, so the GDK lock is not held and must be acquired for any GUI
- calls. */
+ process watch or an idle function, so the GDK lock is not held and must be
+ acquired for any GUI calls. */
 static void
 prepare_cblorb_compiler(CompilerData *data)
 {
@@ -527,8 +1291,9 @@ parse_cblorb_output(I7Story *story, gchar *text)
 	}
 }
 
-/* Run the CBlorb compiler. This function is called from a child process watch,
- so the GDK lock is not held and must be acquired for any GUI calls. */
+/* Run the CBlorb compiler. This function is called from a child process watch
+ or an idle function, so the GDK lock is not held and must be acquired for any
+ GUI calls. */
 static void
 start_cblorb_compiler(CompilerData *data)
 {
@@ -636,6 +1401,13 @@ finish_compiling(gboolean success, CompilerData *data)
 	g_object_unref(data->input_file);
 	g_object_unref(data->builddir_file);
 	g_clear_object(&data->results_file);
+	g_free(data->fingerprint);
+	g_free(data->i6_fingerprint);
+	g_free(data->i6_switches);
+	g_clear_object(&data->i6_output_file);
+	g_strfreev(data->i6_commandline);
+	g_free(data->i6_source);
+	g_slist_free_full(data->i6_diagnostics, (GDestroyNotify)i6_diagnostic_free);
 	g_slice_free(CompilerData, data);
 
 	/* Update */
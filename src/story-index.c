@@ -15,6 +15,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
@@ -24,55 +25,116 @@
 #include "html.h"
 #include "panel.h"
 
+/* Helper function: compute a checksum of the index page @file, or return NULL
+if it doesn't exist. ni rewrites all the index pages on every compile, so the
+modification time is no use for telling whether a page has changed. Free return
+value when done. */
+static gchar *
+get_index_file_checksum(GFile *file)
+{
+	char *contents;
+	gsize length;
+
+	if(!g_file_load_contents(file, NULL, &contents, &length, NULL, NULL))
+		return NULL;
+	gchar *retval = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *)contents, length);
+	g_free(contents);
+	return retval;
+}
+
+/* Helper function: whether @webview is showing @file itself, rather than
+another page reached from it (such as one of the Details pages, which ni also
+rewrites) or nothing at all. An anchor within the page doesn't count. */
+static gboolean
+web_view_shows_file(WebKitWebView *webview, GFile *file)
+{
+	const char *uri = webkit_web_view_get_uri(webview);
+	if(uri == NULL)
+		return FALSE;
+	char *file_uri = g_file_get_uri(file);
+	const char *anchor = strchr(uri, '#');
+	size_t length = anchor? (size_t)(anchor - uri) : strlen(uri);
+	gboolean retval = (strlen(file_uri) == length && strncmp(uri, file_uri, length) == 0);
+	g_free(file_uri);
+	return retval;
+}
+
+/* Load index tab @tabnum in each panel if its page has changed since the last
+time it was loaded, or if the panel has gone on from it to another page, or a
+blank page if it doesn't exist. */
 static void
-load_index_file(I7Story *story, int counter)
+reload_index_tab_if_changed(I7Story *story, I7PaneIndexTab tabnum)
 {
+	I7_STORY_USE_PRIVATE(story, priv);
+
 	GFile *parent = i7_document_get_file(I7_DOCUMENT(story));
 	GFile *child1 = g_file_get_child(parent, "Index");
-	GFile *file = g_file_get_child(child1, i7_panel_index_names[counter]);
+	GFile *file = g_file_get_child(child1, i7_panel_index_names[tabnum]);
 	g_object_unref(parent);
 	g_object_unref(child1);
 
-	if(g_file_query_exists(file, NULL)) {
-		html_load_file(WEBKIT_WEB_VIEW(story->panel[LEFT]->index_tabs[counter]), file);
-		html_load_file(WEBKIT_WEB_VIEW(story->panel[RIGHT]->index_tabs[counter]), file);
-	} else {
-		html_load_blank(WEBKIT_WEB_VIEW(story->panel[LEFT]->index_tabs[counter]));
-		html_load_blank(WEBKIT_WEB_VIEW(story->panel[RIGHT]->index_tabs[counter]));
+	gchar *checksum = get_index_file_checksum(file);
+	gboolean changed = !priv->index_loaded[tabnum]
+		|| g_strcmp0(checksum, priv->index_checksums[tabnum]) != 0;
+
+	I7StoryPanel side;
+	for(side = LEFT; side < I7_STORY_NUM_PANELS; side++) {
+		WebKitWebView *webview = WEBKIT_WEB_VIEW(story->panel[side]->index_tabs[tabnum]);
+		if(checksum == NULL) {
+			if(changed)
+				html_load_blank(webview);
+		} else if(changed || !web_view_shows_file(webview, file)) {
+			html_load_file(webview, file);
+		}
 	}
 	g_object_unref(file);
+
+	g_free(priv->index_checksums[tabnum]);
+	priv->index_checksums[tabnum] = checksum;
+	priv->index_loaded[tabnum] = TRUE;
 }
 
-/* Idle function to check whether an index file exists and to load it, or a
-blank page if it doesn't exist. */
+/* Idle function to check whether an index file has changed and to load it, one
+tab each time it is called, so that reading the pages doesn't hold up the GUI */
 static gboolean
 check_and_load_idle(I7Story *story)
 {
-	static I7PaneIndexTab counter = 0;
+	I7_STORY_USE_PRIVATE(story, priv);
 
-	load_index_file(story, counter);
-	counter++; /* next time, load the next tab */
-	if(counter == I7_INDEX_NUM_TABS) {
-		counter = 0; /* next time, load the first tab */
+	reload_index_tab_if_changed(story, priv->index_reload_next_tab);
+	priv->index_reload_next_tab++; /* next time, load the next tab */
+	if(priv->index_reload_next_tab == I7_INDEX_NUM_TABS) {
+		priv->index_reload_next_tab = 0; /* next time, load the first tab */
+		priv->index_reload_source = 0;
 		i7_document_display_progress_percentage(I7_DOCUMENT(story), 0.0);
 		i7_document_remove_status_message(I7_DOCUMENT(story), INDEX_TABS);
 		return FALSE; /* quit the cycle */
 	}
 
 	/* Update the status bar */
-	i7_document_display_progress_percentage(I7_DOCUMENT(story), (gdouble)counter / (gdouble)I7_INDEX_NUM_TABS);
+	i7_document_display_progress_percentage(I7_DOCUMENT(story), (gdouble)priv->index_reload_next_tab / (gdouble)I7_INDEX_NUM_TABS);
 	i7_document_display_status_message(I7_DOCUMENT(story), _("Reloading index..."), INDEX_TABS);
 
 	return TRUE; /* make sure there is a next time */
 }
 
-/* Load all the correct files in the index tabs, if they exist */
+/* Load all the correct files in the index tabs, if they exist and have changed
+since they were last loaded. If a reload is already in progress, it starts
+again from the first tab. */
 void
 i7_story_reload_index_tabs(I7Story *story, gboolean wait)
 {
-	if(wait)
+	I7_STORY_USE_PRIVATE(story, priv);
+
+	priv->index_reload_next_tab = 0;
+	if(wait) {
+		if(priv->index_reload_source) {
+			g_source_remove(priv->index_reload_source);
+			priv->index_reload_source = 0;
+		}
 		while(check_and_load_idle(story))
 			;
-	else
-		g_idle_add((GSourceFunc)check_and_load_idle, story);
+	} else if(!priv->index_reload_source) {
+		priv->index_reload_source = g_idle_add((GSourceFunc)check_and_load_idle, story);
+	}
 }
@@ -46,6 +46,12 @@ typedef struct {
 	gpointer compile_finished_callback_data;
 	GFile *copy_blorb_dest_file;
 	GFile *compiler_output_file;
+	GCancellable *debug_files_cancellable;
+	/* Index pages as last loaded, to see which ones have changed */
+	gboolean index_loaded[I7_INDEX_NUM_TABS];
+	gchar *index_checksums[I7_INDEX_NUM_TABS];
+	guint index_reload_source;
+	I7PaneIndexTab index_reload_next_tab;
 	/* Skein / running */
 	I7Skein *skein;
 	GSettings *skein_settings;
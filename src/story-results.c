@@ -20,6 +20,9 @@
 #include <gtksourceview/gtksourcelanguage.h>
 #include <gtksourceview/gtksourcelanguagemanager.h>
 #include "story.h"
+#include "story-private.h"
+#include "app.h"
+#include "configfile.h"
 #include "document.h"
 #include "lang.h"
 
@@ -59,3 +62,41 @@ create_inform6_source_buffer()
 	gtk_source_buffer_set_highlight_syntax(i6buffer, TRUE);
 	return i6buffer;
 }
+
+/* Show a line of the I6 code that ni generated, in the Inform 6 tab, when a
+link to it in the Problems tab is clicked. The tab is shown even if the
+debugging tabs are turned off; in that case the code isn't loaded after each
+compile, so it is loaded now. */
+void
+on_panel_jump_to_i6_line(I7Panel *panel, guint line, I7Story *story)
+{
+	I7_STORY_USE_PRIVATE(story, priv);
+	GtkTextBuffer *buffer = GTK_TEXT_BUFFER(priv->i6_source);
+
+	if(!g_settings_get_boolean(i7_app_get_prefs(i7_app_get()), PREFS_SHOW_DEBUG_LOG)) {
+		GFile *project_file = i7_document_get_file(I7_DOCUMENT(story));
+		GFile *i6_file = g_file_resolve_relative_path(project_file, "Build/auto.inf");
+		g_object_unref(project_file);
+		char *contents;
+		gsize length;
+		gboolean loaded = g_file_load_contents(i6_file, NULL, &contents, &length, NULL, NULL);
+		g_object_unref(i6_file);
+		if(!loaded)
+			return; /* nothing to show */
+		gtk_text_buffer_set_text(buffer, contents, length);
+		g_free(contents);
+	}
+
+	I7StoryPanel side = i7_story_choose_panel(story, I7_PANE_RESULTS);
+	GtkTextView *view = GTK_TEXT_VIEW(story->panel[side]->results_tabs[I7_RESULTS_TAB_INFORM6]);
+	gtk_widget_show(story->panel[side]->inform6_scrolledwindow);
+	i7_story_show_tab(story, I7_PANE_RESULTS, I7_RESULTS_TAB_INFORM6);
+
+	GtkTextIter start, end;
+	gtk_text_buffer_get_iter_at_line(buffer, &start, line - 1); /* counted from 0 */
+	end = start;
+	if(!gtk_text_iter_ends_line(&end))
+		gtk_text_iter_forward_to_line_end(&end);
+	gtk_text_buffer_select_range(buffer, &start, &end);
+	gtk_text_view_scroll_to_mark(view, gtk_text_buffer_get_insert(buffer), 0.25, FALSE, 0.0, 0.0);
+}
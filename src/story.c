@@ -693,6 +693,7 @@ story_init_panel(I7Story *self, I7Panel *panel, PangoFontDescription *font)
 	g_signal_connect(panel, "select-view", G_CALLBACK(on_panel_select_view), self);
 	g_signal_connect(panel, "paste-code", G_CALLBACK(on_panel_paste_code), self);
 	g_signal_connect(panel, "jump-to-line", G_CALLBACK(on_panel_jump_to_line), self);
+	g_signal_connect(panel, "jump-to-i6-line", G_CALLBACK(on_panel_jump_to_i6_line), self);
 	g_signal_connect(panel, "display-docpage", G_CALLBACK(on_panel_display_docpage), self);
 	g_signal_connect(panel, "display-extensions-docpage", G_CALLBACK(on_panel_display_extensions_docpage), self);
 	g_signal_connect(panel, "display-index-page", G_CALLBACK(on_panel_display_index_page), self);
@@ -824,6 +825,7 @@ i7_story_init(I7Story *self)
 	priv->compile_finished_callback_data = NULL;
 	priv->copy_blorb_dest_file = NULL;
 	priv->compiler_output_file = NULL;
+	priv->debug_files_cancellable = NULL;
 	priv->test_me = FALSE;
 	priv->manifest = NULL;
 	
@@ -921,10 +923,19 @@ i7_story_finalize(GObject *self)
 		g_object_unref(priv->copy_blorb_dest_file);
 	if(priv->compiler_output_file)
 		g_object_unref(priv->compiler_output_file);
+	if(priv->debug_files_cancellable) {
+		g_cancellable_cancel(priv->debug_files_cancellable);
+		g_object_unref(priv->debug_files_cancellable);
+	}
 	if(priv->settings)
 		plist_object_free(priv->settings);
 	if(priv->manifest)
 		plist_object_free(priv->manifest);
+	if(priv->index_reload_source)
+		g_source_remove(priv->index_reload_source);
+	int ix;
+	for(ix = 0; ix < I7_INDEX_NUM_TABS; ix++)
+		g_free(priv->index_checksums[ix]);
 	G_OBJECT_CLASS(i7_story_parent_class)->finalize(self);
 }
 
@@ -99,6 +99,7 @@ gboolean reindex_headings(GtkTextBuffer *buffer, I7Document *document);
 void i7_story_add_debug_tabs(I7Document *document);
 void i7_story_remove_debug_tabs(I7Document *document);
 GtkSourceBuffer *create_inform6_source_buffer(void);
+void on_panel_jump_to_i6_line(I7Panel *panel, guint line, I7Story *story);
 
 /* Index pane, story-index.c */
 void i7_story_reload_index_tabs(I7Story *story, gboolean wait);